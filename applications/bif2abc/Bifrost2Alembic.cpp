@@ -1,5 +1,8 @@
 #include "Bifrost2Alembic.h"
 #include <boost/shared_ptr.hpp>
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
 
 Alembic::AbcGeom::GeometryScope Bifrost2Alembic::_geometry_parameter_scope = Alembic::AbcGeom::kVaryingScope;
 
@@ -7,18 +10,25 @@ Bifrost2Alembic::Bifrost2Alembic(const std::string& bifrost_filename,
 								 const std::string& alembic_filename,
 								 const std::string& position_channel_name,
 								 const std::string& velocity_channel_name,
+								 const std::string& id_channel_name,
 								 const std::string& density_channel_name,
 								 const std::string& vorticity_channel_name,
 								 const std::string& droplet_channel_name,
-								 bool enable_hdf5_alembic)
+								 bool enable_hdf5_alembic,
+								 float fps)
 : _bifrost_filename(bifrost_filename)
 , _alembic_filename(alembic_filename)
 , _position_channel_name(position_channel_name)
 , _velocity_channel_name(velocity_channel_name)
+, _id_channel_name(id_channel_name)
 , _density_channel_name(density_channel_name)
 , _vorticity_channel_name(vorticity_channel_name)
 , _droplet_channel_name(droplet_channel_name)
 , _enable_hdf5_alembic(enable_hdf5_alembic)
+, _fps(fps)
+, _is_frame_sequence(false)
+, _low_memory_mode(false)
+, _tsidx(0)
 {
 
 }
@@ -28,91 +38,232 @@ Bifrost2Alembic::~Bifrost2Alembic()
 
 }
 
-bool Bifrost2Alembic::translate()
+void Bifrost2Alembic::set_frame_range(const FrameRange& frame_range)
+{
+	_frame_range = frame_range;
+	_is_frame_sequence = true;
+}
+
+void Bifrost2Alembic::set_low_memory_mode(bool low_memory_mode)
 {
+	_low_memory_mode = low_memory_mode;
+}
 
-    Bifrost::API::String biffile = _bifrost_filename.c_str();
-    Bifrost::API::ObjectModel om;
-    Bifrost::API::FileIO fileio = om.createFileIO( biffile );
-    const Bifrost::API::BIF::FileInfo& info = fileio.info();
-    bool is_bifrost_liquid_file(true);
+size_t Bifrost2Alembic::frame_count() const
+{
+	return _is_frame_sequence ? _frame_range.count() : 1;
+}
 
-    // Need to determine is the BIF file contains Foam or Liquid particle info
-    if (std::string(info.componentName.c_str()).find("Foam")!=std::string::npos)
-    	is_bifrost_liquid_file = false;
+std::string Bifrost2Alembic::frame_filename(size_t frame_index) const
+{
+	return _is_frame_sequence ? expand_frame_pattern(_bifrost_filename,_frame_range.frame(frame_index)) : _bifrost_filename;
+}
 
-    // Need to load the entire file's content to process
-    Bifrost::API::StateServer ss = fileio.load( );
-    if (ss.valid())
-    {
-        size_t numComponents = ss.components().count();
-        if (numComponents>0)
-        {
-            /*
-             * Create the Alembic file only if we get a valid state server
-             * after loading and there is at least one component
-             */
+bool Bifrost2Alembic::translate()
+{
+	bool status = true;
+	size_t frameCount = frame_count();
+	for (size_t frameIndex=0;status && frameIndex<frameCount;frameIndex++)
+	{
+		LoadedFrame loaded_frame;
+		ConvertedFrame converted_frame;
+		status = load_frame(frameIndex,loaded_frame);
+		if (status && _low_memory_mode)
+			status = stream_frame(loaded_frame);
+		else if (status)
+			status = convert_frame(loaded_frame,converted_frame) && write_frame(converted_frame);
+	}
+	// The archive is complete or not, see finish_alembic_output()
+	close();
+	return status;
+}
+
+bool Bifrost2Alembic::load_frame(size_t frame_index, LoadedFrame& o_frame) const
+{
+	o_frame.frame_index = frame_index;
+	o_frame.bifrost_filename = frame_filename(frame_index);
+	Bifrost::API::String biffile = o_frame.bifrost_filename.c_str();
+	Bifrost::API::FileIO fileio = o_frame.om.createFileIO( biffile );
+
+	// Need to load the entire file's content to process
+	o_frame.ss = fileio.load( );
+	if (!o_frame.ss.valid())
+	{
+		// A missing frame would shift every following sample in time
+		std::cerr << boost::format("Unable to load the content of the Bifrost file \"%1%\"") % o_frame.bifrost_filename.c_str()
+				  << std::endl;
+		return false;
+	}
+	return true;
+}
 
-        	boost::shared_ptr<Alembic::AbcGeom::OArchive> archive_ptr;
+bool Bifrost2Alembic::convert_frame(LoadedFrame& io_frame, ConvertedFrame& o_frame) const
+{
+	o_frame.frame_index = io_frame.frame_index;
+	o_frame.bifrost_filename = io_frame.bifrost_filename;
+	o_frame.component_count = io_frame.ss.components().count();
+	std::vector<Bifrost::API::Component> point_components;
+	for (size_t componentIndex=0;componentIndex<o_frame.component_count;componentIndex++)
+	{
+		Bifrost::API::Component component = io_frame.ss.components()[componentIndex];
+		Bifrost::API::TypeID componentType = component.type();
+		if (componentType == Bifrost::API::PointComponentType)
+			point_components.push_back(component);
+	}
+	/*!
+	 * \remark Components are gathered concurrently, each into its own slot so
+	 *         they are written in file order. The tile loops inside each
+	 *         component nest in the same TBB task pool
+	 */
+	o_frame.point_components.resize(point_components.size());
+	tbb::parallel_for(tbb::blocked_range<size_t>(0,point_components.size(),1),
+					  [&](const tbb::blocked_range<size_t>& range) {
+						  for (size_t i=range.begin();i!=range.end();i++)
+						  {
+							  PointComponentData& data = o_frame.point_components[i];
+							  data.name = point_components[i].name().c_str();
+							  data.valid = process_point_component(point_components[i],data);
+						  }
+					  });
+	// The gathered arrays are all that is needed from here on
+	io_frame.ss.reset();
+	return true;
+}
+
+bool Bifrost2Alembic::open_archive()
+{
+	/*
+	 * Create the Alembic file only if we get a valid state server
+	 * after loading and there is at least one component
+	 */
 #ifdef BIF2ABC_ENABLE_ALEMBIC_HDF5
-        	if (_enable_hdf5_alembic)
-        	{
-        		archive_ptr.reset(new Alembic::AbcGeom::OArchive(Alembic::Abc::CreateArchiveWithInfo(Alembic::AbcCoreHDF5::WriteArchive(),
-        																							 _alembic_filename.c_str(),
-																									 std::string("Procedural Insight Pty. Ltd."),
-																									 std::string("info@proceduralinsight.com"))));
-        	} else {
-        		archive_ptr.reset(new Alembic::AbcGeom::OArchive(Alembic::Abc::CreateArchiveWithInfo(Alembic::AbcCoreOgawa::WriteArchive(),
-        																							 _alembic_filename.c_str(),
-																									 std::string("Procedural Insight Pty. Ltd."),
-																									 std::string("info@proceduralinsight.com"))));
-        	}
-			Alembic::AbcGeom::OObject topObj(*archive_ptr, Alembic::AbcGeom::kTop);
-#else // BIF2ABC_ENABLE_ALEMBIC_HDF5
-			Alembic::AbcGeom::OArchive archive(Alembic::Abc::CreateArchiveWithInfo(Alembic::AbcCoreOgawa::WriteArchive(),
-                                                                                   _alembic_filename.c_str(),
-                                                                                   std::string("Procedural Insight Pty. Ltd."),
-                                                                                   std::string("info@proceduralinsight.com")));
-            Alembic::AbcGeom::OObject topObj( archive, Alembic::AbcGeom::kTop );
+	if (_enable_hdf5_alembic)
+	{
+		_archive_ptr.reset(new Alembic::AbcGeom::OArchive(Alembic::Abc::CreateArchiveWithInfo(Alembic::AbcCoreHDF5::WriteArchive(),
+																							  _alembic_filename.c_str(),
+																							  std::string("Procedural Insight Pty. Ltd."),
+																							  std::string("info@proceduralinsight.com"))));
+	} else
 #endif // BIF2ABC_ENABLE_ALEMBIC_HDF5
-            Alembic::AbcGeom::OXform xform = addXform(topObj,"bif2abc");
+	{
+		_archive_ptr.reset(new Alembic::AbcGeom::OArchive(Alembic::Abc::CreateArchiveWithInfo(Alembic::AbcCoreOgawa::WriteArchive(),
+																							  _alembic_filename.c_str(),
+																							  std::string("Procedural Insight Pty. Ltd."),
+																							  std::string("info@proceduralinsight.com"))));
+	}
+	Alembic::AbcGeom::OObject topObj(*_archive_ptr, Alembic::AbcGeom::kTop);
+	_xform = addXform(topObj,"bif2abc");
+
+	// Create the time sampling, sequences start at their first frame
+	Alembic::Abc::chrono_t fps = _fps;
+	Alembic::Abc::chrono_t iFps = 1.0/fps;
+	Alembic::Abc::chrono_t startTime = _is_frame_sequence ? _frame_range.first * iFps : 0.0;
+	Alembic::Abc::TimeSampling ts(_frame_range.step * iFps,startTime);
+	_tsidx = topObj.getArchive().addTimeSampling(ts);
+	return true;
+}
 
-            // Create the time sampling
-            Alembic::Abc::chrono_t fps = 24.0;
-            Alembic::Abc::chrono_t startTime = 0.0;
-            Alembic::Abc::chrono_t iFps = 1.0/fps;
-            Alembic::Abc::TimeSampling ts(iFps,startTime);
-            uint32_t tsidx = topObj.getArchive().addTimeSampling(ts);
+bool Bifrost2Alembic::begin_frame(size_t component_count, const std::string& bifrost_filename)
+{
+	if (!_archive_ptr)
+	{
+		if (component_count==0)
+		{
+			if (!_is_frame_sequence)
+				return true;
+			std::cerr << boost::format("No component in the first frame \"%1%\"") % bifrost_filename.c_str()
+					  << std::endl;
+			return false;
+		}
+		if (!open_archive())
+			return false;
+	}
+	return true;
+}
 
-            for (size_t componentIndex=0;componentIndex<numComponents;componentIndex++)
-            {
-                Bifrost::API::Component component = ss.components()[componentIndex];
-                Bifrost::API::TypeID componentType = component.type();
-                if (componentType == Bifrost::API::PointComponentType)
-                {
-                    Imath::Box3f bounds;
-                    process_point_component(is_bifrost_liquid_file,
-                    						component,
-											_position_channel_name,
-											_velocity_channel_name,
-											_density_channel_name,
-											_vorticity_channel_name,
-											_droplet_channel_name,
-											bounds,
-											tsidx,
-											xform);
-                }
-            }
-        }
-    }
-    else
-    {
-        std::cerr << boost::format("Unable to load the content of the Bifrost file \"%1%\"") % _bifrost_filename.c_str()
-                  << std::endl;
-        return false;
-    }
-    return true;
+Bifrost2Alembic::PointComponentOutput*
+Bifrost2Alembic::frame_point_output(size_t frame_index,
+									const std::string& component_name)
+{
+	PointComponentOutputPtr& output = _point_outputs[component_name];
+	if (!output)
+	{
+		output = create_point_component_output(component_name,_tsidx,_xform);
+		// Components appearing mid-sequence start with empty samples
+		while (output->sample_count<frame_index)
+			write_empty_point_sample(*output);
+	}
+	if (output->sample_count>frame_index)
+		return 0; // duplicate component name in this frame
+	return output.get();
+}
 
+void Bifrost2Alembic::end_frame(size_t frame_index, const std::string& bifrost_filename)
+{
+	// Components missing from this frame
+	PointComponentOutputMap::iterator outputIter = _point_outputs.begin();
+	PointComponentOutputMap::iterator outputEIter = _point_outputs.end();
+	for (;outputIter!=outputEIter;++outputIter)
+	{
+		if (outputIter->second->sample_count<=frame_index)
+			write_empty_point_sample(*outputIter->second);
+	}
+	if (_is_frame_sequence)
+		std::cout << boost::format("Frame %1% : %2%") % _frame_range.frame(frame_index) % bifrost_filename << std::endl;
+}
+
+bool Bifrost2Alembic::write_frame(const ConvertedFrame& frame)
+{
+	if (!begin_frame(frame.component_count,frame.bifrost_filename))
+		return false;
+	if (!_archive_ptr)
+		return true;
+
+	for (size_t i=0;i<frame.point_components.size();i++)
+	{
+		const PointComponentData& data = frame.point_components[i];
+		PointComponentOutput* output = frame_point_output(frame.frame_index,data.name);
+		if (!output)
+			continue;
+		if (data.valid)
+			write_point_component(data,*output);
+		else
+			write_empty_point_sample(*output);
+	}
+	end_frame(frame.frame_index,frame.bifrost_filename);
+	return true;
+}
+
+bool Bifrost2Alembic::stream_frame(LoadedFrame& io_frame)
+{
+	size_t component_count = io_frame.ss.components().count();
+	if (!begin_frame(component_count,io_frame.bifrost_filename))
+		return false;
+	if (_archive_ptr)
+	{
+		for (size_t componentIndex=0;componentIndex<component_count;componentIndex++)
+		{
+			Bifrost::API::Component component = io_frame.ss.components()[componentIndex];
+			if (component.type() != Bifrost::API::PointComponentType)
+				continue;
+			std::string component_name(component.name().c_str());
+			PointComponentOutput* output = frame_point_output(io_frame.frame_index,component_name);
+			if (!output)
+				continue;
+			if (!stream_point_component(component,*output))
+				write_empty_point_sample(*output);
+		}
+		end_frame(io_frame.frame_index,io_frame.bifrost_filename);
+	}
+	io_frame.ss.reset();
+	return true;
+}
+
+void Bifrost2Alembic::close()
+{
+	_point_outputs.clear();
+	_xform = Alembic::AbcGeom::OXform();
+	_archive_ptr.reset();
 }
 
 Alembic::AbcGeom::OXform
@@ -123,197 +274,435 @@ Bifrost2Alembic::addXform(Alembic::Abc::OObject parent, std::string name)
     return xform;
 }
 
-bool Bifrost2Alembic::process_point_component(bool is_bifrost_liquid_file,
-											  const Bifrost::API::Component& component,
-											  const std::string& position_channel_name,
-											  const std::string& velocity_channel_name,
-											  const std::string& density_channel_name,
-											  const std::string& vorticity_channel_name,
-											  const std::string& droplet_channel_name,
-											  Imath::Box3f& bounds,
-											  uint32_t tsidx,
-											  Alembic::AbcGeom::OXform& xform)
-{
-	// All channel variables (not all will be initialized)
-    Bifrost::API::Channel position_ch;  // in both liquid and foam
-    Bifrost::API::Channel velocity_ch;  // in both liquid and foam
-    Bifrost::API::Channel density_ch;   // in both liquid and foam
-    Bifrost::API::Channel vorticity_ch; // only in liquid
-    Bifrost::API::Channel droplet_ch;   // only in liquid
+/*!
+ * \remark Single switch from Bifrost::API::DataType to the Alembic geom param
+ *         type, the functor's apply<O_GEOM_PARAM>() is instantiated per type
+ */
+template<class Functor>
+static bool dispatch_geom_param_type(Bifrost::API::DataType data_type, Functor& functor)
+{
+    switch (data_type)
+    {
+    case Bifrost::API::FloatType:   functor.template apply<Alembic::AbcGeom::OFloatGeomParam>();  return true;
+    case Bifrost::API::FloatV2Type: functor.template apply<Alembic::AbcGeom::OV2fGeomParam>();    return true;
+    case Bifrost::API::FloatV3Type: functor.template apply<Alembic::AbcGeom::OV3fGeomParam>();    return true;
+    case Bifrost::API::Int32Type:   functor.template apply<Alembic::AbcGeom::OInt32GeomParam>();  return true;
+    case Bifrost::API::Int64Type:   functor.template apply<Alembic::AbcGeom::OInt64GeomParam>();  return true;
+    case Bifrost::API::UInt32Type:  functor.template apply<Alembic::AbcGeom::OUInt32GeomParam>(); return true;
+    case Bifrost::API::UInt64Type:  functor.template apply<Alembic::AbcGeom::OUInt64GeomParam>(); return true;
+    case Bifrost::API::Int32V2Type: functor.template apply<Alembic::AbcGeom::OV2iGeomParam>();    return true;
+    case Bifrost::API::Int32V3Type: functor.template apply<Alembic::AbcGeom::OV3iGeomParam>();    return true;
+    default:                        return false;
+    }
+}
 
-    // Position channel
-    bool position_channel_status = false;
-    get_channel(component,position_channel_name,Bifrost::API::FloatV3Type,position_ch,position_channel_status);
-    if (!position_channel_status)
+struct Bifrost2Alembic::AddArbGeomParamFunctor
+{
+    AddArbGeomParamFunctor(Bifrost2Alembic& i_self,
+                           const std::string& i_name,
+                           Alembic::AbcGeom::OPointsSchema& io_schema,
+                           GeomParmPtr& o_geom_parm)
+    : self(i_self)
+    , name(i_name)
+    , schema(io_schema)
+    , geom_parm(o_geom_parm)
+    {}
+    template<class O_GEOM_PARAM> void apply()
     {
-    	return false;
+        self.AddPointAttributes<O_GEOM_PARAM>(self._tsidx,_geometry_parameter_scope,name,schema,geom_parm);
+    }
+    Bifrost2Alembic&                 self;
+    const std::string&               name;
+    Alembic::AbcGeom::OPointsSchema& schema;
+    GeomParmPtr&                     geom_parm;
+};
+
+struct Bifrost2Alembic::SetArbGeomParamFunctor
+{
+    SetArbGeomParamFunctor(Bifrost2Alembic& i_self,
+                           const void* i_data,
+                           size_t i_data_size,
+                           GeomParmPtr& o_geom_parm)
+    : self(i_self)
+    , data(i_data)
+    , data_size(i_data_size)
+    , geom_parm(o_geom_parm)
+    {}
+    template<class O_GEOM_PARAM> void apply()
+    {
+        self.SetPointAttributesData<O_GEOM_PARAM>(data,data_size,_geometry_parameter_scope,geom_parm);
+    }
+    Bifrost2Alembic& self;
+    const void*      data;
+    size_t           data_size;
+    GeomParmPtr&     geom_parm;
+};
+
+bool Bifrost2Alembic::AddArbGeomParam(Bifrost::API::DataType data_type,
+									  const std::string& i_geom_param_name,
+									  Alembic::AbcGeom::OPointsSchema &o_pSchema,
+									  GeomParmPtr& o_geom_parm)
+{
+    AddArbGeomParamFunctor functor(*this,i_geom_param_name,o_pSchema,o_geom_parm);
+    return dispatch_geom_param_type(data_type,functor);
+}
+
+bool Bifrost2Alembic::SetArbGeomParamData(Bifrost::API::DataType data_type,
+										  const void* data,
+										  size_t data_size,
+										  GeomParmPtr& o_geom_parm)
+{
+    SetArbGeomParamFunctor functor(*this,data,data_size,o_geom_parm);
+    return dispatch_geom_param_type(data_type,functor);
+}
+
+Bifrost2Alembic::PointComponentOutputPtr
+Bifrost2Alembic::create_point_component_output(const std::string& component_name,
+											   uint32_t tsidx,
+											   Alembic::AbcGeom::OXform& xform)
+{
+    // Create the OPoints object
+    PointComponentOutputPtr output(new PointComponentOutput(xform,component_name,tsidx));
+    Alembic::AbcGeom::OPointsSchema &pSchema = output->points.getSchema();
+
+    Alembic::AbcGeom::MetaData mdata;
+    SetGeometryScope( mdata, Alembic::AbcGeom::kVaryingScope );
+    output->velocities = Alembic::AbcGeom::OV3fArrayProperty( pSchema, ".velocities", mdata, tsidx );
+
+    // NOTE : Other than position, velocity and id, all the other information
+    //        are expected to be store as arbGeomParam, created on first use
+    return output;
+}
+
+void Bifrost2Alembic::write_arb_geom_param(PointComponentOutput& output,
+										   const std::string& name,
+										   Bifrost::API::DataType data_type,
+										   const void* data,
+										   size_t data_size)
+{
+    ArbGeomParamOutput& param = output.arb_geom_params[name];
+    if (!param.geom_param)
+    {
+        if (!AddArbGeomParam(data_type,name,output.points.getSchema(),param.geom_param))
+        {
+            output.arb_geom_params.erase(name);
+            return;
+        }
+        param.data_type = data_type;
+        // Channels appearing mid-sequence start with empty samples
+        while (param.sample_count<output.sample_count)
+        {
+            SetArbGeomParamData(param.data_type,0,0,param.geom_param);
+            param.sample_count++;
+        }
+    }
+    if (param.data_type != data_type)
+    {
+        std::cerr << boost::format("Channel '%1%' changed type from %2% to %3%, left empty") % name % param.data_type % data_type << std::endl;
+        return;
+    }
+    if (param.sample_count>output.sample_count)
+        return; // duplicate name in this sample
+    SetArbGeomParamData(param.data_type,data,data_size,param.geom_param);
+    param.sample_count++;
+}
+
+void Bifrost2Alembic::finish_point_sample(PointComponentOutput& output)
+{
+    ArbGeomParamOutputMap::iterator paramIter = output.arb_geom_params.begin();
+    ArbGeomParamOutputMap::iterator paramEIter = output.arb_geom_params.end();
+    for (;paramIter!=paramEIter;++paramIter)
+    {
+        ArbGeomParamOutput& param = paramIter->second;
+        if (param.sample_count<=output.sample_count)
+        {
+            SetArbGeomParamData(param.data_type,0,0,param.geom_param);
+            param.sample_count++;
+        }
     }
+    output.sample_count++;
+}
+
+void Bifrost2Alembic::write_empty_point_sample(PointComponentOutput& output)
+{
+    std::vector< Alembic::Abc::V3f > positions;
+    std::vector< Alembic::Util::uint64_t > ids;
+    Alembic::AbcGeom::OPointsSchema::Sample psamp(Alembic::AbcGeom::V3fArraySample( positions ),
+												  Alembic::AbcGeom::UInt64ArraySample( ids ));
+    output.points.getSchema().set( psamp );
+    output.velocities.set( Alembic::AbcGeom::V3fArraySample( positions ) );
+    finish_point_sample(output);
+}
+
+bool Bifrost2Alembic::get_point_channels(const Bifrost::API::Component& component,
+										 PointChannels& o_channels) const
+{
+    ChannelIndex channel_index(component);
 
-    // Density channel
-    bool density_channel_status = false;
-    get_channel(component,density_channel_name,Bifrost::API::FloatType,density_ch,density_channel_status);
-    if (!density_channel_status)
+    // Position channel
+    bool position_channel_status = false;
+    get_channel(channel_index,_position_channel_name,Bifrost::API::FloatV3Type,o_channels.position_ch,position_channel_status);
+    if (!position_channel_status)
     {
     	return false;
     }
 
     // Velocity channel
     bool velocity_channel_status = false;
-    get_channel(component,velocity_channel_name,Bifrost::API::FloatV3Type,velocity_ch,velocity_channel_status);
+    get_channel(channel_index,_velocity_channel_name,Bifrost::API::FloatV3Type,o_channels.velocity_ch,velocity_channel_status);
     if (!velocity_channel_status)
     {
     	return false;
     }
 
+    // Id channel, optional : ids are then the particle's position in the file
+    int idChannelIndex = channel_index.find(_id_channel_name);
+    if (idChannelIndex>=0)
+    {
+        const Bifrost::API::Channel& id_ch = channel_index.channel(idChannelIndex);
+        if (id_ch.valid() && (id_ch.dataType()==Bifrost::API::UInt64Type || id_ch.dataType()==Bifrost::API::Int64Type))
+            o_channels.id_ch = id_ch;
+        else
+            std::cerr << boost::format("Channel '%1%' in component '%2%' is of type %3% instead of a 64 bit integer, ids will not be stable across frames") % _id_channel_name % component.name().c_str() % id_ch.dataType() << std::endl;
+    }
+    else
+        std::cerr << boost::format("No '%1%' channel in component '%2%', ids will not be stable across frames") % _id_channel_name % component.name().c_str() << std::endl;
+
     /*!
-     * \note Additional attributes requiring handling
-     * \li Vorticity (vector)
-     * \li Droplet (scalar)
+     * \note Every other channel of a supported type is an arbGeomParam,
+     *       the density, vorticity and droplet channels keep their
+     *       historical names whatever they are called in Bifrost
      */
-    if (is_bifrost_liquid_file)
+    std::map<int,std::string> renamed_channels;
+    const std::string* renamed[] = { &_density_channel_name, &_vorticity_channel_name, &_droplet_channel_name };
+    const char* alembic_names[] = { "density", "vorticity", "droplet" };
+    for (size_t i=0;i<3;i++)
     {
-        // Vorticity channel
-        bool vorticity_channel_status = false;
-        get_channel(component,vorticity_channel_name,Bifrost::API::FloatType,vorticity_ch,vorticity_channel_status);
-        if (!vorticity_channel_status)
-        {
-        	return false;
-        }
-
-        // Droplet channel
-        bool droplet_channel_status = false;
-        get_channel(component,droplet_channel_name,Bifrost::API::FloatType,droplet_ch,droplet_channel_status);
-        if (!droplet_channel_status)
+        int renamedChannelIndex = channel_index.find(*renamed[i]);
+        if (renamedChannelIndex>=0)
+            renamed_channels.insert(std::make_pair(renamedChannelIndex,std::string(alembic_names[i])));
+    }
+    int positionChannelIndex = channel_index.find(_position_channel_name);
+    int velocityChannelIndex = channel_index.find(_velocity_channel_name);
+    for (size_t i=0;i<channel_index.count();i++)
+    {
+        int channelIndex = int(i);
+        if (channelIndex==positionChannelIndex || channelIndex==velocityChannelIndex || channelIndex==idChannelIndex)
+            continue;
+        const Bifrost::API::Channel& channel = channel_index.channel(i);
+        if (!channel.valid() || data_type_size(channel.dataType())==0)
+            continue;
+        std::map<int,std::string>::const_iterator renamedIter = renamed_channels.find(channelIndex);
+        std::string name;
+        if (renamedIter!=renamed_channels.end())
+            name = renamedIter->second;
+        else
         {
-        	return false;
+            name = channel_index.name(i);
+            size_t separator = name.rfind('/');
+            if (separator!=std::string::npos)
+                name = name.substr(separator+1);
         }
-
+        o_channels.arb_geom_param_channels.push_back(ArbGeomParamChannel(name,channel));
     }
-    // Create the OPoints object
-    Alembic::AbcGeom::OPoints partsOut(xform,component.name().c_str(),tsidx);
-    Alembic::AbcGeom::OPointsSchema &pSchema = partsOut.getSchema();
+    return true;
+}
 
-    Alembic::AbcGeom::MetaData mdata;
-    SetGeometryScope( mdata, Alembic::AbcGeom::kVaryingScope );
-    Alembic::AbcGeom::OV3fArrayProperty velOut( pSchema, ".velocities", mdata, tsidx );
+bool Bifrost2Alembic::process_point_component(const Bifrost::API::Component& component,
+											  PointComponentData& o_data) const
+{
+    PointChannels channels;
+    if (!get_point_channels(component,channels))
+    	return false;
 
-    std::vector< Alembic::Abc::V3f > positions;
-    std::vector< Alembic::Abc::V3f > velocities;
-    std::vector< float > densities;
-    std::vector< float > vorticities;
-    std::vector< float > droplets;
-    std::vector< Alembic::Util::uint64_t > ids;
+    std::vector< Alembic::Abc::V3f >& positions = o_data.positions;
+    std::vector< Alembic::Abc::V3f >& velocities = o_data.velocities;
+    std::vector< Alembic::Util::uint64_t >& ids = o_data.ids;
+    Imath::Box3f& bounds = o_data.bounds;
 
-    // NOTE : Other than position, velocity and id, all the other information
-    //        are expected to be store as arbGeomParam
-    AddPointAttributes<Alembic::AbcGeom::OFloatGeomParam>(tsidx,
-    													  _geometry_parameter_scope,
-														  "density",
-														  pSchema,
-														  density_geom_param);
-    if (is_bifrost_liquid_file)
+    // Data accumulation, every buffer is sized once and filled with whole tile copies
+    Bifrost::API::Layout layout = component.layout();
+    const float _MVS = layout.voxelScale();
+    TileTraversal traversal(component);
+    size_t particleCount = traversal.elementCount();
+
+    positions.resize(particleCount);
+    velocities.resize(particleCount);
+    ids.resize(particleCount);
+    ChannelGatherTargetContainer gather_targets;
+    gather_targets.push_back(ChannelGatherTarget(channels.position_ch.name().c_str(),Bifrost::API::FloatV3Type,positions.data(),positions.size()));
+    gather_targets.push_back(ChannelGatherTarget(channels.velocity_ch.name().c_str(),Bifrost::API::FloatV3Type,velocities.data(),velocities.size()));
+    if (channels.id_ch.valid())
+        gather_targets.push_back(ChannelGatherTarget(channels.id_ch.name().c_str(),channels.id_ch.dataType(),ids.data(),ids.size()));
+    if (!gather_channels(component,traversal,gather_targets))
     {
-        AddPointAttributes<Alembic::AbcGeom::OFloatGeomParam>(tsidx,
-        													  _geometry_parameter_scope,
-    														  "vorticity",
-    														  pSchema,
-    														  vorticity_geom_param);
-        AddPointAttributes<Alembic::AbcGeom::OFloatGeomParam>(tsidx,
-        													  _geometry_parameter_scope,
-    														  "droplet",
-    														  pSchema,
-    														  droplet_geom_param);
+        std::cerr << boost::format("Unable to gather the channels of component \"%1%\"") % component.name().c_str() << std::endl;
+        return false;
     }
-    // Data accumulation
-    Bifrost::API::Layout layout = component.layout();
-    size_t depthCount = layout.depthCount();
-    Alembic::Util::uint64_t currentId = 0;
-    for ( size_t d=0; d<depthCount; d++ ) {
-        for ( size_t t=0; t<layout.tileCount(d); t++ ) {
-            Bifrost::API::TreeIndex tindex(t,d);
-            if ( !position_ch.elementCount( tindex ) ) {
-                // nothing there
-                continue;
-            }
 
-            float _MVS = layout.voxelScale();
-            // std::cerr << boost::format("_MVS = %1%") % _MVS << std::endl;
-            const Bifrost::API::TileData<amino::Math::vec3f>& position_tile_data = position_ch.tileData<amino::Math::vec3f>( tindex );
-            const Bifrost::API::TileData<amino::Math::vec3f>& velocity_tile_data = velocity_ch.tileData<amino::Math::vec3f>( tindex );
-            const Bifrost::API::TileData<float>& density_tile_data = density_ch.tileData<float>( tindex );
-            if (position_tile_data.count() != velocity_tile_data.count())
-            {
-                std::cerr << boost::format("Point position and velocity tile data count mismatch position[%1%] velocity[%2%]") % position_tile_data.count() % velocity_tile_data.count()<< std::endl;
-                return false;
-            }
-            // Position
-            for (size_t i=0; i<position_tile_data.count(); i++ )
-            {
-                Imath::V3f point_position(position_tile_data[i][0]*_MVS,
-										  position_tile_data[i][1]*_MVS,
-										  position_tile_data[i][2]*_MVS);
-                positions.push_back(point_position);
-                bounds.extendBy(point_position);
-                ids.push_back(currentId);
-                currentId++;
-            }
-            // Velocity
-            for (size_t i=0; i<velocity_tile_data.count(); i++ )
-            {
-                velocities.push_back(Imath::V3f (velocity_tile_data[i][0],
-												 velocity_tile_data[i][1],
-												 velocity_tile_data[i][2]));
-            }
-            // Density
-            for (size_t i=0; i<density_tile_data.count(); i++ )
-            {
-            	densities.push_back(density_tile_data[i]);
-            }
+    // arbGeomParams are optional, one that cannot be gathered is skipped on its own
+    o_data.arb_geom_params.reserve(channels.arb_geom_param_channels.size());
+    for (size_t i=0;i<channels.arb_geom_param_channels.size();i++)
+    {
+        const ArbGeomParamChannel& param_channel = channels.arb_geom_param_channels[i];
+        o_data.arb_geom_params.push_back(ArbGeomParamData());
+        ArbGeomParamData& param_data = o_data.arb_geom_params.back();
+        param_data.name = param_channel.name;
+        param_data.data_type = param_channel.channel.dataType();
+        param_data.count = particleCount;
+        param_data.data.resize(particleCount*data_type_size(param_data.data_type));
+        if (particleCount && !gather_channel(traversal,param_channel.channel,param_data.data.data(),particleCount))
+        {
+            std::cerr << boost::format("Unable to gather channel '%1%' of component \"%2%\", skipped") % param_channel.channel.name().c_str() % component.name().c_str() << std::endl;
+            o_data.arb_geom_params.pop_back();
+        }
+    }
 
-            if (is_bifrost_liquid_file)
+    // Voxel scale and bounds
+    bool has_id_channel = channels.id_ch.valid();
+    std::vector<Imath::Box3f> tile_bounds(traversal.tileCount());
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        float tile_min[3], tile_max[3];
+        init_bounds(tile_min,tile_max);
+        scale_points_and_bounds(&positions[tile.elementOffset].x,tile.elementCount,_MVS,tile_min,tile_max);
+        tile_bounds[tile.ordinal] = Imath::Box3f(Imath::V3f(tile_min[0],tile_min[1],tile_min[2]),
+                                                 Imath::V3f(tile_max[0],tile_max[1],tile_max[2]));
+        if (!has_id_channel)
+        {
+            for (size_t pindex=tile.elementOffset; pindex<tile.elementOffset+tile.elementCount; pindex++ )
             {
-                const Bifrost::API::TileData<float>& vorticity_tile_data = vorticity_ch.tileData<float>( tindex );
-                const Bifrost::API::TileData<float>& droplet_tile_data = droplet_ch.tileData<float>( tindex );
-            	// Vorticity
-                for (size_t i=0; i<vorticity_tile_data.count(); i++ )
-                {
-                	vorticities.push_back(vorticity_tile_data[i]);
-                }
-
-            	// Droplet
-                for (size_t i=0; i<droplet_tile_data.count(); i++ )
-                {
-                	droplets.push_back(droplet_tile_data[i]);
-                }
+                ids[pindex] = pindex;
             }
         }
+    });
+    for (size_t i=0; i<tile_bounds.size(); i++ )
+    {
+        bounds.extendBy(tile_bounds[i]);
     }
 
+	return true;
+}
+
+void Bifrost2Alembic::write_point_component(const PointComponentData& data,
+											PointComponentOutput& output)
+{
+    Alembic::AbcGeom::OPointsSchema &pSchema = output.points.getSchema();
+
     // Update Alembic storage
-    Alembic::AbcGeom::V3fArraySample position_data ( positions );
-    Alembic::AbcGeom::UInt64ArraySample id_data ( ids );
+    Alembic::AbcGeom::V3fArraySample position_data ( data.positions );
+    Alembic::AbcGeom::UInt64ArraySample id_data ( data.ids );
     Alembic::AbcGeom::OPointsSchema::Sample psamp(position_data,
 												  id_data);
     pSchema.set( psamp );
-    velOut.set( Alembic::AbcGeom::V3fArraySample( velocities ) );
+    output.velocities.set( Alembic::AbcGeom::V3fArraySample( data.velocities ) );
     // Geometry Parameters handling
-    SetPointFloatAttributesData<Alembic::AbcGeom::OFloatGeomParam>(densities.data(),
-    															   densities.size(),
-																   _geometry_parameter_scope,
-																   density_geom_param);
-    if (is_bifrost_liquid_file)
+    for (size_t i=0;i<data.arb_geom_params.size();i++)
+    {
+        const ArbGeomParamData& param_data = data.arb_geom_params[i];
+        write_arb_geom_param(output,param_data.name,param_data.data_type,param_data.data.data(),param_data.count);
+    }
+    finish_point_sample(output);
+}
+
+bool Bifrost2Alembic::stream_point_component(const Bifrost::API::Component& component,
+											 PointComponentOutput& output)
+{
+    PointChannels channels;
+    if (!get_point_channels(component,channels))
+    	return false;
+
+    Bifrost::API::Layout layout = component.layout();
+    const float _MVS = layout.voxelScale();
+    TileTraversal traversal(component);
+    size_t particleCount = component.elementCount();
+    if (traversal.elementCount() != particleCount)
+    	return false;
+
+    /*!
+     * \remark Only two buffers are allocated, once, and each channel is
+     *         written out to Alembic as soon as it is gathered. The vector
+     *         buffer is reused for velocities, then as raw storage for the
+     *         arbGeomParams, whose elements are at most 12 bytes
+     */
+    std::vector< Alembic::Abc::V3f > vectors(particleCount);
+    std::vector< Alembic::Util::uint64_t > ids(particleCount);
+    void* scratch = particleCount ? static_cast<void*>(&vectors[0]) : 0;
+
+    // Position and id
+    if (particleCount && !gather_channel(traversal,channels.position_ch,&vectors[0],particleCount))
+    	return false;
+    bool has_id_channel = channels.id_ch.valid();
+    if (particleCount && has_id_channel && !gather_channel(traversal,channels.id_ch,&ids[0],particleCount))
+    	return false;
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        scale_points(&vectors[tile.elementOffset].x,tile.elementCount,_MVS);
+        if (!has_id_channel)
+        {
+            for (size_t pindex=tile.elementOffset; pindex<tile.elementOffset+tile.elementCount; pindex++ )
+            {
+                ids[pindex] = pindex;
+            }
+        }
+    });
+    Alembic::AbcGeom::OPointsSchema::Sample psamp(Alembic::AbcGeom::V3fArraySample( vectors ),
+												  Alembic::AbcGeom::UInt64ArraySample( ids ));
+    output.points.getSchema().set( psamp );
+    std::vector< Alembic::Util::uint64_t >().swap(ids);
+
+    /*!
+     * \note The points are set for this sample from here on : returning false
+     *       would have the caller write a second sample for the same frame,
+     *       so a failing channel is written empty and the sample completed
+     */
+
+    // Velocity
+    if (particleCount && !gather_channel(traversal,channels.velocity_ch,&vectors[0],particleCount))
     {
-    	// Vorticity
-        SetPointFloatAttributesData<Alembic::AbcGeom::OFloatGeomParam>(vorticities.data(),
-        															   vorticities.size(),
-    																   _geometry_parameter_scope,
-    																   vorticity_geom_param);
-    	// Droplet
-        SetPointFloatAttributesData<Alembic::AbcGeom::OFloatGeomParam>(droplets.data(),
-        															   droplets.size(),
-    																   _geometry_parameter_scope,
-    																   droplet_geom_param);
+        std::cerr << boost::format("Unable to gather channel '%1%' of component \"%2%\", left empty") % channels.velocity_ch.name().c_str() % component.name().c_str() << std::endl;
+        output.velocities.set( Alembic::AbcGeom::V3fArraySample( std::vector< Alembic::Abc::V3f >() ) );
     }
+    else
+        output.velocities.set( Alembic::AbcGeom::V3fArraySample( vectors ) );
+
+    // Geometry Parameters handling, finish_point_sample() pads the ones skipped
+    for (size_t i=0;i<channels.arb_geom_param_channels.size();i++)
+    {
+        const ArbGeomParamChannel& param_channel = channels.arb_geom_param_channels[i];
+        if (data_type_size(param_channel.channel.dataType())>sizeof(Alembic::Abc::V3f))
+            continue;
+        if (particleCount && !gather_channel(traversal,param_channel.channel,scratch,particleCount))
+        {
+            std::cerr << boost::format("Unable to gather channel '%1%' of component \"%2%\", left empty") % param_channel.channel.name().c_str() % component.name().c_str() << std::endl;
+            continue;
+        }
+        write_arb_geom_param(output,param_channel.name,param_channel.channel.dataType(),scratch,particleCount);
+    }
+    finish_point_sample(output);
+    return true;
+}
+
+
+std::string alembic_partial_filename(const std::string& alembic_filename)
+{
+	return alembic_filename + ".partial";
+}
+
+bool finish_alembic_output(const std::string& alembic_filename, bool status)
+{
+	std::string partial = alembic_partial_filename(alembic_filename);
+	if (!status)
+	{
+		remove(partial.c_str());
+		return false;
+	}
+	if (!std::ifstream(partial.c_str()))
+		return true; // nothing to write, e.g. a single file without components
+	remove(alembic_filename.c_str());
+	if (rename(partial.c_str(),alembic_filename.c_str())!=0)
+	{
+		std::cerr << boost::format("Unable to rename \"%1%\" to \"%2%\"") % partial % alembic_filename << std::endl;
+		return false;
+	}
 	return true;
 }
 
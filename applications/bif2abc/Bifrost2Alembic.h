@@ -2,10 +2,13 @@
 #include <string>
 #include <stdlib.h>
 #include <utils/BifrostUtils.h>
+#include <utils/PointKernels.h>
+#include <utils/FrameUtils.h>
 #include <boost/format.hpp>
 #include <boost/program_options.hpp>
 #include <boost/shared_ptr.hpp>
 #include <iostream>
+#include <map>
 #include <strstream>
 #include <stdexcept>
 #include <OpenEXR/ImathBox.h>
@@ -26,26 +29,163 @@
 /*!
  * \brief Class to hold the translator state when extracting data from Bifrost
  *        file for export to Alembic
- * \note Position and velocity parameters are standard so not added as geom_param
+ * \note Position, velocity and id are standard so not added as geom_param, every
+ *       other channel of a supported type is exported as a typed arbGeomParam
+ * \note Each frame goes through load_frame(), convert_frame() and write_frame().
+ *       Load and convert only read the translator settings so several frames
+ *       (or several translators) can be loaded and converted concurrently,
+ *       write_frame() must be called in frame order from one thread at a time
  */
 class Bifrost2Alembic
 {
     typedef boost::shared_ptr<void> GeomParmPtr;
-    GeomParmPtr density_geom_param;   // scalar
-    GeomParmPtr vorticity_geom_param; // vector
-    GeomParmPtr droplet_geom_param;   //scalar
+    /*! \brief One arbGeomParam, which may appear after the first frame */
+    struct ArbGeomParamOutput
+    {
+        ArbGeomParamOutput()
+        : data_type(Bifrost::API::NoneType)
+        , sample_count(0)
+        {}
+        GeomParmPtr            geom_param;
+        Bifrost::API::DataType data_type;
+        size_t                 sample_count;
+    };
+    typedef std::map<std::string,ArbGeomParamOutput> ArbGeomParamOutputMap;
+    /*!
+     * \brief Alembic objects of one point component, created on the first
+     *        frame the component appears in and sampled once per frame
+     */
+    struct PointComponentOutput
+    {
+        PointComponentOutput(Alembic::AbcGeom::OXform& xform,
+                             const std::string& name,
+                             uint32_t tsidx)
+        : points(xform,name.c_str(),tsidx)
+        , sample_count(0)
+        {}
+        Alembic::AbcGeom::OPoints           points;
+        Alembic::AbcGeom::OV3fArrayProperty velocities;
+        ArbGeomParamOutputMap               arb_geom_params;
+        size_t                              sample_count;
+    };
+    typedef boost::shared_ptr<PointComponentOutput> PointComponentOutputPtr;
+    typedef std::map<std::string,PointComponentOutputPtr> PointComponentOutputMap;
+    /*! \brief A channel exported as arbGeomParam, with its Alembic name */
+    struct ArbGeomParamChannel
+    {
+        ArbGeomParamChannel(const std::string& i_name,
+                            const Bifrost::API::Channel& i_channel)
+        : name(i_name)
+        , channel(i_channel)
+        {}
+        std::string           name;
+        Bifrost::API::Channel channel;
+    };
+    typedef std::vector<ArbGeomParamChannel> ArbGeomParamChannelContainer;
+    /*! \brief Channels of a point component, id_ch is invalid if there is no id channel */
+    struct PointChannels
+    {
+        Bifrost::API::Channel        position_ch;
+        Bifrost::API::Channel        velocity_ch;
+        Bifrost::API::Channel        id_ch;
+        ArbGeomParamChannelContainer arb_geom_param_channels;
+    };
     static Alembic::AbcGeom::GeometryScope _geometry_parameter_scope;
 public:
+	/*! \brief Loaded content of one Bifrost file */
+	struct LoadedFrame
+	{
+		LoadedFrame()
+		: frame_index(0)
+		{}
+		size_t                    frame_index;
+		std::string               bifrost_filename;
+		Bifrost::API::ObjectModel om;
+		Bifrost::API::StateServer ss;
+	};
+
+	/*! \brief Gathered channel of any supported type, stored as raw bytes */
+	struct ArbGeomParamData
+	{
+		std::string                name;
+		Bifrost::API::DataType     data_type;
+		std::vector<unsigned char> data;
+		size_t                     count;
+	};
+	typedef std::vector<ArbGeomParamData> ArbGeomParamDataContainer;
+
+	/*! \brief Gathered and scaled channel data of one point component */
+	struct PointComponentData
+	{
+		PointComponentData()
+		: valid(false)
+		{}
+		std::string                            name;
+		bool                                   valid;
+		std::vector< Alembic::Abc::V3f >       positions;
+		std::vector< Alembic::Abc::V3f >       velocities;
+		std::vector< Alembic::Util::uint64_t > ids;
+		ArbGeomParamDataContainer              arb_geom_params;
+		Imath::Box3f                           bounds;
+	};
+	typedef std::vector<PointComponentData> PointComponentDataContainer;
+
+	/*! \brief One frame ready to be written, independent of the Bifrost state server */
+	struct ConvertedFrame
+	{
+		ConvertedFrame()
+		: frame_index(0)
+		, component_count(0)
+		{}
+		size_t                      frame_index;
+		std::string                 bifrost_filename;
+		size_t                      component_count;
+		PointComponentDataContainer point_components;
+	};
+
+	/*!
+	 * \note The density, vorticity and droplet channels are exported under
+	 *       those names whatever their Bifrost name, other channels under
+	 *       the last part of their Bifrost name
+	 */
 	Bifrost2Alembic(const std::string& bifrost_filename,
 					const std::string& alembic_filename,
 					const std::string& position_channel_name,
 					const std::string& velocity_channel_name,
+					const std::string& id_channel_name,
 					const std::string& density_channel_name,
 					const std::string& vorticity_channel_name,
 					const std::string& droplet_channel_name,
-					bool enable_hdf5_alembic = false);
+					bool enable_hdf5_alembic = false,
+					float fps = 24.0f);
 	virtual ~Bifrost2Alembic();
+	/*!
+	 * \brief Converts a frame sequence into a single animated archive, the
+	 *        Bifrost filename is then a pattern such as "liquid.%04d.bif"
+	 */
+	void set_frame_range(const FrameRange& frame_range);
+	/*!
+	 * \brief Writes each channel to Alembic as soon as it is gathered, through
+	 *        buffers allocated once per component, instead of gathering all
+	 *        channels before writing. Lowers the peak memory at the cost of
+	 *        serializing gathering and writing
+	 */
+	void set_low_memory_mode(bool low_memory_mode);
+	bool low_memory_mode() const { return _low_memory_mode; }
 	bool translate();
+
+	size_t frame_count() const;
+	std::string frame_filename(size_t frame_index) const;
+	const std::string& alembic_filename() const { return _alembic_filename; }
+
+	bool load_frame(size_t frame_index, LoadedFrame& o_frame) const;
+	/*! \note Releases the frame's state server once its channels are gathered */
+	bool convert_frame(LoadedFrame& io_frame, ConvertedFrame& o_frame) const;
+	bool write_frame(const ConvertedFrame& frame);
+	/*! \brief Low memory alternative to convert_frame() and write_frame() */
+	bool stream_frame(LoadedFrame& io_frame);
+	/*! \brief Finalizes and closes the archive */
+	void close();
 protected:
 
 	template <class O_GEOM_PARAM>
@@ -64,45 +204,116 @@ protected:
 
     }
 
+	/*!
+	 * \note data must hold data_size values of the geom param's value type,
+	 *       Bifrost and Imath vector types share the same memory layout
+	 */
 	template <class O_GEOM_PARAM>
-    void SetPointFloatAttributesData(const float* data,
-    								 size_t data_size,
-									 Alembic::AbcGeom::GeometryScope& i_geometry_parameter_scope,
-									 GeomParmPtr& o_geom_parm)
+    void SetPointAttributesData(const void* data,
+    							size_t data_size,
+								Alembic::AbcGeom::GeometryScope& i_geometry_parameter_scope,
+								GeomParmPtr& o_geom_parm)
     {
         if (o_geom_parm.get())
         {
-            Alembic::AbcGeom::FloatArraySample array_sample( data, data_size );
-            Alembic::AbcGeom::OFloatGeomParam::Sample dataSamp( array_sample, i_geometry_parameter_scope );
+            typedef typename O_GEOM_PARAM::prop_type::sample_type ArraySample;
+            ArraySample array_sample( static_cast<const typename O_GEOM_PARAM::value_type*>(data), data_size );
+            typename O_GEOM_PARAM::Sample dataSamp( array_sample, i_geometry_parameter_scope );
 
             boost::static_pointer_cast<O_GEOM_PARAM>(o_geom_parm)->set(dataSamp);
         }
     }
 
+	/*! \brief Typed dispatch of the two templates above over the Bifrost data type */
+	struct AddArbGeomParamFunctor;
+	struct SetArbGeomParamFunctor;
+	bool AddArbGeomParam(Bifrost::API::DataType data_type,
+						 const std::string& i_geom_param_name,
+						 Alembic::AbcGeom::OPointsSchema &o_pSchema,
+						 GeomParmPtr& o_geom_parm);
+	bool SetArbGeomParamData(Bifrost::API::DataType data_type,
+							 const void* data,
+							 size_t data_size,
+							 GeomParmPtr& o_geom_parm);
+
 	Alembic::AbcGeom::OXform addXform(Alembic::Abc::OObject parent,
 									  std::string name);
 
-	bool process_point_component(bool is_bifrost_liquid_file,
-								 const Bifrost::API::Component& component,
-								 const std::string& position_channel_name,
-								 const std::string& velocity_channel_name,
-								 const std::string& density_channel_name,
-								 const std::string& vorticity_channel_name,
-								 const std::string& droplet_channel_name,
-								 Imath::Box3f& bounds,
-								 uint32_t tsidx,
-								 Alembic::AbcGeom::OXform& xform);
+	bool open_archive();
+
+	bool begin_frame(size_t component_count, const std::string& bifrost_filename);
+	/*! \return 0 if the component was already written for this frame */
+	PointComponentOutput* frame_point_output(size_t frame_index,
+											 const std::string& component_name);
+	void end_frame(size_t frame_index, const std::string& bifrost_filename);
+
+	PointComponentOutputPtr create_point_component_output(const std::string& component_name,
+														   uint32_t tsidx,
+														   Alembic::AbcGeom::OXform& xform);
+
+	/*! \brief Sets one arbGeomParam for the current sample, creating it if needed */
+	void write_arb_geom_param(PointComponentOutput& output,
+							  const std::string& name,
+							  Bifrost::API::DataType data_type,
+							  const void* data,
+							  size_t data_size);
+	/*! \brief Pads the arbGeomParams not set for the current sample and moves to the next sample */
+	void finish_point_sample(PointComponentOutput& output);
+	/*! \brief Empty sample for frames where a component has no data */
+	void write_empty_point_sample(PointComponentOutput& output);
+
+	bool get_point_channels(const Bifrost::API::Component& component,
+							PointChannels& o_channels) const;
+
+	bool process_point_component(const Bifrost::API::Component& component,
+								 PointComponentData& o_data) const;
+
+	void write_point_component(const PointComponentData& data,
+							   PointComponentOutput& output);
+
+	/*!
+	 * \brief Gathers and writes one channel at a time
+	 * \return false only when nothing was written for this sample, once the
+	 *         points are set a failing channel is written empty instead
+	 */
+	bool stream_point_component(const Bifrost::API::Component& component,
+								PointComponentOutput& output);
 private:
 	std::string _bifrost_filename;
 	std::string _alembic_filename;
 	std::string _position_channel_name;
 	std::string _velocity_channel_name;
+	std::string _id_channel_name;
 	std::string _density_channel_name;
 	std::string _vorticity_channel_name;
 	std::string _droplet_channel_name;
 	bool        _enable_hdf5_alembic;
+	float       _fps;
+	bool        _is_frame_sequence;
+	bool        _low_memory_mode;
+	FrameRange  _frame_range;
+
+	// Writer state, destroyed in reverse order of declaration
+	boost::shared_ptr<Alembic::AbcGeom::OArchive> _archive_ptr;
+	Alembic::AbcGeom::OXform                      _xform;
+	uint32_t                                      _tsidx;
+	PointComponentOutputMap                       _point_outputs;
 };
 
+/*!
+ * \brief Archives are written under a temporary name and only renamed once
+ *        complete, a failed conversion does not leave a truncated archive
+ *        that looks valid behind
+ */
+std::string alembic_partial_filename(const std::string& alembic_filename);
+
+/*!
+ * \brief Renames a complete archive written to alembic_partial_filename()
+ *        in place, or removes it when status is false
+ * \return false if status is false or the rename failed
+ */
+bool finish_alembic_output(const std::string& alembic_filename, bool status);
+
 // == Emacs ================
 // -------------------------
 // Local variables:
@@ -0,0 +1,198 @@
+#include "Bifrost2AlembicBatch.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <tbb/pipeline.h>
+#include <tbb/atomic.h>
+
+namespace {
+
+typedef boost::shared_ptr<Bifrost2Alembic> Bifrost2AlembicPtr;
+
+/*! \brief One frame of one job, as it travels through the pipeline */
+struct BatchItem
+{
+	BatchItem(size_t i_job_index, size_t i_frame_index, bool i_is_last_frame)
+	: job_index(i_job_index)
+	, frame_index(i_frame_index)
+	, is_last_frame(i_is_last_frame)
+	, status(false)
+	{}
+	size_t                          job_index;
+	size_t                          frame_index;
+	bool                            is_last_frame;
+	bool                            status;
+	Bifrost2Alembic::LoadedFrame    loaded_frame;
+	Bifrost2Alembic::ConvertedFrame converted_frame;
+};
+
+/*!
+ * \brief Estimated peak memory of a frame in flight, the loaded state server
+ *        plus the gathered copy of its channels (unless streamed), from the
+ *        file header
+ */
+size_t estimate_frame_bytes(const std::string& bifrost_filename, bool low_memory_mode)
+{
+	Bifrost::API::ObjectModel om;
+	Bifrost::API::FileIO fileio = om.createFileIO( bifrost_filename.c_str() );
+	return (low_memory_mode ? 1 : 2) * estimate_payload_bytes(fileio);
+}
+
+void report_job(const Bifrost2AlembicJob& job, bool status)
+{
+	std::cout << boost::format("%1% : %2%") % (status ? "Done" : "FAILED") % job.alembic_filename << std::endl;
+}
+
+} // anonymous namespace
+
+bool read_bif2abc_manifest(const std::string& manifest_filename,
+						   Bifrost2AlembicJobContainer& o_jobs)
+{
+	std::ifstream manifest(manifest_filename.c_str());
+	if (!manifest)
+	{
+		std::cerr << boost::format("Unable to open the manifest \"%1%\"") % manifest_filename << std::endl;
+		return false;
+	}
+	std::string line;
+	size_t line_number = 0;
+	while (std::getline(manifest,line))
+	{
+		line_number++;
+		std::istringstream fields(line);
+		Bifrost2AlembicJob job;
+		if (!(fields >> job.bifrost_filename) || job.bifrost_filename[0]=='#')
+			continue;
+		if (!(fields >> job.alembic_filename))
+		{
+			std::cerr << boost::format("%1%:%2% : expecting \"input.bif output.abc [frames]\"") % manifest_filename % line_number << std::endl;
+			return false;
+		}
+		fields >> job.frame_range_string;
+		o_jobs.push_back(job);
+	}
+	return true;
+}
+
+bool translate_batch(const Bifrost2AlembicJobContainer& jobs,
+					 const Bifrost2AlembicBatchSettings& settings)
+{
+	// One translator per job, the frames of all jobs are queued back to back
+	std::vector<Bifrost2AlembicPtr> translators;
+	// Set by the writer, read by the input and loading stages to drop the remaining frames
+	std::vector< tbb::atomic<bool> > job_failed(jobs.size());
+	for (size_t jobIndex=0;jobIndex<jobs.size();jobIndex++)
+		job_failed[jobIndex] = false;
+	std::vector< std::pair<size_t,size_t> > work_units; // (job,frame)
+	size_t max_frame_bytes = 0;
+	for (size_t jobIndex=0;jobIndex<jobs.size();jobIndex++)
+	{
+		const Bifrost2AlembicJob& job = jobs[jobIndex];
+		Bifrost2AlembicPtr translator(new Bifrost2Alembic(job.bifrost_filename,
+														  alembic_partial_filename(job.alembic_filename),
+														  settings.position_channel_name,
+														  settings.velocity_channel_name,
+														  settings.id_channel_name,
+														  settings.density_channel_name,
+														  settings.vorticity_channel_name,
+														  settings.droplet_channel_name,
+														  settings.enable_hdf5_alembic,
+														  settings.fps));
+		translator->set_low_memory_mode(settings.low_memory_mode);
+		translators.push_back(translator);
+		if (!job.frame_range_string.empty())
+		{
+			FrameRange frame_range;
+			if (!parse_frame_range(job.frame_range_string,frame_range))
+			{
+				std::cerr << boost::format("Invalid frame range '%1%' for \"%2%\"") % job.frame_range_string % job.bifrost_filename << std::endl;
+				job_failed[jobIndex] = true;
+				report_job(job,false);
+				continue;
+			}
+			translator->set_frame_range(frame_range);
+		}
+		size_t frameCount = translator->frame_count();
+		for (size_t frameIndex=0;frameIndex<frameCount;frameIndex++)
+			work_units.push_back(std::make_pair(jobIndex,frameIndex));
+		// Frames of a sequence are expected to be of similar size
+		if (frameCount>0 && settings.memory_cap>0)
+			max_frame_bytes = std::max(max_frame_bytes,estimate_frame_bytes(translator->frame_filename(0),settings.low_memory_mode));
+	}
+
+	size_t max_tokens = std::max(settings.prefetch_depth,size_t(1));
+	if (settings.memory_cap>0 && max_frame_bytes>0)
+		max_tokens = std::max(std::min(max_tokens,settings.memory_cap/max_frame_bytes),size_t(1));
+
+	size_t next_work_unit = 0;
+	tbb::parallel_pipeline(max_tokens,
+		tbb::make_filter<void,BatchItem*>(tbb::filter::serial_in_order,
+			[&](tbb::flow_control& fc) -> BatchItem* {
+				while (next_work_unit<work_units.size() && job_failed[work_units[next_work_unit].first])
+					next_work_unit++;
+				if (next_work_unit>=work_units.size())
+				{
+					fc.stop();
+					return 0;
+				}
+				size_t jobIndex = work_units[next_work_unit].first;
+				size_t frameIndex = work_units[next_work_unit].second;
+				next_work_unit++;
+				return new BatchItem(jobIndex,frameIndex,frameIndex+1==translators[jobIndex]->frame_count());
+			})
+		&
+		tbb::make_filter<BatchItem*,BatchItem*>(tbb::filter::parallel,
+			[&](BatchItem* item) -> BatchItem* {
+				item->status = !job_failed[item->job_index]
+					&& translators[item->job_index]->load_frame(item->frame_index,item->loaded_frame);
+				return item;
+			})
+		&
+		tbb::make_filter<BatchItem*,BatchItem*>(tbb::filter::parallel,
+			[&](BatchItem* item) -> BatchItem* {
+				Bifrost2Alembic& translator = *translators[item->job_index];
+				if (item->status && !job_failed[item->job_index] && !translator.low_memory_mode())
+					item->status = translator.convert_frame(item->loaded_frame,item->converted_frame);
+				return item;
+			})
+		&
+		tbb::make_filter<BatchItem*,void>(tbb::filter::serial_in_order,
+			[&](BatchItem* item) {
+				Bifrost2Alembic& translator = *translators[item->job_index];
+				const Bifrost2AlembicJob& job = jobs[item->job_index];
+				// Frames of a failed job still in flight are dropped, the job is already reported
+				if (!job_failed[item->job_index])
+				{
+					if (item->status)
+						item->status = translator.low_memory_mode() ? translator.stream_frame(item->loaded_frame) : translator.write_frame(item->converted_frame);
+					if (!item->status || item->is_last_frame)
+					{
+						translator.close();
+						bool status = finish_alembic_output(job.alembic_filename,item->status);
+						job_failed[item->job_index] = !status;
+						report_job(job,status);
+					}
+				}
+				delete item;
+			})
+		);
+
+	for (size_t jobIndex=0;jobIndex<jobs.size();jobIndex++)
+		if (job_failed[jobIndex])
+			return false;
+	return true;
+}
+
+// == Emacs ================
+// -------------------------
+// Local variables:
+// tab-width: 4
+// indent-tabs-mode: t
+// c-basic-offset: 4
+// end:
+//
+// == vi ===================
+// -------------------------
+// Format block
+// ex:ts=4:sw=4:expandtab
+// -------------------------
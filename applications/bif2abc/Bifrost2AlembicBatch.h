@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Bifrost2Alembic.h"
+
+/*!
+ * \brief One archive to write, from a single Bifrost file or from a frame
+ *        sequence when frame_range_string is not empty
+ */
+struct Bifrost2AlembicJob
+{
+	std::string bifrost_filename;
+	std::string alembic_filename;
+	std::string frame_range_string;
+};
+typedef std::vector<Bifrost2AlembicJob> Bifrost2AlembicJobContainer;
+
+/*!
+ * \brief Settings shared by all the jobs of a batch
+ * \note memory_cap is in bytes, 0 for no limit
+ */
+struct Bifrost2AlembicBatchSettings
+{
+	Bifrost2AlembicBatchSettings()
+	: enable_hdf5_alembic(false)
+	, fps(24.0f)
+	, low_memory_mode(false)
+	, prefetch_depth(2)
+	, memory_cap(0)
+	{}
+	std::string position_channel_name;
+	std::string velocity_channel_name;
+	std::string id_channel_name;
+	std::string density_channel_name;
+	std::string vorticity_channel_name;
+	std::string droplet_channel_name;
+	bool        enable_hdf5_alembic;
+	float       fps;
+	bool        low_memory_mode; /*!< frames are then gathered by the writer stage */
+	size_t      prefetch_depth;
+	size_t      memory_cap;
+};
+
+/*!
+ * \brief Reads a manifest with one "input.bif output.abc [frames]" job per line
+ * \note Blank lines and lines starting with '#' are ignored
+ */
+bool read_bif2abc_manifest(const std::string& manifest_filename,
+						   Bifrost2AlembicJobContainer& o_jobs);
+
+/*!
+ * \brief Converts all the jobs through a load / convert / write pipeline
+ * \note Frames are loaded and converted concurrently, up to prefetch_depth
+ *       frames in flight (fewer if memory_cap would be exceeded), and
+ *       written by a single writer in submission order. Each archive is
+ *       written as "<output>.partial" and renamed once complete, the
+ *       remaining frames of a failed job are not loaded
+ * \return false if any job failed, the other jobs are still converted
+ */
+bool translate_batch(const Bifrost2AlembicJobContainer& jobs,
+					 const Bifrost2AlembicBatchSettings& settings);
+
+// == Emacs ================
+// -------------------------
+// Local variables:
+// tab-width: 4
+// indent-tabs-mode: t
+// c-basic-offset: 4
+// end:
+//
+// == vi ===================
+// -------------------------
+// Format block
+// ex:ts=4:sw=4:expandtab
+// -------------------------
@@ -6,6 +6,7 @@
 #include <stdexcept>
 #include <OpenEXR/ImathBox.h>
 #include <utils/BifrostUtils.h>
+#include <utils/FrameUtils.h>
 
 // Alembic headers - START
 #include <Alembic/AbcGeom/All.h>
@@ -20,6 +21,7 @@
 #include <BifrostHeaders.h>
 
 #include "Bifrost2Alembic.h"
+#include "Bifrost2AlembicBatch.h"
 
 namespace po = boost::program_options;
 
@@ -29,32 +31,48 @@ int main(int argc, char **argv)
         std::string density_channel_name("density");
         std::string position_channel_name("position");
         std::string velocity_channel_name("velocity");
+        std::string id_channel_name("id64");
         std::string vorticity_channel_name("vorticity");
         std::string droplet_channel_name("droplet");
         std::string bifrost_filename;
         std::string alembic_filename;
+        std::string frame_range_string;
+        std::string manifest_filename;
+        size_t prefetch_depth = 2;
+        size_t memory_cap_mb = 0;
         bool enable_hdf5_alembic = false;
         float fps = 24.0f;
         po::options_description desc("Allowed options");
         desc.add_options()
             ("help", "Produce help message")
             ("hdf5", "Enable HDF5 alembic instead of Ogawa. Defaults to Ogawa")
+            ("low-memory", "Write each channel as soon as it is read, through buffers allocated once per component, to lower the peak memory")
             ("fps", po::value<float>(&fps),
-             "Frames per second to scale velocity when determining the velocity-attenuated bounding box. Defaults to 24.0")
+             "Frames per second of the Alembic time sampling. Defaults to 24.0")
+            ("frames", po::value<std::string>(&frame_range_string),
+             "Frame range such as 1001-1240 or 1001-1240x2, the Bifrost file is then a pattern such as 'liquid.%04d.bif' or 'liquid.####.bif' and all frames are written to one animated archive")
             ("density", po::value<std::string>(&density_channel_name)->default_value(density_channel_name),
-             (boost::format("Density channel name. Defaults to '%1%'") % density_channel_name).str().c_str())
+             (boost::format("Density channel name, exported as arbGeomParam 'density'. Defaults to '%1%'") % density_channel_name).str().c_str())
 			("position", po::value<std::string>(&position_channel_name)->default_value(position_channel_name),
 		     (boost::format("Position channel name. Defaults to '%1%'") % position_channel_name).str().c_str())
 			("velocity", po::value<std::string>(&velocity_channel_name)->default_value(velocity_channel_name),
 		     (boost::format("Velocity channel name. Defaults to '%1%'") % velocity_channel_name).str().c_str())
+			("id", po::value<std::string>(&id_channel_name)->default_value(id_channel_name),
+		     (boost::format("Particle id channel name, used as the Alembic ids when present. Defaults to '%1%'") % id_channel_name).str().c_str())
 			("vorticity", po::value<std::string>(&vorticity_channel_name)->default_value(vorticity_channel_name),
-		     (boost::format("Vorticity channel name. Defaults to '%1%'") % vorticity_channel_name).str().c_str())
+		     (boost::format("Vorticity channel name, exported as arbGeomParam 'vorticity'. Defaults to '%1%'") % vorticity_channel_name).str().c_str())
 			("droplet", po::value<std::string>(&droplet_channel_name)->default_value(droplet_channel_name),
-		     (boost::format("Droplet channel name. Defaults to '%1%'") % droplet_channel_name).str().c_str())
+		     (boost::format("Droplet channel name, exported as arbGeomParam 'droplet'. Defaults to '%1%'") % droplet_channel_name).str().c_str())
             ("bif", po::value<std::string>(&bifrost_filename),
-             "Bifrost file. [Required]")
+             "Bifrost file, or file pattern with --frames. [Required]")
             ("abc", po::value<std::string>(&alembic_filename),
              "Alembic file. [Required]")
+            ("manifest", po::value<std::string>(&manifest_filename),
+             "Batch conversion, one 'input.bif output.abc [frames]' job per line. Replaces --bif, --abc and --frames")
+            ("prefetch", po::value<size_t>(&prefetch_depth)->default_value(prefetch_depth),
+             "Batch conversion : number of frames loaded or converted ahead of the Alembic writer")
+            ("memory-cap", po::value<size_t>(&memory_cap_mb)->default_value(memory_cap_mb),
+             "Batch conversion : limit in MB of the frames in flight, estimated from the file headers. 0 for no limit")
             ;
 
         po::variables_map vm;
@@ -62,22 +80,63 @@ int main(int argc, char **argv)
 
         po::notify(vm);
 
-        if (vm.count("help") || bifrost_filename.empty() || alembic_filename.empty()) {
+        bool is_batch = !manifest_filename.empty();
+        if (vm.count("help") || (!is_batch && (bifrost_filename.empty() || alembic_filename.empty()))) {
             std::cout << desc << "\n";
             return 1;
         }
         if (vm.count("hdf5")) {
         	enable_hdf5_alembic = true;
         }
+        if (fps<=0.0f) {
+            std::cerr << boost::format("Invalid fps %1%") % fps << std::endl;
+            return 1;
+        }
+        if (is_batch) {
+            Bifrost2AlembicJobContainer jobs;
+            if (!read_bif2abc_manifest(manifest_filename,jobs))
+                return 1;
+            Bifrost2AlembicBatchSettings settings;
+            settings.position_channel_name = position_channel_name;
+            settings.velocity_channel_name = velocity_channel_name;
+            settings.id_channel_name = id_channel_name;
+            settings.density_channel_name = density_channel_name;
+            settings.vorticity_channel_name = vorticity_channel_name;
+            settings.droplet_channel_name = droplet_channel_name;
+            settings.enable_hdf5_alembic = enable_hdf5_alembic;
+            settings.fps = fps;
+            settings.low_memory_mode = vm.count("low-memory") > 0;
+            settings.prefetch_depth = prefetch_depth;
+            settings.memory_cap = memory_cap_mb * 1024 * 1024;
+            return translate_batch(jobs,settings) ? 0 : 1;
+        }
+        FrameRange frame_range;
+        if (!frame_range_string.empty()) {
+            if (!parse_frame_range(frame_range_string,frame_range)) {
+                std::cerr << boost::format("Invalid frame range '%1%', expecting first-last or first-lastxstep") % frame_range_string << std::endl;
+                return 1;
+            }
+            if (!has_frame_pattern(bifrost_filename)) {
+                std::cerr << boost::format("Bifrost file '%1%' has no frame pattern (e.g. %%04d or ####) for --frames") % bifrost_filename << std::endl;
+                return 1;
+            }
+        }
 
         Bifrost2Alembic b2a(bifrost_filename,
-        					alembic_filename,
+        					alembic_partial_filename(alembic_filename),
 							position_channel_name,
 							velocity_channel_name,
+							id_channel_name,
 							density_channel_name,
 							vorticity_channel_name,
-							droplet_channel_name);
-        b2a.translate();
+							droplet_channel_name,
+							enable_hdf5_alembic,
+							fps);
+        if (!frame_range_string.empty())
+            b2a.set_frame_range(frame_range);
+        b2a.set_low_memory_mode(vm.count("low-memory") > 0);
+        if (!finish_alembic_output(alembic_filename,b2a.translate()))
+            return 1;
     }
     catch(std::exception& e) {
         std::cerr << "error: " << e.what() << "\n";
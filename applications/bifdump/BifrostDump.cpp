@@ -0,0 +1,645 @@
+#include "BifrostDump.h"
+#include <utils/ChannelStats.h>
+#include <utils/PointKernels.h>
+#include <boost/format.hpp>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+namespace {
+
+const uint32_t DUMP_FORMAT_VERSION = 1;
+const char     RAW_MAGIC[4]      = { 'B', 'I', 'F', 'R' };
+const char     COLUMNAR_MAGIC[4] = { 'B', 'C', 'O', 'L' };
+const size_t   COLUMN_ALIGNMENT  = 64;
+const size_t   FILE_BUFFER_SIZE  = 1<<20;
+
+/*!
+ * \brief Calls op.template apply<T>() with the scalar type of a numeric
+ *        data type, e.g. float for FloatV3Type
+ * \return false for the string-like types
+ */
+template<typename Op>
+bool dispatch_scalar_type(Bifrost::API::DataType data_type, Op& op)
+{
+    switch (data_type)
+    {
+    case Bifrost::API::FloatType :
+    case Bifrost::API::FloatV2Type :
+    case Bifrost::API::FloatV3Type :
+#if BIFROST_VERSION >= 20
+    case Bifrost::API::FloatV4Type :
+    case Bifrost::API::FloatMat44Type :
+#endif // BIFROST_VERSION >= 20
+        op.template apply<float>();
+        return true;
+    case Bifrost::API::Int32Type :
+    case Bifrost::API::Int32V2Type :
+    case Bifrost::API::Int32V3Type :
+        op.template apply<int32_t>();
+        return true;
+    case Bifrost::API::Int64Type :
+        op.template apply<int64_t>();
+        return true;
+    case Bifrost::API::UInt32Type :
+        op.template apply<uint32_t>();
+        return true;
+    case Bifrost::API::UInt64Type :
+#if BIFROST_VERSION >= 20
+    case Bifrost::API::UInt64V2Type :
+    case Bifrost::API::UInt64V3Type :
+    case Bifrost::API::UInt64V4Type :
+#endif // BIFROST_VERSION >= 20
+        op.template apply<uint64_t>();
+        return true;
+#if BIFROST_VERSION >= 20
+    case Bifrost::API::Int8Type :
+        op.template apply<int8_t>();
+        return true;
+    case Bifrost::API::Int16Type :
+        op.template apply<int16_t>();
+        return true;
+    case Bifrost::API::UInt8Type :
+        op.template apply<uint8_t>();
+        return true;
+    case Bifrost::API::UInt16Type :
+        op.template apply<uint16_t>();
+        return true;
+    case Bifrost::API::BoolType :
+        op.template apply<bool>();
+        return true;
+#endif // BIFROST_VERSION >= 20
+    default:
+        return false;
+    }
+}
+
+bool is_string_type(Bifrost::API::DataType data_type)
+{
+#if BIFROST_VERSION >= 20
+    return data_type == Bifrost::API::StringClassType
+        || data_type == Bifrost::API::DictionaryClassType
+        || data_type == Bifrost::API::StringArrayClassType;
+#else
+    return false;
+#endif // BIFROST_VERSION >= 20
+}
+
+// 8 bit integers and bool are printed as numbers, not characters
+inline void print_value(std::ostream& os, float value)    { os << value; }
+inline void print_value(std::ostream& os, int32_t value)  { os << value; }
+inline void print_value(std::ostream& os, int64_t value)  { os << value; }
+inline void print_value(std::ostream& os, uint32_t value) { os << value; }
+inline void print_value(std::ostream& os, uint64_t value) { os << value; }
+inline void print_value(std::ostream& os, int16_t value)  { os << value; }
+inline void print_value(std::ostream& os, uint16_t value) { os << value; }
+inline void print_value(std::ostream& os, int8_t value)   { os << int(value); }
+inline void print_value(std::ostream& os, uint8_t value)  { os << int(value); }
+inline void print_value(std::ostream& os, bool value)     { os << int(value); }
+
+/*! \brief Prints the components of elements [begin,end) */
+struct PrintElements
+{
+    PrintElements(const ChannelBuffer& i_buffer, std::ostream& i_os,
+                  size_t i_begin, size_t i_end,
+                  const char* i_prefix, char i_separator)
+    : buffer(i_buffer), os(i_os), begin(i_begin), end(i_end)
+    , prefix(i_prefix), separator(i_separator)
+    {}
+    template<typename T>
+    void apply()
+    {
+        const T* values = reinterpret_cast<const T*>(&buffer.data[0]);
+        for (size_t i=begin;i<end;i++)
+        {
+            os << prefix;
+            for (size_t c=0;c<buffer.components;c++)
+            {
+                if (c)
+                    os << separator;
+                print_value(os,values[i*buffer.components+c]);
+            }
+            os << '\n';
+        }
+    }
+    const ChannelBuffer& buffer;
+    std::ostream&        os;
+    size_t               begin;
+    size_t               end;
+    const char*          prefix;
+    char                 separator;
+};
+
+void print_elements(const ChannelBuffer& buffer, std::ostream& os,
+                    size_t begin, size_t end,
+                    const char* prefix, char separator)
+{
+    if (buffer.is_string())
+    {
+        for (size_t i=begin;i<end;i++)
+            os << prefix << buffer.strings[i] << '\n';
+        return;
+    }
+    if (buffer.data.empty())
+        return;
+    PrintElements printer(buffer,os,begin,end,prefix,separator);
+    dispatch_scalar_type(buffer.data_type,printer);
+}
+
+/*! \brief NumPy type description of the scalar type, e.g. "<f4" */
+struct NumpyDescr
+{
+    template<typename T> void apply() { descr = describe(T()); }
+
+    static bool little_endian()
+    {
+        const uint16_t probe = 1;
+        return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+    }
+    static std::string sized(char kind, size_t size)
+    {
+        return (boost::format("%1%%2%%3%") % (size==1 ? '|' : (little_endian() ? '<' : '>')) % kind % size).str();
+    }
+    static std::string describe(float)    { return sized('f',4); }
+    static std::string describe(int32_t)  { return sized('i',4); }
+    static std::string describe(int64_t)  { return sized('i',8); }
+    static std::string describe(uint32_t) { return sized('u',4); }
+    static std::string describe(uint64_t) { return sized('u',8); }
+    static std::string describe(int16_t)  { return sized('i',2); }
+    static std::string describe(uint16_t) { return sized('u',2); }
+    static std::string describe(int8_t)   { return sized('i',1); }
+    static std::string describe(uint8_t)  { return sized('u',1); }
+    static std::string describe(bool)     { return sized('b',1); }
+    std::string descr;
+};
+
+FILE* open_buffered(const std::string& filename)
+{
+    FILE* file = fopen(filename.c_str(),"wb");
+    if (file)
+        setvbuf(file,0,_IOFBF,FILE_BUFFER_SIZE);
+    return file;
+}
+
+/*! \brief uint32 length prefixed strings, returns the number of bytes written */
+uint64_t write_strings(const std::vector<std::string>& strings, FILE* file, bool& io_status)
+{
+    uint64_t size = 0;
+    for (size_t i=0;io_status && i<strings.size();i++)
+    {
+        uint32_t length = uint32_t(strings[i].size());
+        io_status = fwrite(&length,sizeof(length),1,file)==1
+            && (length==0 || fwrite(strings[i].data(),1,length,file)==length);
+        size += sizeof(length) + length;
+    }
+    return size;
+}
+
+/*! \brief Gathers the string-like channels, one tile per task */
+bool gather_strings(const TileTraversal& traversal,
+                    const Bifrost::API::Channel& channel,
+                    std::vector<std::string>& o_strings)
+{
+    o_strings.resize(traversal.elementCount());
+#if BIFROST_VERSION >= 20
+    const Bifrost::API::DataType data_type = channel.dataType();
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        switch (data_type)
+        {
+        case Bifrost::API::StringClassType :
+            {
+                const Bifrost::API::TileData<Bifrost::API::String>& tile_data = channel.tileData<Bifrost::API::String>( tile.index );
+                for (size_t i=0;i<tile_data.count() && i<tile.elementCount;i++)
+                    o_strings[tile.elementOffset+i] = tile_data[i].c_str();
+            }
+            break;
+        case Bifrost::API::DictionaryClassType :
+            {
+                const Bifrost::API::TileData<Bifrost::API::Dictionary>& tile_data = channel.tileData<Bifrost::API::Dictionary>( tile.index );
+                for (size_t i=0;i<tile_data.count() && i<tile.elementCount;i++)
+                    o_strings[tile.elementOffset+i] = tile_data[i].saveJSON().c_str();
+            }
+            break;
+        case Bifrost::API::StringArrayClassType :
+            {
+                const Bifrost::API::TileData<Bifrost::API::StringArray>& tile_data = channel.tileData<Bifrost::API::StringArray>( tile.index );
+                for (size_t i=0;i<tile_data.count() && i<tile.elementCount;i++)
+                {
+                    const Bifrost::API::StringArray& string_array = tile_data[i];
+                    std::string& joined = o_strings[tile.elementOffset+i];
+                    for (size_t k=0;k<string_array.count();k++)
+                    {
+                        if (k)
+                            joined += '\n';
+                        joined += string_array[k].c_str();
+                    }
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    });
+    return true;
+#else
+    return false;
+#endif // BIFROST_VERSION >= 20
+}
+
+bool overlaps(const BoundsCacheBox& a, const BoundsCacheBox& b)
+{
+    for (int axis=0;axis<3;axis++)
+        if (a.max[axis]<b.min[axis] || a.min[axis]>b.max[axis])
+            return false;
+    return true;
+}
+
+bool parse_index(const std::string& i_string, size_t& o_index)
+{
+    if (i_string.empty() || i_string.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    o_index = size_t(strtoull(i_string.c_str(),0,10));
+    return true;
+}
+
+} // anonymous namespace
+
+bool parse_dump_format(const std::string& i_format_string, DumpFormat& o_format)
+{
+    if (i_format_string == "text")
+        o_format = DumpText;
+    else if (i_format_string == "csv")
+        o_format = DumpCSV;
+    else if (i_format_string == "raw")
+        o_format = DumpRaw;
+    else if (i_format_string == "npy")
+        o_format = DumpNPY;
+    else if (i_format_string == "columnar")
+        o_format = DumpColumnar;
+    else
+        return false;
+    return true;
+}
+
+bool gather_channel_buffer(const TileTraversal& traversal,
+                           const Bifrost::API::Channel& channel,
+                           ChannelBuffer& o_buffer)
+{
+    o_buffer.name = channel.name().c_str();
+    o_buffer.data_type = channel.dataType();
+    o_buffer.element_count = traversal.elementCount();
+    o_buffer.data.clear();
+    o_buffer.strings.clear();
+    if (is_string_type(o_buffer.data_type))
+    {
+        o_buffer.components = 1;
+        o_buffer.element_size = 0;
+        return gather_strings(traversal,channel,o_buffer.strings);
+    }
+    o_buffer.components = data_type_component_count(o_buffer.data_type);
+    o_buffer.element_size = channel.stride();
+    if (o_buffer.components == 0 || o_buffer.element_size == 0)
+        return false;
+    o_buffer.data.resize(o_buffer.element_count*o_buffer.element_size);
+    if (o_buffer.data.empty())
+        return true;
+    return gather_channel(traversal,channel,&o_buffer.data[0],o_buffer.element_count);
+}
+
+void write_text(const ChannelBuffer& buffer,
+                const TileTraversal& traversal,
+                std::ostream& os)
+{
+    for (size_t tileOrdinal=0;tileOrdinal<traversal.tileCount();tileOrdinal++)
+    {
+        const TileTraversal::Tile& tile = traversal.tile(tileOrdinal);
+        os << "tile:" << tile.index.tile << " depth:" << tile.index.depth << '\n';
+        print_elements(buffer,os,tile.elementOffset,tile.elementOffset+tile.elementCount,"\t",' ');
+        os << '\n';
+    }
+}
+
+void write_csv(const ChannelBuffer& buffer,
+               std::ostream& os)
+{
+    static const char* suffixes[] = { "x", "y", "z", "w" };
+    for (size_t c=0;c<buffer.components;c++)
+    {
+        if (c)
+            os << ',';
+        os << buffer.name;
+        if (buffer.components > 1 && buffer.components <= 4)
+            os << '_' << suffixes[c];
+        else if (buffer.components > 4)
+            os << '_' << c;
+    }
+    os << '\n';
+    if (buffer.is_string())
+    {
+        // Quoted, embedded quotes doubled
+        for (size_t i=0;i<buffer.strings.size();i++)
+        {
+            std::string quoted(buffer.strings[i]);
+            for (size_t pos=quoted.find('"');pos!=std::string::npos;pos=quoted.find('"',pos+2))
+                quoted.insert(pos,1,'"');
+            os << '"' << quoted << '"' << '\n';
+        }
+        return;
+    }
+    print_elements(buffer,os,0,buffer.element_count,"",',');
+}
+
+bool write_raw(const ChannelBuffer& buffer,
+               const std::string& filename)
+{
+    BifrostDumpRawHeader header;
+    memcpy(header.magic,RAW_MAGIC,sizeof(header.magic));
+    header.version = DUMP_FORMAT_VERSION;
+    header.data_type = uint32_t(buffer.data_type);
+    header.components = uint32_t(buffer.components);
+    header.element_size = uint32_t(buffer.element_size);
+    header.reserved = 0;
+    header.element_count = buffer.element_count;
+
+    FILE* file = open_buffered(filename);
+    if (!file)
+        return false;
+    bool status = fwrite(&header,sizeof(header),1,file)==1;
+    if (buffer.is_string())
+        write_strings(buffer.strings,file,status);
+    else if (status && !buffer.data.empty())
+        status = fwrite(&buffer.data[0],1,buffer.data.size(),file)==buffer.data.size();
+    return fclose(file)==0 && status;
+}
+
+bool write_npy(const ChannelBuffer& buffer,
+               const std::string& filename)
+{
+    std::string descr;
+    std::string shape;
+    std::vector<char> fixed_width_strings;
+    if (buffer.is_string())
+    {
+        size_t width = 1;
+        for (size_t i=0;i<buffer.strings.size();i++)
+            width = std::max(width,buffer.strings[i].size());
+        descr = (boost::format("|S%1%") % width).str();
+        shape = (boost::format("(%1%,)") % buffer.element_count).str();
+        fixed_width_strings.resize(buffer.strings.size()*width,'\0');
+        for (size_t i=0;i<buffer.strings.size();i++)
+            if (!buffer.strings[i].empty())
+                memcpy(&fixed_width_strings[i*width],buffer.strings[i].data(),buffer.strings[i].size());
+    }
+    else
+    {
+        NumpyDescr numpy_descr;
+        if (!dispatch_scalar_type(buffer.data_type,numpy_descr))
+            return false;
+        descr = numpy_descr.descr;
+        if (buffer.components == 1)
+            shape = (boost::format("(%1%,)") % buffer.element_count).str();
+        else if (buffer.components == 16)
+            shape = (boost::format("(%1%, 4, 4)") % buffer.element_count).str();
+        else
+            shape = (boost::format("(%1%, %2%)") % buffer.element_count % buffer.components).str();
+    }
+
+    // Magic, version 1.0, header length, then the header padded so the data is 64 bytes aligned
+    std::string header = (boost::format("{'descr': '%1%', 'fortran_order': False, 'shape': %2%, }") % descr % shape).str();
+    const size_t preamble_size = 10;
+    size_t padded_size = ((preamble_size + header.size() + 1 + 63)/64)*64;
+    header.append(padded_size - preamble_size - header.size() - 1,' ');
+    header += '\n';
+    unsigned char preamble[preamble_size] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0, 0, 0 };
+    preamble[8] = (unsigned char)(header.size() & 0xff);
+    preamble[9] = (unsigned char)(header.size() >> 8);
+
+    FILE* file = open_buffered(filename);
+    if (!file)
+        return false;
+    bool status = fwrite(preamble,1,preamble_size,file)==preamble_size
+        && fwrite(header.data(),1,header.size(),file)==header.size();
+    const std::vector<unsigned char>& data = buffer.data;
+    if (status && !fixed_width_strings.empty())
+        status = fwrite(&fixed_width_strings[0],1,fixed_width_strings.size(),file)==fixed_width_strings.size();
+    else if (status && !data.empty())
+        status = fwrite(&data[0],1,data.size(),file)==data.size();
+    return fclose(file)==0 && status;
+}
+
+BifrostDumpColumnarWriter::BifrostDumpColumnarWriter()
+: _file(0)
+, _offset(0)
+, _status(false)
+{
+}
+
+BifrostDumpColumnarWriter::~BifrostDumpColumnarWriter()
+{
+    if (_file)
+        close();
+}
+
+bool BifrostDumpColumnarWriter::open(const std::string& filename)
+{
+    _columns.clear();
+    _file = open_buffered(filename);
+    if (!_file)
+        return false;
+    _status = fwrite(COLUMNAR_MAGIC,1,sizeof(COLUMNAR_MAGIC),_file)==sizeof(COLUMNAR_MAGIC)
+        && fwrite(&DUMP_FORMAT_VERSION,sizeof(DUMP_FORMAT_VERSION),1,_file)==1;
+    _offset = sizeof(COLUMNAR_MAGIC) + sizeof(DUMP_FORMAT_VERSION);
+    return _status;
+}
+
+bool BifrostDumpColumnarWriter::add(const ChannelBuffer& buffer)
+{
+    if (!_file || !_status)
+        return false;
+    static const char padding[COLUMN_ALIGNMENT] = { 0 };
+    size_t pad = (COLUMN_ALIGNMENT - _offset%COLUMN_ALIGNMENT)%COLUMN_ALIGNMENT;
+    _status = pad==0 || fwrite(padding,1,pad,_file)==pad;
+    _offset += pad;
+
+    BifrostDumpColumn column;
+    memset(&column,0,sizeof(column));
+    strncpy(column.name,buffer.name.c_str(),sizeof(column.name)-1);
+    column.data_type = uint32_t(buffer.data_type);
+    column.components = uint32_t(buffer.components);
+    column.element_size = uint32_t(buffer.element_size);
+    column.element_count = buffer.element_count;
+    column.offset = _offset;
+    if (buffer.is_string())
+        column.size = write_strings(buffer.strings,_file,_status);
+    else
+    {
+        column.size = buffer.data.size();
+        if (_status && !buffer.data.empty())
+            _status = fwrite(&buffer.data[0],1,buffer.data.size(),_file)==buffer.data.size();
+    }
+    _offset += column.size;
+    _columns.push_back(column);
+    return _status;
+}
+
+bool BifrostDumpColumnarWriter::close()
+{
+    if (!_file)
+        return false;
+    uint64_t directory_offset = _offset;
+    uint32_t column_count = uint32_t(_columns.size());
+    if (_status && !_columns.empty())
+        _status = fwrite(&_columns[0],sizeof(BifrostDumpColumn),_columns.size(),_file)==_columns.size();
+    _status = _status
+        && fwrite(&directory_offset,sizeof(directory_offset),1,_file)==1
+        && fwrite(&column_count,sizeof(column_count),1,_file)==1
+        && fwrite(COLUMNAR_MAGIC,1,sizeof(COLUMNAR_MAGIC),_file)==sizeof(COLUMNAR_MAGIC);
+    _status = fclose(_file)==0 && _status;
+    _file = 0;
+    return _status;
+}
+
+std::string dump_filename(const std::string& prefix,
+                          const std::string& component_name,
+                          const std::string& channel_name,
+                          const std::string& extension)
+{
+    struct Sanitize {
+        static std::string apply(const std::string& name)
+        {
+            std::string result(name.substr(name.find_last_of('/')==std::string::npos ? 0 : name.find_last_of('/')+1));
+            for (size_t i=0;i<result.size();i++)
+            {
+                char c = result[i];
+                if (!((c>='a' && c<='z') || (c>='A' && c<='Z') || (c>='0' && c<='9') || c=='-' || c=='_'))
+                    result[i] = '_';
+            }
+            return result;
+        }
+    };
+    std::string filename = prefix + "." + Sanitize::apply(component_name);
+    if (!channel_name.empty())
+        filename += "." + Sanitize::apply(channel_name);
+    return filename + "." + extension;
+}
+
+DumpFilter::DumpFilter()
+: has_depth(false)
+, depth(0)
+, has_tile_range(false)
+, tile_begin(0)
+, tile_end(0)
+, has_bbox(false)
+{
+}
+
+bool DumpFilter::selects_channel(const std::string& channel_name) const
+{
+    if (channel_names.empty())
+        return true;
+    size_t slash = channel_name.find_last_of('/');
+    std::string short_name = slash == std::string::npos ? channel_name : channel_name.substr(slash+1);
+    for (size_t i=0;i<channel_names.size();i++)
+        if (channel_names[i] == channel_name || channel_names[i] == short_name)
+            return true;
+    return false;
+}
+
+bool parse_tile_range(const std::string& i_range_string, size_t& o_begin, size_t& o_end)
+{
+    size_t dash = i_range_string.find('-');
+    if (dash == std::string::npos)
+    {
+        if (!parse_index(i_range_string,o_begin))
+            return false;
+        o_end = o_begin;
+        return true;
+    }
+    return parse_index(i_range_string.substr(0,dash),o_begin)
+        && parse_index(i_range_string.substr(dash+1),o_end)
+        && o_begin <= o_end;
+}
+
+void select_tiles_in_box(const Bifrost::API::Component& component,
+                         size_t component_index,
+                         const std::string& position_channel_name,
+                         const TileIndex* tile_index,
+                         const BoundsCacheBox& box,
+                         TileKeySet& o_tile_keys)
+{
+    o_tile_keys.clear();
+    if (tile_index)
+    {
+        bool indexed = false;
+        for (size_t i=0;i<tile_index->tile_count();i++)
+        {
+            const TileIndexRecord& record = tile_index->tile(i);
+            if (record.component != component_index)
+                continue;
+            indexed = true;
+            if (overlaps(record.bounds,box))
+                o_tile_keys.insert(TileIndex::tile_key(record.tile,record.depth));
+        }
+        if (indexed)
+            return;
+    }
+
+    Bifrost::API::Layout layout = component.layout();
+    const float voxel_scale = layout.voxelScale();
+    TileTraversal traversal(component);
+    std::vector<char> selected(traversal.tileCount(),0);
+    if (component.type() == Bifrost::API::PointComponentType)
+    {
+        Bifrost::API::Channel position_ch;
+        bool position_status = false;
+        get_channel(component,position_channel_name,Bifrost::API::FloatV3Type,position_ch,position_status);
+        if (!position_status)
+            return;
+        traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+            size_t bufferSize = 0;
+            const float* position_tile_data = static_cast<const float*>(position_ch.tileDataPtr( tile.index, bufferSize ));
+            if (!position_tile_data)
+                return;
+            BoundsCacheBox tile_bounds;
+            points_bounds(position_tile_data,tile.elementCount,voxel_scale,tile_bounds.min,tile_bounds.max);
+            selected[tile.ordinal] = overlaps(tile_bounds,box);
+        });
+    }
+    else
+    {
+        // Tile space corner (i,j,k) and width in voxels, as in dev/bifvoxelinfo
+        Bifrost::API::TileAccessor accessor = layout.tileAccessor();
+        traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+            const Bifrost::API::TileInfo tile_info = accessor.tile(tile.index).info();
+            const float tile_width = tile_info.dimInfo.tileWidth;
+            const float corner[3] = { float(tile_info.i), float(tile_info.j), float(tile_info.k) };
+            BoundsCacheBox tile_bounds;
+            for (int axis=0;axis<3;axis++)
+            {
+                tile_bounds.min[axis] = corner[axis]*voxel_scale;
+                tile_bounds.max[axis] = (corner[axis]+tile_width)*voxel_scale;
+            }
+            selected[tile.ordinal] = overlaps(tile_bounds,box);
+        });
+    }
+    for (size_t i=0;i<traversal.tileCount();i++)
+        if (selected[i])
+            o_tile_keys.insert(TileIndex::tile_key(uint32_t(traversal.tile(i).index.tile),uint32_t(traversal.tile(i).index.depth)));
+}
+
+TileTraversal filter_tiles(const TileTraversal& traversal,
+                           const DumpFilter& filter,
+                           const TileKeySet* box_tiles)
+{
+    return traversal.select([&](const TileTraversal::Tile& tile) {
+        const size_t t = tile.index.tile;
+        const size_t d = tile.index.depth;
+        if (filter.has_depth && d != filter.depth)
+            return false;
+        if (filter.has_tile_range && (t < filter.tile_begin || t > filter.tile_end))
+            return false;
+        if (box_tiles && box_tiles->find(TileIndex::tile_key(uint32_t(t),uint32_t(d))) == box_tiles->end())
+            return false;
+        return true;
+    });
+}
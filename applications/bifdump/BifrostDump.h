@@ -0,0 +1,186 @@
+#pragma once
+
+#include <BifrostHeaders.h>
+#include <utils/BifrostUtils.h>
+#include <utils/BoundsCache.h>
+#include <utils/TileIndex.h>
+#include <stdio.h>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/*!
+ * \brief Output formats of bifdump
+ * \note text    : human readable values grouped by tile (the original output)
+ *       csv     : one row per element, one column per scalar component
+ *       raw     : one file per channel, BifrostDumpRawHeader then the data
+ *       npy     : one NumPy .npy file per channel
+ *       columnar: one file per component, columns written one after the
+ *                 other (64 bytes aligned) with a directory in the footer,
+ *                 see BifrostDumpColumnarWriter
+ */
+enum DumpFormat { DumpText, DumpCSV, DumpRaw, DumpNPY, DumpColumnar };
+
+bool parse_dump_format(const std::string& i_format_string, DumpFormat& o_format);
+
+/*!
+ * \brief One channel gathered into contiguous memory
+ * \note Numeric types keep their in-memory layout, element_size bytes per
+ *       element. String, dictionary (as JSON) and string array (joined by
+ *       '\n') channels are held as strings, with element_size 0
+ */
+struct ChannelBuffer
+{
+    ChannelBuffer()
+    : data_type(Bifrost::API::NoneType)
+    , components(0)
+    , element_size(0)
+    , element_count(0)
+    {}
+    std::string                name;
+    Bifrost::API::DataType     data_type;
+    size_t                     components;
+    size_t                     element_size;
+    size_t                     element_count;
+    std::vector<unsigned char> data;
+    std::vector<std::string>   strings;
+
+    bool is_string() const { return element_size == 0; }
+};
+
+/*!
+ * \brief Copies the tiles of the traversal into o_buffer
+ * \return false if the data type cannot be dumped or a tile is not accessible
+ */
+bool gather_channel_buffer(const TileTraversal& traversal,
+                           const Bifrost::API::Channel& channel,
+                           ChannelBuffer& o_buffer);
+
+/*! \brief Values grouped by tile, one element per line */
+void write_text(const ChannelBuffer& buffer,
+                const TileTraversal& traversal,
+                std::ostream& os);
+
+/*! \brief Header row then one row per element */
+void write_csv(const ChannelBuffer& buffer,
+               std::ostream& os);
+
+/*!
+ * \brief Fixed size header of the raw format, followed by element_count *
+ *        element_size bytes, or for strings (element_size 0) by element_count
+ *        uint32 length prefixed strings
+ */
+struct BifrostDumpRawHeader
+{
+    char     magic[4];     /*!< "BIFR" */
+    uint32_t version;
+    uint32_t data_type;    /*!< Bifrost::API::DataType */
+    uint32_t components;
+    uint32_t element_size;
+    uint32_t reserved;
+    uint64_t element_count;
+};
+
+bool write_raw(const ChannelBuffer& buffer,
+               const std::string& filename);
+
+/*! \brief NumPy .npy version 1.0, strings as fixed width byte strings */
+bool write_npy(const ChannelBuffer& buffer,
+               const std::string& filename);
+
+/*!
+ * \brief Column directory entry of the columnar format
+ * \note The file is "BCOL" + version, the columns, the directory of
+ *       column_count entries, then the uint64 byte offset of the directory,
+ *       the uint32 column count and "BCOL" again, so a reader seeks to the
+ *       last 16 bytes first
+ */
+struct BifrostDumpColumn
+{
+    char     name[64];
+    uint32_t data_type;
+    uint32_t components;
+    uint32_t element_size;
+    uint32_t reserved;
+    uint64_t element_count;
+    uint64_t offset;
+    uint64_t size;
+};
+
+class BifrostDumpColumnarWriter
+{
+public:
+    BifrostDumpColumnarWriter();
+    ~BifrostDumpColumnarWriter();
+
+    bool open(const std::string& filename);
+    bool add(const ChannelBuffer& buffer);
+    /*! \brief Writes the directory, returns false if any write failed */
+    bool close();
+
+private:
+    FILE*                          _file;
+    uint64_t                       _offset;
+    bool                           _status;
+    std::vector<BifrostDumpColumn> _columns;
+};
+
+/*!
+ * \brief Output filename of a channel, "<prefix>.<component>.<channel>.<extension>"
+ * \note Only the part of the channel name after the last '/' is used and
+ *       characters other than alphanumerics, '-' and '_' are replaced by '_'
+ */
+std::string dump_filename(const std::string& prefix,
+                          const std::string& component_name,
+                          const std::string& channel_name,
+                          const std::string& extension);
+
+/*!
+ * \brief Selection of the channels and tiles to dump
+ * \note A tile is dumped when it passes all the tile filters. The bounding
+ *       box selects whole tiles overlapping it, elements are not culled
+ */
+struct DumpFilter
+{
+    DumpFilter();
+    std::vector<std::string> channel_names; /*!< full names or the part after the last '/', empty for all */
+    bool                     has_depth;
+    size_t                   depth;
+    bool                     has_tile_range;
+    size_t                   tile_begin;    /*!< inclusive */
+    size_t                   tile_end;      /*!< inclusive */
+    bool                     has_bbox;
+    BoundsCacheBox           bbox;          /*!< world space */
+
+    bool filters_tiles() const { return has_depth || has_tile_range || has_bbox; }
+    bool empty() const { return channel_names.empty() && !filters_tiles(); }
+    bool selects_channel(const std::string& channel_name) const;
+};
+
+/*! \brief Parses "first-last" or a single tile index */
+bool parse_tile_range(const std::string& i_range_string, size_t& o_begin, size_t& o_end);
+
+typedef std::unordered_set<uint64_t> TileKeySet; /*!< TileIndex::tile_key() */
+
+/*!
+ * \brief Tiles of the component overlapping the world space box
+ * \param tile_index Sidecar written by "bifinfo --build-index", may be null.
+ *        When it holds the component its bounds are used, otherwise point
+ *        tiles are bounded by their positions and voxel tiles by their
+ *        extent in tile space
+ */
+void select_tiles_in_box(const Bifrost::API::Component& component,
+                         size_t component_index,
+                         const std::string& position_channel_name,
+                         const TileIndex* tile_index,
+                         const BoundsCacheBox& box,
+                         TileKeySet& o_tile_keys);
+
+/*!
+ * \brief The tiles of the traversal passing the depth and tile range filters
+ *        and, when box_tiles is not null, in box_tiles
+ */
+TileTraversal filter_tiles(const TileTraversal& traversal,
+                           const DumpFilter& filter,
+                           const TileKeySet* box_tiles);
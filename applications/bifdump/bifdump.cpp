@@ -1,127 +1,283 @@
+#include "BifrostDump.h"
 #include <BifrostHeaders.h>
 #include <boost/format.hpp>
+#include <boost/program_options.hpp>
+#include <tbb/parallel_for.h>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
 
-void perform_dump(const Bifrost::API::Layout&  layout,
-                  const Bifrost::API::Channel& ch)
-{
-    // iterate over the tile tree at each level
-    Bifrost::API::DataType channelDataType = ch.dataType();
-    size_t depthCount = layout.depthCount();
-    for ( size_t d=0; d<depthCount; d++ ) {
-        for ( size_t t=0; t<layout.tileCount(d); t++ ) {
-            Bifrost::API::TreeIndex tindex(t,d);
-            if ( !ch.elementCount( tindex ) ) {
-                // nothing there
-                continue;
-            }
-            std::cout << "tile:" << t << " depth:" << d << std::endl;
-            switch (channelDataType)
-            {
-            case Bifrost::API::FloatType :
-                {
-                    const Bifrost::API::TileData<float>& f1 = ch.tileData<float>( tindex );
-                    for (size_t i=0; i<f1.count(); i++ ) {
-                        const float& val = f1[i];
-                        std::cout << "\t" << f1[i] << std::endl;
-                    }
+namespace po = boost::program_options;
 
-                    std::cout << std::endl;
-                }
-                break;
-            case Bifrost::API::FloatV2Type :
-                break;
-            case Bifrost::API::FloatV3Type :
-                {
-                    const Bifrost::API::TileData<amino::Math::vec3f>& f3 = ch.tileData<amino::Math::vec3f>( tindex );
-                    for (size_t i=0; i<f3.count(); i++ ) {
-                        const amino::Math::vec3f& val = f3[i];
-                        std::cout << "\t" << val[0] << " " << val[1] << " " << val[2] << std::endl;
-                    }
-
-                    std::cout << std::endl;
-                }
-                break;
-            case Bifrost::API::Int32Type :
-                break;
-            case Bifrost::API::Int64Type :
-                break;
-            case Bifrost::API::UInt32Type :
-                break;
-            case Bifrost::API::UInt64Type :
-                break;
-            case Bifrost::API::Int32V2Type :
-                break;
-            case Bifrost::API::Int32V3Type :
-                break;
-            default:
-                std::cerr << "Unknown channel type encountered" << std::endl;
-                break;
-            }
+/*!
+ * \brief Gathers the selected tiles of the channel and writes them in the
+ *        requested format. text and csv go to std::cout, or like the binary
+ *        formats to one file per channel when an output prefix is given.
+ *        columnar adds the channel to its component's file
+ */
+bool perform_dump(const TileTraversal& traversal,
+                  const Bifrost::API::Channel& ch,
+                  const std::string& component_name,
+                  DumpFormat format,
+                  const std::string& output_prefix,
+                  BifrostDumpColumnarWriter* columnar_writer)
+{
+    ChannelBuffer buffer;
+    if (!gather_channel_buffer(traversal,ch,buffer))
+    {
+        std::cerr << boost::format("Unable to dump channel %1% of type %2%") % ch.name().c_str() % data_type_name(ch.dataType()) << std::endl;
+        return false;
+    }
+    std::string filename;
+    bool status = true;
+    switch (format)
+    {
+    case DumpText :
+    case DumpCSV :
+        if (output_prefix.empty())
+        {
+            if (format == DumpText)
+                write_text(buffer,traversal,std::cout);
+            else
+                write_csv(buffer,std::cout);
+            return true;
+        }
+        else
+        {
+            filename = dump_filename(output_prefix,component_name,buffer.name,format == DumpText ? "txt" : "csv");
+            std::ofstream os(filename.c_str());
+            if (format == DumpText)
+                write_text(buffer,traversal,os);
+            else
+                write_csv(buffer,os);
+            os.close();
+            status = !os.fail();
         }
+        break;
+    case DumpRaw :
+        filename = dump_filename(output_prefix,component_name,buffer.name,"raw");
+        status = write_raw(buffer,filename);
+        break;
+    case DumpNPY :
+        filename = dump_filename(output_prefix,component_name,buffer.name,"npy");
+        status = write_npy(buffer,filename);
+        break;
+    case DumpColumnar :
+        return columnar_writer && columnar_writer->add(buffer);
     }
+    if (!status)
+        std::cerr << boost::format("Unable to write \"%1%\"") % filename << std::endl;
+    return status;
 }
 
+/*! \brief A channel selected for dumping, with its selected tiles */
+struct ChannelDump
+{
+    ChannelDump(const Bifrost::API::Channel& i_channel,
+                const TileTraversal& i_traversal)
+    : channel(i_channel)
+    , traversal(i_traversal)
+    {}
+    Bifrost::API::Channel channel;
+    TileTraversal         traversal;
+};
+
 int main(int argc, char **argv)
 {
-    if (argc != 2)
-    {
-        fprintf(stderr,"Usage : %s <bifrost file>\n",argv[0]);
-        exit(1);
-    }
-    Bifrost::API::String biffile = argv[1];
-    Bifrost::API::ObjectModel om;
-    Bifrost::API::FileIO fileio = om.createFileIO( biffile );
-    Bifrost::API::StateServer ss = fileio.load( );
-
-    if ( !ss.valid() ) {
-        std::cerr << "bifinfo : file loading error" << std::endl;
-        exit(1);
-    }
+    try {
+        std::string format_string("text");
+        std::string output_prefix;
+        std::string bifrost_filename;
+        std::string position_channel_name("position");
+        std::string tile_range_string;
+        std::vector<float> bbox_values;
+        DumpFilter filter;
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help", "produce help message")
+            ("format", po::value<std::string>(&format_string),
+                "Output format [text, csv, raw, npy, columnar]. text and csv are written to the standard output without --output, "
+                "otherwise each channel is written to <output>.<component>.<channel>.<txt|csv|raw|npy>, "
+                "columnar writes one <output>.<component>.bcol file per component. Defaults to text")
+            ("output", po::value<std::string>(&output_prefix),
+                "Output filename prefix, required by the raw, npy and columnar formats. Channels written to separate files are dumped in parallel")
+            ("channel", po::value<std::vector<std::string> >(&filter.channel_names)->multitoken(),
+                "Only dump these channels, full names or the part after the last '/', e.g. position velocity")
+            ("depth", po::value<size_t>(&filter.depth),
+                "Only dump the tiles at this depth")
+            ("tile-range", po::value<std::string>(&tile_range_string),
+                "Only dump the tiles with an index in this range, e.g. 1200-1210 or 1204")
+            ("bbox", po::value<std::vector<float> >(&bbox_values)->multitoken(),
+                "Only dump the tiles overlapping this world space box, xmin ymin zmin xmax ymax zmax. "
+                "Uses the tile index written by \"bifinfo --build-index\" when there is one")
+            ("input-file", po::value<std::string>(&bifrost_filename),
+                "input file")
+            ;
 
-    size_t numComponents = ss.components().count();
-    std::cout << "Number of components : " << numComponents << std::endl;
-    for (size_t i=0;i<numComponents;i++)
-    {
-        Bifrost::API::Component component = ss.components()[i];
-        Bifrost::API::TypeID componentType = component.type();
-        Bifrost::API::Layout layout = component.layout();
-        if (componentType == Bifrost::API::PointComponentType)
-        {
-            std::cout << "Point component : "
-                    << component.name().c_str()
-                    << std::endl;
+        po::positional_options_description p;
+        p.add("input-file", 1);
 
-            Bifrost::API::RefArray channels = component.channels();
-            size_t particleCount = component.elementCount();
-            size_t channelCount = channels.count();
-            for (size_t channelIndex=0;channelIndex<channelCount;channelIndex++)
+        po::variables_map vm;
+        // No short options, so negative --bbox values are not taken for options
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(p)
+                  .style(po::command_line_style::unix_style ^ po::command_line_style::allow_short).run(), vm);
+        po::notify(vm);
+
+        DumpFormat format = DumpText;
+        if (vm.count("help") || bifrost_filename.empty())
+        {
+            std::cout << boost::format("Usage : %1% [options] <bifrost file>") % argv[0] << "\n" << desc << "\n";
+            return 1;
+        }
+        if (!parse_dump_format(format_string,format))
+        {
+            std::cerr << boost::format("Unknown format \"%1%\"") % format_string << std::endl;
+            return 1;
+        }
+        filter.has_depth = vm.count("depth") > 0;
+        if (vm.count("tile-range"))
+        {
+            if (!parse_tile_range(tile_range_string,filter.tile_begin,filter.tile_end))
             {
-                const Bifrost::API::Channel& ch = channels[channelIndex];
-                Bifrost::API::String channelName = ch.name();
-                Bifrost::API::DataType channelDataType = ch.dataType();
-                std::cout << boost::format("\tChannel[%1%] of type %2% : %3% has %4% particles")
-                % channelIndex % channelDataType % channelName.c_str() % channelCount << std::endl;
-                perform_dump(layout,ch);
+                std::cerr << boost::format("Invalid tile range \"%1%\"") % tile_range_string << std::endl;
+                return 1;
             }
+            filter.has_tile_range = true;
         }
-        else if (componentType == Bifrost::API::VoxelComponentType)
+        if (vm.count("bbox"))
         {
-            std::cout << "Voxel component : "
-                    << component.name().c_str()
-                    << std::endl;
+            if (bbox_values.size() != 6)
+            {
+                std::cerr << "--bbox needs 6 values : xmin ymin zmin xmax ymax zmax" << std::endl;
+                return 1;
+            }
+            for (int axis=0;axis<3;axis++)
+            {
+                filter.bbox.min[axis] = std::min(bbox_values[axis],bbox_values[axis+3]);
+                filter.bbox.max[axis] = std::max(bbox_values[axis],bbox_values[axis+3]);
+            }
+            filter.has_bbox = true;
+        }
+        const bool binary = format == DumpRaw || format == DumpNPY || format == DumpColumnar;
+        if (binary && output_prefix.empty())
+        {
+            std::cerr << boost::format("--output is required by the %1% format") % format_string << std::endl;
+            return 1;
+        }
+
+        // Dumps can be very large, do not flush on every line
+        std::ios::sync_with_stdio(false);
+
+        Bifrost::API::String biffile = bifrost_filename.c_str();
+        Bifrost::API::ObjectModel om;
+        Bifrost::API::FileIO fileio = om.createFileIO( biffile );
+        Bifrost::API::StateServer ss = fileio.load( );
+
+        if ( !ss.valid() ) {
+            std::cerr << "bifdump : file loading error" << std::endl;
+            return 1;
+        }
+
+        TileIndex tile_index;
+        const bool has_tile_index = filter.has_bbox && tile_index.read(tile_index_filename(bifrost_filename));
+
+        // The headers would corrupt the csv output
+        std::ostream& log = format == DumpCSV && output_prefix.empty() ? std::cerr : std::cout;
+        // Each channel goes to its own file, the channels can be gathered and written concurrently
+        const bool parallel = !output_prefix.empty() && format != DumpColumnar;
+        bool status = true;
+        size_t selectedChannelCount = 0;
+        size_t numComponents = ss.components().count();
+        log << "Number of components : " << numComponents << '\n';
+        for (size_t i=0;i<numComponents;i++)
+        {
+            Bifrost::API::Component component = ss.components()[i];
+            Bifrost::API::TypeID componentType = component.type();
+            Bifrost::API::Layout layout = component.layout();
+            std::string componentName = component.name().c_str();
+            if (componentType != Bifrost::API::PointComponentType && componentType != Bifrost::API::VoxelComponentType)
+                continue;
+            const bool points = componentType == Bifrost::API::PointComponentType;
+            log << (points ? "Point component : " : "Voxel component : ")
+                << componentName
+                << '\n';
+
+            TileKeySet box_tiles;
+            if (filter.has_bbox)
+                select_tiles_in_box(component,i,position_channel_name,has_tile_index ? &tile_index : 0,filter.bbox,box_tiles);
+
+            // Select the channels and their tiles before any tile data is loaded
+            std::vector<ChannelDump> dumps;
             Bifrost::API::RefArray channels = component.channels();
             size_t channelCount = channels.count();
             for (size_t channelIndex=0;channelIndex<channelCount;channelIndex++)
             {
                 const Bifrost::API::Channel& ch = channels[channelIndex];
                 Bifrost::API::String channelName = ch.name();
+                if (!filter.selects_channel(channelName.c_str()))
+                    continue;
                 Bifrost::API::DataType channelDataType = ch.dataType();
-                std::cout << boost::format("\tChannel[%1%] of type %2% : %3% has %4% voxels")
-                % channelIndex % channelDataType % channelName.c_str() % channelCount << std::endl;
-                perform_dump(layout,ch);
+                TileTraversal traversal(layout,ch);
+                log << boost::format("\tChannel[%1%] of type %2% : %3% has %4% %5%")
+                % channelIndex % channelDataType % channelName.c_str() % traversal.elementCount() % (points ? "particles" : "voxels");
+                if (filter.filters_tiles())
+                {
+                    traversal = filter_tiles(traversal,filter,filter.has_bbox ? &box_tiles : 0);
+                    log << boost::format(", dumping %1% in %2% tiles") % traversal.elementCount() % traversal.tileCount();
+                }
+                log << '\n';
+                dumps.push_back(ChannelDump(ch,traversal));
+            }
+            selectedChannelCount += dumps.size();
+            if (dumps.empty())
+                continue;
+
+            if (parallel)
+            {
+                std::vector<char> dump_status(dumps.size(),0);
+                tbb::parallel_for(size_t(0),dumps.size(),[&](size_t dumpIndex) {
+                    dump_status[dumpIndex] = perform_dump(dumps[dumpIndex].traversal,dumps[dumpIndex].channel,componentName,format,output_prefix,0);
+                });
+                status = std::find(dump_status.begin(),dump_status.end(),0) == dump_status.end() && status;
+                continue;
+            }
+
+            BifrostDumpColumnarWriter columnar_writer;
+            std::string columnar_filename = dump_filename(output_prefix,componentName,"","bcol");
+            if (format == DumpColumnar && !columnar_writer.open(columnar_filename))
+            {
+                std::cerr << boost::format("Unable to write \"%1%\"") % columnar_filename << std::endl;
+                status = false;
+                continue;
+            }
+            for (size_t dumpIndex=0;dumpIndex<dumps.size();dumpIndex++)
+            {
+                if (format == DumpCSV && output_prefix.empty() && dumpIndex > 0)
+                    std::cout << '\n';
+                status = perform_dump(dumps[dumpIndex].traversal,dumps[dumpIndex].channel,componentName,format,output_prefix,
+                                      format == DumpColumnar ? &columnar_writer : 0) && status;
+            }
+            if (format == DumpColumnar && !columnar_writer.close())
+            {
+                std::cerr << boost::format("Unable to write \"%1%\"") % columnar_filename << std::endl;
+                status = false;
             }
         }
+        if (selectedChannelCount == 0 && !filter.channel_names.empty())
+        {
+            std::cerr << "None of the requested channels was found" << std::endl;
+            status = false;
+        }
+        std::cout.flush();
+        return status ? 0 : 1;
+    }
+    catch(std::exception& e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    catch(...) {
+        std::cerr << "Exception of unknown type!\n";
     }
 
-    exit(0);
+    return 1;
 }
@@ -1,10 +1,21 @@
 #include <utils/BifrostUtils.h>
+#include <utils/PointKernels.h>
+#include <utils/FrameUtils.h>
+#include <utils/BoundsCache.h>
+#include <utils/TileIndex.h>
+#include <utils/ChannelStats.h>
 #include <boost/format.hpp>
 #include <boost/program_options.hpp>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <OpenEXR/ImathBox.h>
+#include <tbb/atomic.h>
+#include <tbb/pipeline.h>
+#include <tbb/task_scheduler_init.h>
+#include <tbb/tick_count.h>
+#include <algorithm>
+#include <stdlib.h>
 
 #include <BifrostHeaders.h>
 
@@ -94,34 +105,32 @@ int determine_points_bbox(const Bifrost::API::Component& component,
                           const std::string& position_channel_name,
                           Imath::Box3f& bounds)
 {
-    int positionChannelIndex = findChannelIndexViaName(component,position_channel_name.c_str());
+    ChannelIndex channel_index(component);
+    int positionChannelIndex = channel_index.find(position_channel_name);
     if (positionChannelIndex<0)
         return 1;
-    const Bifrost::API::Channel& position_ch = component.channels()[positionChannelIndex];
+    const Bifrost::API::Channel& position_ch = channel_index.channel(positionChannelIndex);
     if (!position_ch.valid())
         return 1;
     if ( position_ch.dataType() != Bifrost::API::FloatV3Type)
         return 1;
 
     Bifrost::API::Layout layout = component.layout();
-    size_t depthCount = layout.depthCount();
-    for ( size_t d=0; d<depthCount; d++ ) {
-        for ( size_t t=0; t<layout.tileCount(d); t++ ) {
-            Bifrost::API::TreeIndex tindex(t,d);
-            if ( !position_ch.elementCount( tindex ) ) {
-                // nothing there
-                continue;
-            }
-
-            const Bifrost::API::TileData<amino::Math::vec3f>& position_tile_data = position_ch.tileData<amino::Math::vec3f>( tindex );
-            // const Bifrost::API::TileData<amino::Math::vec3f>& velocity_tile_data = velocity_ch.tileData<amino::Math::vec3f>( tindex );
-            for (size_t i=0; i<position_tile_data.count(); i++ ) {
-                bounds.extendBy(Imath::V3f(position_tile_data[i][0],
-                                           position_tile_data[i][1],
-                                           position_tile_data[i][2]));
-            }
-        }
-    }
+    TileTraversal traversal(layout,position_ch);
+    std::vector<Imath::Box3f> tile_bounds(traversal.tileCount());
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        size_t bufferSize = 0;
+        const float* position_tile_data = static_cast<const float*>(position_ch.tileDataPtr( tile.index, bufferSize ));
+        if (!position_tile_data)
+            return;
+        float tile_min[3], tile_max[3];
+        init_bounds(tile_min,tile_max);
+        points_bounds(position_tile_data,tile.elementCount,1.0f,tile_min,tile_max);
+        tile_bounds[tile.ordinal] = Imath::Box3f(Imath::V3f(tile_min[0],tile_min[1],tile_min[2]),
+                                                 Imath::V3f(tile_max[0],tile_max[1],tile_max[2]));
+    });
+    for (size_t i=0; i<tile_bounds.size(); i++ )
+        bounds.extendBy(tile_bounds[i]);
     return 0;
 }
 
@@ -131,16 +140,17 @@ int determine_points_with_velocity_bbox(const Bifrost::API::Component& component
                                         float fps,
                                         Imath::Box3f& bounds)
 {
-    int positionChannelIndex = findChannelIndexViaName(component,position_channel_name.c_str());
+    ChannelIndex channel_index(component);
+    int positionChannelIndex = channel_index.find(position_channel_name);
     if (positionChannelIndex<0)
         return 1;
-    int velocityChannelIndex = findChannelIndexViaName(component,velocity_channel_name.c_str());
+    int velocityChannelIndex = channel_index.find(velocity_channel_name);
     if (velocityChannelIndex<0)
         return 1;
-    const Bifrost::API::Channel& position_ch = component.channels()[positionChannelIndex];
+    const Bifrost::API::Channel& position_ch = channel_index.channel(positionChannelIndex);
     if (!position_ch.valid())
         return 1;
-    const Bifrost::API::Channel& velocity_ch = component.channels()[velocityChannelIndex];
+    const Bifrost::API::Channel& velocity_ch = channel_index.channel(velocityChannelIndex);
     if (!velocity_ch.valid())
         return 1;
     if ( position_ch.dataType() != Bifrost::API::FloatV3Type)
@@ -149,29 +159,35 @@ int determine_points_with_velocity_bbox(const Bifrost::API::Component& component
         return 1;
 
     Bifrost::API::Layout layout = component.layout();
-    size_t depthCount = layout.depthCount();
     float fps_1 = 1.0/fps;
-    for ( size_t d=0; d<depthCount; d++ ) {
-        for ( size_t t=0; t<layout.tileCount(d); t++ ) {
-            Bifrost::API::TreeIndex tindex(t,d);
-            if ( !position_ch.elementCount( tindex ) ) {
-                // nothing there
-                continue;
-            }
-            if (position_ch.elementCount( tindex ) != velocity_ch.elementCount( tindex ))
-                return 1;
-            const Bifrost::API::TileData<amino::Math::vec3f>& position_tile_data = position_ch.tileData<amino::Math::vec3f>( tindex );
-            const Bifrost::API::TileData<amino::Math::vec3f>& velocity_tile_data = velocity_ch.tileData<amino::Math::vec3f>( tindex );
-            for (size_t i=0; i<position_tile_data.count(); i++ ) {
-                bounds.extendBy(Imath::V3f(position_tile_data[i][0],
-                                           position_tile_data[i][1],
-                                           position_tile_data[i][2]));
-                bounds.extendBy(Imath::V3f(position_tile_data[i][0] + (fps_1 * velocity_tile_data[i][0]),
-                                           position_tile_data[i][1] + (fps_1 * velocity_tile_data[i][1]),
-                                           position_tile_data[i][2] + (fps_1 * velocity_tile_data[i][2])));
-            }
+    TileTraversal traversal(layout,position_ch);
+    std::vector<Imath::Box3f> tile_bounds(traversal.tileCount());
+    tbb::atomic<size_t> mismatched_tile_count;
+    mismatched_tile_count = 0;
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        if (tile.elementCount != velocity_ch.elementCount( tile.index ))
+        {
+            mismatched_tile_count++;
+            return;
         }
-    }
+        size_t bufferSize = 0;
+        const float* position_tile_data = static_cast<const float*>(position_ch.tileDataPtr( tile.index, bufferSize ));
+        const float* velocity_tile_data = static_cast<const float*>(velocity_ch.tileDataPtr( tile.index, bufferSize ));
+        if (!position_tile_data || !velocity_tile_data)
+        {
+            mismatched_tile_count++;
+            return;
+        }
+        float tile_min[3], tile_max[3];
+        init_bounds(tile_min,tile_max);
+        velocity_extruded_bounds(position_tile_data,velocity_tile_data,tile.elementCount,1.0f,fps_1,tile_min,tile_max);
+        tile_bounds[tile.ordinal] = Imath::Box3f(Imath::V3f(tile_min[0],tile_min[1],tile_min[2]),
+                                                 Imath::V3f(tile_max[0],tile_max[1],tile_max[2]));
+    });
+    if (mismatched_tile_count > 0)
+        return 1;
+    for (size_t i=0; i<tile_bounds.size(); i++ )
+        bounds.extendBy(tile_bounds[i]);
 
     return 0;
 }
@@ -551,6 +567,365 @@ int process_bifrost_voxel_autodesk(const std::string& bifrost_filename)
 	return 0;
 }
 
+/*!
+ * \brief Content of a Bifrost file header, read without loading any tile
+ */
+struct ChannelHeader
+{
+    std::string            name;
+    Bifrost::API::DataType dataType;
+    size_t                 maxDepth;
+    size_t                 tileCount;
+    size_t                 elementCount;
+};
+typedef std::vector<ChannelHeader> ChannelHeaderContainer;
+
+struct FileHeader
+{
+    std::string            filename;
+    std::string            version; /*!< numeric, kept as formatted by the SDK */
+    std::string            frame;   /*!< numeric, kept as formatted by the SDK */
+    std::string            componentName;
+    std::string            componentType;
+    std::string            objectName;
+    std::string            layoutName;
+    ChannelHeaderContainer channels;
+};
+
+void read_file_header(const std::string& bifrost_filename,
+                      Bifrost::API::FileIO& fileio,
+                      FileHeader& o_header)
+{
+    const Bifrost::API::BIF::FileInfo& info = fileio.info();
+    o_header.filename = bifrost_filename;
+    o_header.version = (boost::format("%1%") % info.version).str();
+    o_header.frame = (boost::format("%1%") % info.frame).str();
+    o_header.componentName = info.componentName.c_str();
+    o_header.componentType = info.componentType.c_str();
+    o_header.objectName = info.objectName.c_str();
+    o_header.layoutName = info.layoutName.c_str();
+    o_header.channels.resize(info.channelCount);
+    for (size_t channelIndex=0;channelIndex<info.channelCount;channelIndex++)
+    {
+        const Bifrost::API::BIF::FileInfo::ChannelInfo& channelInfo = fileio.channelInfo(channelIndex);
+        ChannelHeader& channel = o_header.channels[channelIndex];
+        channel.name = channelInfo.name.c_str();
+        channel.dataType = channelInfo.dataType;
+        channel.maxDepth = channelInfo.maxDepth;
+        channel.tileCount = channelInfo.tileCount;
+        channel.elementCount = channelInfo.elementCount;
+    }
+}
+
+void print_header(const FileHeader& header, std::ostream& os)
+{
+    os << boost::format("Version        : %1%") % header.version << std::endl;
+    os << boost::format("Frame          : %1%") % header.frame << std::endl;
+    os << boost::format("Channel count  : %1%") % header.channels.size() << std::endl;
+    os << boost::format("Component name : %1%") % header.componentName << std::endl;
+    os << boost::format("Component type : %1%") % header.componentType << std::endl;
+    os << boost::format("Object name    : %1%") % header.objectName << std::endl;
+    os << boost::format("Layout name    : %1%") % header.layoutName << std::endl;
+
+    for (size_t channelIndex=0;channelIndex<header.channels.size();channelIndex++)
+    {
+        const ChannelHeader& channel = header.channels[channelIndex];
+        os << std::endl;
+        os << boost::format("        Channel name  : %1%") % channel.name << std::endl;
+        os << boost::format("        Data type     : %1%") % channel.dataType << std::endl;
+        os << boost::format("        Max depth     : %1%") % channel.maxDepth << std::endl;
+        os << boost::format("        Tile count    : %1%") % channel.tileCount << std::endl;
+        os << boost::format("        Element count : %1%") % channel.elementCount << std::endl;
+    }
+}
+
+std::string json_string(const std::string& value)
+{
+    std::string quoted("\"");
+    for (size_t i=0;i<value.size();i++)
+    {
+        unsigned char c = value[i];
+        switch (c)
+        {
+        case '"':  quoted += "\\\""; break;
+        case '\\': quoted += "\\\\"; break;
+        case '\n': quoted += "\\n"; break;
+        case '\r': quoted += "\\r"; break;
+        case '\t': quoted += "\\t"; break;
+        default:
+            if (c<0x20)
+                quoted += (boost::format("\\u%04x") % int(c)).str();
+            else
+                quoted += char(c);
+        }
+    }
+    quoted += "\"";
+    return quoted;
+}
+
+/*!
+ * \brief Header as a single line JSON object
+ * \note The fields of the object are left open so callers can append
+ *       their own before closing it with close_header_as_json()
+ */
+void open_header_as_json(const FileHeader& header, std::ostream& os)
+{
+    os << "{\"file\":" << json_string(header.filename)
+       << ",\"version\":" << header.version
+       << ",\"frame\":" << header.frame
+       << ",\"componentName\":" << json_string(header.componentName)
+       << ",\"componentType\":" << json_string(header.componentType)
+       << ",\"objectName\":" << json_string(header.objectName)
+       << ",\"layoutName\":" << json_string(header.layoutName)
+       << ",\"channels\":[";
+    for (size_t channelIndex=0;channelIndex<header.channels.size();channelIndex++)
+    {
+        const ChannelHeader& channel = header.channels[channelIndex];
+        os << (channelIndex ? "," : "")
+           << "{\"name\":" << json_string(channel.name)
+           << ",\"dataType\":" << json_string(data_type_name(channel.dataType))
+           << ",\"maxDepth\":" << channel.maxDepth
+           << ",\"tileCount\":" << channel.tileCount
+           << ",\"elementCount\":" << channel.elementCount
+           << "}";
+    }
+    os << "]";
+}
+
+void close_header_as_json(std::ostream& os)
+{
+    os << "}" << std::endl;
+}
+
+/*!
+ * \brief Header information only, FileIO::load() is never called so no
+ *        tile payload is read
+ */
+int process_bifrost_header(const std::string& bifrost_filename,
+                           bool as_json)
+{
+    Bifrost::API::String biffile = bifrost_filename.c_str();
+    Bifrost::API::ObjectModel om;
+    Bifrost::API::FileIO fileio = om.createFileIO( biffile );
+    if (!fileio.valid())
+    {
+        std::cerr << boost::format("Unable to read the header of the Bifrost file \"%1%\"") % bifrost_filename.c_str()
+                  << std::endl;
+        return 1;
+    }
+    FileHeader header;
+    read_file_header(bifrost_filename,fileio,header);
+    if (as_json)
+    {
+        open_header_as_json(header,std::cout);
+        close_header_as_json(std::cout);
+    }
+    else
+        print_header(header,std::cout);
+    return 0;
+}
+
+/*!
+ * \brief Statistics of one channel, one ChannelStats (and histogram) per
+ *        component of the channel's data type
+ */
+struct ChannelStatsResult
+{
+    std::string               name;
+    Bifrost::API::DataType    dataType;
+    size_t                    tileCount;
+    ChannelStatsContainer     stats;
+    ChannelHistogramContainer histograms;
+};
+
+/*!
+ * \brief Reduces a channel tile by tile across all cores, tile results are
+ *        then merged in traversal order so the output is deterministic
+ * \note The histogram needs the channel's range, it is a second pass over
+ *       the tiles once the statistics are known
+ * \return false if the channel's data type has no statistics
+ */
+bool compute_channel_stats(const Bifrost::API::Layout& layout,
+                           const Bifrost::API::Channel& channel,
+                           size_t bin_count,
+                           ChannelStatsResult& o_result)
+{
+    const Bifrost::API::DataType dataType = channel.dataType();
+    const int components = data_type_component_count(dataType);
+    o_result.name = channel.name().c_str();
+    o_result.dataType = dataType;
+    o_result.tileCount = 0;
+    o_result.stats.clear();
+    o_result.histograms.clear();
+    if (components == 0)
+        return false;
+
+    TileTraversal traversal(layout,channel);
+    o_result.tileCount = traversal.tileCount();
+    std::vector<ChannelStatsContainer> tile_stats(traversal.tileCount(),ChannelStatsContainer(components));
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        size_t bufferSize = 0;
+        const void* tile_data = channel.tileDataPtr( tile.index, bufferSize );
+        if (tile_data)
+            accumulate_channel_stats(tile_data,tile.elementCount,dataType,&tile_stats[tile.ordinal][0]);
+    });
+    o_result.stats.resize(components);
+    for (size_t tileOrdinal=0;tileOrdinal<tile_stats.size();tileOrdinal++)
+        for (int c=0;c<components;c++)
+            o_result.stats[c].merge(tile_stats[tileOrdinal][c]);
+
+    if (bin_count == 0)
+        return true;
+    ChannelHistogramContainer empty_histograms;
+    for (int c=0;c<components;c++)
+        empty_histograms.push_back(ChannelHistogram(o_result.stats[c].min,o_result.stats[c].max,
+                                                    o_result.stats[c].finite_count ? bin_count : 0));
+    std::vector<ChannelHistogramContainer> tile_histograms(traversal.tileCount(),empty_histograms);
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        size_t bufferSize = 0;
+        const void* tile_data = channel.tileDataPtr( tile.index, bufferSize );
+        if (tile_data)
+            accumulate_channel_histogram(tile_data,tile.elementCount,dataType,&tile_histograms[tile.ordinal][0]);
+    });
+    o_result.histograms = empty_histograms;
+    for (size_t tileOrdinal=0;tileOrdinal<tile_histograms.size();tileOrdinal++)
+        for (int c=0;c<components;c++)
+            o_result.histograms[c].merge(tile_histograms[tileOrdinal][c]);
+    return true;
+}
+
+const char* component_label(size_t component, size_t component_count)
+{
+    static const char* labels[] = { "x", "y", "z", "w" };
+    if (component_count == 1)
+        return "";
+    if (component_count <= 4)
+        return labels[component];
+    static const char* matrix_labels[] = { "m00", "m01", "m02", "m03",
+                                           "m10", "m11", "m12", "m13",
+                                           "m20", "m21", "m22", "m23",
+                                           "m30", "m31", "m32", "m33" };
+    return component < 16 ? matrix_labels[component] : "";
+}
+
+void print_channel_stats(const ChannelStatsResult& result, std::ostream& os)
+{
+    os << std::endl;
+    os << boost::format("        Channel name  : %1%") % result.name << std::endl;
+    os << boost::format("        Data type     : %1%") % data_type_name(result.dataType) << std::endl;
+    os << boost::format("        Tile count    : %1%") % result.tileCount << std::endl;
+    for (size_t c=0;c<result.stats.size();c++)
+    {
+        const ChannelStats& stats = result.stats[c];
+        std::string prefix = (boost::format("        %-3s ") % component_label(c,result.stats.size())).str();
+        os << prefix << boost::format("count %1%, finite %2%, non-zero %3%, NaN %4%, Inf %5%")
+            % stats.count % stats.finite_count % stats.nonzero_count % stats.nan_count % stats.inf_count << std::endl;
+        if (stats.finite_count)
+            os << prefix << boost::format("min %1%, max %2%, mean %3%, stddev %4%")
+                % stats.min % stats.max % stats.mean % stats.stddev() << std::endl;
+        if (c < result.histograms.size() && !result.histograms[c].bins.empty())
+        {
+            const ChannelHistogram& histogram = result.histograms[c];
+            os << prefix << boost::format("histogram [%1%,%2%] :") % histogram.min % histogram.max;
+            for (size_t bin=0;bin<histogram.bins.size();bin++)
+                os << " " << histogram.bins[bin];
+            os << std::endl;
+        }
+    }
+}
+
+void print_channel_stats_as_json(const std::string& bifrost_filename,
+                                 const std::string& component_name,
+                                 const ChannelStatsResult& result,
+                                 std::ostream& os)
+{
+    os << "{\"file\":" << json_string(bifrost_filename)
+       << ",\"component\":" << json_string(component_name)
+       << ",\"channel\":" << json_string(result.name)
+       << ",\"dataType\":" << json_string(data_type_name(result.dataType))
+       << ",\"tileCount\":" << result.tileCount
+       << ",\"stats\":[";
+    for (size_t c=0;c<result.stats.size();c++)
+    {
+        const ChannelStats& stats = result.stats[c];
+        os << (c ? "," : "")
+           << "{\"count\":" << stats.count
+           << ",\"finiteCount\":" << stats.finite_count
+           << ",\"nonzeroCount\":" << stats.nonzero_count
+           << ",\"nanCount\":" << stats.nan_count
+           << ",\"infCount\":" << stats.inf_count;
+        if (stats.finite_count)
+            os << ",\"min\":" << stats.min
+               << ",\"max\":" << stats.max
+               << ",\"mean\":" << stats.mean
+               << ",\"stddev\":" << stats.stddev();
+        if (c < result.histograms.size() && !result.histograms[c].bins.empty())
+        {
+            const ChannelHistogram& histogram = result.histograms[c];
+            os << ",\"histogram\":{\"min\":" << histogram.min
+               << ",\"max\":" << histogram.max
+               << ",\"bins\":[";
+            for (size_t bin=0;bin<histogram.bins.size();bin++)
+                os << (bin ? "," : "") << histogram.bins[bin];
+            os << "]}";
+        }
+        os << "}";
+    }
+    os << "]}" << std::endl;
+}
+
+/*!
+ * \brief Statistics of every channel of every voxel component
+ */
+int process_bifrost_stats(const std::string& bifrost_filename,
+                          size_t bin_count,
+                          bool as_json)
+{
+    Bifrost::API::String biffile = bifrost_filename.c_str();
+    Bifrost::API::ObjectModel om;
+    Bifrost::API::FileIO fileio = om.createFileIO( biffile );
+    Bifrost::API::StateServer ss = fileio.load( );
+    if (!ss.valid())
+    {
+        std::cerr << boost::format("Unable to load the content of the Bifrost file \"%1%\"") % bifrost_filename.c_str()
+                  << std::endl;
+        return 1;
+    }
+    if (!as_json)
+        std::cout << boost::format("Statistics kernels : %1%") % point_kernel_isa_name() << std::endl;
+    size_t numComponents = ss.components().count();
+    for (size_t componentIndex=0;componentIndex<numComponents;componentIndex++)
+    {
+        Bifrost::API::Component component = ss.components()[componentIndex];
+        if (component.type() != Bifrost::API::VoxelComponentType)
+            continue;
+        std::string component_name = component.name().c_str();
+        if (!as_json)
+            std::cout << std::endl << boost::format("Voxel component : %1%") % component_name << std::endl;
+        Bifrost::API::Layout layout = component.layout();
+        Bifrost::API::RefArray channel_array = component.channels();
+        for (size_t channelIndex=0;channelIndex<channel_array.count();channelIndex++)
+        {
+            const Bifrost::API::Channel channel = channel_array[channelIndex];
+            if (!channel.valid())
+                continue;
+            ChannelStatsResult result;
+            if (!compute_channel_stats(layout,channel,bin_count,result))
+            {
+                if (!as_json)
+                    std::cout << std::endl << boost::format("        Channel name  : %1% (%2%, no statistics)")
+                        % result.name % data_type_name(result.dataType) << std::endl;
+                continue;
+            }
+            if (as_json)
+                print_channel_stats_as_json(bifrost_filename,component_name,result,std::cout);
+            else
+                print_channel_stats(result,std::cout);
+        }
+    }
+    return 0;
+}
+
 int process_bifrost_file(const std::string& bifrost_filename,
                          const std::string& position_channel_name,
                          const std::string& velocity_channel_name,
@@ -560,26 +935,9 @@ int process_bifrost_file(const std::string& bifrost_filename,
     Bifrost::API::String biffile = bifrost_filename.c_str();
     Bifrost::API::ObjectModel om;
     Bifrost::API::FileIO fileio = om.createFileIO( biffile );
-    const Bifrost::API::BIF::FileInfo& info = fileio.info();
-
-    std::cout << boost::format("Version        : %1%") % info.version << std::endl;
-    std::cout << boost::format("Frame          : %1%") % info.frame << std::endl;
-    std::cout << boost::format("Channel count  : %1%") % info.channelCount << std::endl;
-    std::cout << boost::format("Component name : %1%") % info.componentName.c_str() << std::endl;
-    std::cout << boost::format("Component type : %1%") % info.componentType.c_str() << std::endl;
-    std::cout << boost::format("Object name    : %1%") % info.objectName.c_str() << std::endl;
-    std::cout << boost::format("Layout name    : %1%") % info.layoutName.c_str() << std::endl;
-
-    for (size_t channelIndex=0;channelIndex<info.channelCount;channelIndex++)
-    {
-        std::cout << std::endl;
-        const Bifrost::API::BIF::FileInfo::ChannelInfo& channelInfo = fileio.channelInfo(channelIndex);
-        std::cout << boost::format("        Channel name  : %1%") % channelInfo.name.c_str() << std::endl;
-        std::cout << boost::format("        Data type     : %1%") % channelInfo.dataType << std::endl;
-        std::cout << boost::format("        Max depth     : %1%") % channelInfo.maxDepth << std::endl;
-        std::cout << boost::format("        Tile count    : %1%") % channelInfo.tileCount << std::endl;
-        std::cout << boost::format("        Element count : %1%") % channelInfo.elementCount << std::endl;
-    }
+    FileHeader header;
+    read_file_header(bifrost_filename,fileio,header);
+    print_header(header,std::cout);
 
     if (bbox_type != BBOX::None)
     {
@@ -613,6 +971,284 @@ int process_bifrost_file(const std::string& bifrost_filename,
     return 0;
 }
 
+/*!
+ * \brief What the batch scanner reports for each file
+ * \note Bounds are only available when a bounding box type is requested,
+ *       otherwise the file is never loaded and the element count comes
+ *       from the header
+ */
+struct ScanResult
+{
+    ScanResult()
+    : header_valid(false)
+    , loaded(false)
+    , load_valid(false)
+    , component_count(0)
+    , element_count(0)
+    , has_bounds(false)
+    , has_frame_bounds(false)
+    , tile_index_requested(false)
+    , tile_index_written(false)
+    , header_seconds(0)
+    , load_seconds(0)
+    , total_seconds(0)
+    {}
+    FileHeader   header;
+    bool         header_valid;
+    bool         loaded;
+    bool         load_valid;
+    size_t       component_count;
+    size_t       element_count;
+    bool         has_bounds;
+    Imath::Box3f bounds;
+    bool         has_frame_bounds;
+    BoundsCacheFrame         frame_bounds;
+    BoundsCacheTileContainer tile_bounds;
+    bool         tile_index_requested;
+    bool         tile_index_written;
+    double       header_seconds;
+    double       load_seconds;
+    double       total_seconds;
+
+    bool valid() const
+    {
+        return header_valid && (!loaded || load_valid) && (!tile_index_requested || tile_index_written);
+    }
+};
+
+struct ScanSettings
+{
+    std::string position_channel_name;
+    std::string velocity_channel_name;
+    BBOX        bbox_type;
+    float       fps;
+    bool        compute_bounds_cache; /*!< per-tile bounds for the sidecar, requires a load */
+    bool        build_tile_index;     /*!< write each file's tile index sidecar, requires a load */
+};
+
+/*!
+ * \brief Element count of the position channel listed in the header, the
+ *        largest channel element count if there is no position channel
+ */
+size_t header_element_count(const FileHeader& header,
+                            const std::string& position_channel_name)
+{
+    size_t max_element_count = 0;
+    for (size_t channelIndex=0;channelIndex<header.channels.size();channelIndex++)
+    {
+        const ChannelHeader& channel = header.channels[channelIndex];
+        const std::string& name = channel.name;
+        size_t slash = name.find_last_of('/');
+        if (name == position_channel_name ||
+            (slash != std::string::npos && name.compare(slash+1,std::string::npos,position_channel_name)==0))
+            return channel.elementCount;
+        max_element_count = std::max(max_element_count,channel.elementCount);
+    }
+    return max_element_count;
+}
+
+/*!
+ * \brief Scans one file with its own ObjectModel and FileIO so files can
+ *        be scanned concurrently
+ */
+void scan_bifrost_file(const std::string& bifrost_filename,
+                       const ScanSettings& settings,
+                       ScanResult& o_result)
+{
+    tbb::tick_count start = tbb::tick_count::now();
+    o_result.header.filename = bifrost_filename;
+
+    Bifrost::API::String biffile = bifrost_filename.c_str();
+    Bifrost::API::ObjectModel om;
+    Bifrost::API::FileIO fileio = om.createFileIO( biffile );
+    o_result.header_valid = fileio.valid();
+    if (o_result.header_valid)
+    {
+        read_file_header(bifrost_filename,fileio,o_result.header);
+        o_result.element_count = header_element_count(o_result.header,settings.position_channel_name);
+    }
+    tbb::tick_count header_done = tbb::tick_count::now();
+    o_result.header_seconds = (header_done - start).seconds();
+
+    if (o_result.header_valid && (settings.bbox_type != BBOX::None || settings.compute_bounds_cache || settings.build_tile_index))
+    {
+        o_result.loaded = true;
+        Bifrost::API::StateServer ss = fileio.load( );
+        o_result.load_valid = ss.valid();
+        if (o_result.load_valid)
+        {
+            o_result.element_count = 0;
+            o_result.component_count = ss.components().count();
+            for (size_t componentIndex=0;componentIndex<o_result.component_count;componentIndex++)
+            {
+                Bifrost::API::Component component = ss.components()[componentIndex];
+                if (component.type() != Bifrost::API::PointComponentType)
+                    continue;
+                o_result.element_count += component.elementCount();
+                if (settings.compute_bounds_cache)
+                    o_result.has_frame_bounds |= compute_point_bounds(component,
+                                                                      uint32_t(componentIndex),
+                                                                      settings.position_channel_name,
+                                                                      settings.velocity_channel_name,
+                                                                      settings.fps,
+                                                                      o_result.frame_bounds,
+                                                                      o_result.tile_bounds);
+                Imath::Box3f bounds;
+                int bbox_status = 1;
+                if (settings.bbox_type == BBOX::PointsOnly)
+                    bbox_status = determine_points_bbox(component,
+                                                        settings.position_channel_name,
+                                                        bounds);
+                else if (settings.bbox_type == BBOX::PointsWithVelocity)
+                    bbox_status = determine_points_with_velocity_bbox(component,
+                                                                      settings.position_channel_name,
+                                                                      settings.velocity_channel_name,
+                                                                      settings.fps,
+                                                                      bounds);
+                if (bbox_status == 0 && !bounds.isEmpty())
+                {
+                    o_result.bounds.extendBy(bounds);
+                    o_result.has_bounds = true;
+                }
+            }
+        }
+        o_result.tile_index_requested = settings.build_tile_index;
+        if (o_result.load_valid && settings.build_tile_index)
+        {
+            TileIndex tile_index;
+            o_result.tile_index_written = tile_index.build(ss,settings.position_channel_name)
+                && tile_index.write(tile_index_filename(bifrost_filename));
+        }
+        if (o_result.has_frame_bounds)
+        {
+            int frame = 0;
+            if (!frame_from_filename(bifrost_filename,frame))
+                frame = atoi(o_result.header.frame.c_str());
+            o_result.frame_bounds.frame = frame;
+        }
+        o_result.load_seconds = (tbb::tick_count::now() - header_done).seconds();
+    }
+    o_result.total_seconds = (tbb::tick_count::now() - start).seconds();
+}
+
+void print_scan_table_heading(std::ostream& os)
+{
+    os << boost::format("%-8s %8s %5s %6s %12s %10s %10s  %-48s  %s")
+        % "Status" % "Frame" % "Comp" % "Chans" % "Elements" % "Header ms" % "Load ms" % "Bounds" % "File"
+       << std::endl;
+}
+
+void print_scan_result_as_table(const ScanResult& result, std::ostream& os)
+{
+    std::string bounds("-");
+    if (result.has_bounds)
+        bounds = (boost::format("[%g %g %g] [%g %g %g]")
+                  % result.bounds.min.x % result.bounds.min.y % result.bounds.min.z
+                  % result.bounds.max.x % result.bounds.max.y % result.bounds.max.z).str();
+    os << boost::format("%-8s %8s %5s %6d %12d %10.3f %10.3f  %-48s  %s")
+        % (result.valid() ? "ok" : "FAILED")
+        % (result.header_valid ? result.header.frame : std::string("-"))
+        % (result.loaded ? (boost::format("%1%") % result.component_count).str() : std::string("-"))
+        % result.header.channels.size()
+        % result.element_count
+        % (result.header_seconds*1000.0)
+        % (result.load_seconds*1000.0)
+        % bounds
+        % result.header.filename
+       << std::endl;
+}
+
+void print_scan_result_as_json(const ScanResult& result, std::ostream& os)
+{
+    if (result.header_valid)
+        open_header_as_json(result.header,os);
+    else
+        os << "{\"file\":" << json_string(result.header.filename);
+    os << ",\"status\":" << (result.valid() ? "\"ok\"" : "\"failed\"")
+       << ",\"elementCount\":" << result.element_count;
+    if (result.loaded)
+        os << ",\"componentCount\":" << result.component_count;
+    if (result.has_bounds)
+        os << ",\"bounds\":{\"min\":["
+           << result.bounds.min.x << "," << result.bounds.min.y << "," << result.bounds.min.z
+           << "],\"max\":["
+           << result.bounds.max.x << "," << result.bounds.max.y << "," << result.bounds.max.z
+           << "]}";
+    os << ",\"timing\":{\"headerMs\":" << result.header_seconds*1000.0
+       << ",\"loadMs\":" << result.load_seconds*1000.0
+       << ",\"totalMs\":" << result.total_seconds*1000.0
+       << "}";
+    close_header_as_json(os);
+}
+
+/*!
+ * \brief Scans many files across the TBB worker threads
+ * \note Results are written in input order as soon as they and all the
+ *       files before them are done, as a table or one JSON object per line
+ * \return The number of files that could not be read
+ */
+size_t scan_bifrost_files(const std::vector<std::string>& bifrost_filenames,
+                          const ScanSettings& settings,
+                          size_t max_in_flight,
+                          bool as_json,
+                          BoundsCacheWriter* bounds_cache_writer)
+{
+    tbb::tick_count start = tbb::tick_count::now();
+    size_t failed_count = 0;
+    size_t total_element_count = 0;
+    Imath::Box3f total_bounds;
+
+    if (!as_json)
+        print_scan_table_heading(std::cout);
+
+    size_t next_file = 0;
+    tbb::parallel_pipeline(std::max(max_in_flight,size_t(1)),
+        tbb::make_filter<void,size_t>(tbb::filter::serial_in_order,
+            [&](tbb::flow_control& fc) -> size_t {
+                if (next_file>=bifrost_filenames.size())
+                {
+                    fc.stop();
+                    return 0;
+                }
+                return next_file++;
+            })
+        &
+        tbb::make_filter<size_t,ScanResult*>(tbb::filter::parallel,
+            [&](size_t fileIndex) -> ScanResult* {
+                ScanResult* result = new ScanResult;
+                scan_bifrost_file(bifrost_filenames[fileIndex],settings,*result);
+                return result;
+            })
+        &
+        tbb::make_filter<ScanResult*,void>(tbb::filter::serial_in_order,
+            [&](ScanResult* result) {
+                if (!result->valid())
+                    failed_count++;
+                total_element_count += result->element_count;
+                if (result->has_bounds)
+                    total_bounds.extendBy(result->bounds);
+                if (bounds_cache_writer && result->has_frame_bounds)
+                    bounds_cache_writer->add_frame(result->frame_bounds,result->tile_bounds);
+                if (as_json)
+                    print_scan_result_as_json(*result,std::cout);
+                else
+                    print_scan_result_as_table(*result,std::cout);
+                delete result;
+            })
+        );
+
+    if (!as_json)
+    {
+        std::cout << std::endl;
+        std::cout << boost::format("Files          : %1% (%2% failed)") % bifrost_filenames.size() % failed_count << std::endl;
+        std::cout << boost::format("Elements       : %1%") % total_element_count << std::endl;
+        if (!total_bounds.isEmpty())
+            std::cout << "Bounds         : min [" << total_bounds.min << "] max[" << total_bounds.max << "]" << std::endl;
+        std::cout << boost::format("Elapsed        : %.3f s") % (tbb::tick_count::now() - start).seconds() << std::endl;
+    }
+    return failed_count;
+}
+
 int main(int argc, char **argv)
 {
 
@@ -622,16 +1258,35 @@ int main(int argc, char **argv)
 		std::string velocity_channel_name("velocity");
 		BBOX bbox_type = BBOX::None;
 		std::string bifrost_filename;
+		bool header_only = false;
+		bool as_json = false;
 		float fps = 24.0f;
+		std::string frame_range_string;
+		size_t thread_count = 0;
+		std::string bounds_cache_filename_string;
+		size_t histogram_bin_count = 16;
 		po::options_description desc("Allowed options");
 		desc.add_options()
 			("version", "print version string")
 			("help", "produce help message")
+			("header-only", "Only read the file header, no tile is loaded. This is the default when no analysis is requested")
+			("json", "Output the header, the bounds of --bbox or the statistics of --stats as a single line JSON object, one object per line (NDJSON) when scanning several files. Not available with --voxels")
+			("frames", po::value<std::string>(&frame_range_string),
+				"Frame range used to expand '%04d' or '####' input patterns, e.g. 1001-1240 or 1001-1240x2. Without it the files on disk matching the pattern are scanned")
+			("threads", po::value<size_t>(&thread_count),
+				"Number of worker threads used to scan several files. Defaults to the number of cores")
+			("voxels", "Load the file and walk the tiles of the voxel components")
+			("stats", "Load the file and compute min/max/mean/stddev, non-zero, NaN and Inf counts and a histogram of every channel of the voxel components")
+			("histogram-bins", po::value<size_t>(&histogram_bin_count),
+				"Number of histogram bins of --stats, 0 disables the histogram. Defaults to 16")
+			("build-index", "Write a per-tile spatial index next to each file (liquid.0012.bif -> liquid.0012.tidx) with the world space bounds, element count and element offset of every tile, used to only process the tiles inside a region of interest")
+			("write-bounds", po::value<std::string>(&bounds_cache_filename_string)->implicit_value(""),
+				"Write the per-frame and per-tile bounds of all the files into a sidecar index, read by the procedurals and BifrostSurfaceShape instead of loading the files. Defaults to the sequence name with a .bounds extension, e.g. liquid.bounds")
 			("bbox", po::value<BBOX>(&bbox_type), "Analyze the entire file to obtain the overall bounding box [0:None, 1:PointsOnly, 2:PointsWithVelocity]")
 			("fps", po::value<float>(&fps),
 				"Frames per second to scale velocity when determining the velocity-attenuated bounding box. Defaults to 24.0")
 				("input-file", po::value<std::vector<std::string> >(),
-					"input files")
+					"input files, directories, globs or frame patterns. More than one file scans them all concurrently")
 			;
 
 		po::positional_options_description p;
@@ -645,31 +1300,93 @@ int main(int argc, char **argv)
 			std::cout << desc << "\n";
 			return 1;
 		}
+		as_json = vm.count("json") > 0;
+		if (vm.count("header-only") && (bbox_type != BBOX::None || vm.count("voxels") || vm.count("stats")
+										|| vm.count("write-bounds") || vm.count("build-index")))
+		{
+			std::cerr << "--header-only loads no tile, it cannot be combined with --bbox, --stats, --voxels, --write-bounds or --build-index" << std::endl;
+			return 1;
+		}
+		header_only = vm.count("header-only") > 0 || (bbox_type == BBOX::None && !vm.count("voxels") && !vm.count("stats"));
+		const bool single_file_analysis = !header_only && (vm.count("voxels") || vm.count("stats"));
+		if (as_json && !header_only && vm.count("voxels") && !vm.count("stats"))
+		{
+			std::cerr << "--voxels has no JSON output" << std::endl;
+			return 1;
+		}
 		if (vm.count("input-file"))
 		{
-			std::cout << "Input files are: "
-				<< vm["input-file"].as< std::vector<std::string> >() << "\n";
-			if (vm["input-file"].as< std::vector<std::string> >().size() == 1)
+			const StringContainer& inputs = vm["input-file"].as< StringContainer >();
+			FrameRange frame_range;
+			if (vm.count("frames") && !parse_frame_range(frame_range_string,frame_range))
+			{
+				std::cerr << boost::format("Invalid frame range \"%1%\"") % frame_range_string << std::endl;
+				return 1;
+			}
+			StringContainer bifrost_filenames;
+			for (size_t inputIndex=0;inputIndex<inputs.size();inputIndex++)
 			{
-				bifrost_filename = vm["input-file"].as< std::vector<std::string> >()[0];
+				if (!expand_input_path(inputs[inputIndex],vm.count("frames") ? &frame_range : 0,bifrost_filenames))
+					std::cerr << boost::format("No Bifrost file found for \"%1%\"") % inputs[inputIndex] << std::endl;
 			}
-			else
+			if (bifrost_filenames.empty())
+				return 1;
+			bool write_bounds = vm.count("write-bounds") > 0;
+			bool build_index = vm.count("build-index") > 0;
+			bool scan_mode = inputs.size() > 1 || bifrost_filenames.size() != 1 || bifrost_filenames[0] != inputs[0] || write_bounds || build_index;
+			if (scan_mode && single_file_analysis)
 			{
-				std::cout << desc << "\n";
+				std::cerr << "--stats and --voxels analyze a single file, they cannot be combined with several inputs, --write-bounds or --build-index" << std::endl;
 				return 1;
 			}
+			// The scan reports the bounds of a single file as JSON too
+			if (scan_mode || (as_json && !header_only && !single_file_analysis))
+			{
+				ScanSettings settings;
+				settings.position_channel_name = position_channel_name;
+				settings.velocity_channel_name = velocity_channel_name;
+				settings.bbox_type = bbox_type;
+				settings.fps = fps;
+				settings.compute_bounds_cache = write_bounds;
+				settings.build_tile_index = build_index;
+				int num_threads = thread_count > 0 ? int(thread_count) : tbb::task_scheduler_init::default_num_threads();
+				tbb::task_scheduler_init scheduler(num_threads);
+				BoundsCacheWriter bounds_cache_writer(fps);
+				size_t failed_count = scan_bifrost_files(bifrost_filenames,settings,size_t(num_threads)*2,as_json,
+														 write_bounds ? &bounds_cache_writer : 0);
+				if (write_bounds)
+				{
+					if (bounds_cache_filename_string.empty())
+						bounds_cache_filename_string = bounds_cache_filename(bifrost_filenames[0]);
+					if (!bounds_cache_writer.write(bounds_cache_filename_string))
+					{
+						std::cerr << boost::format("Unable to write the bounds cache \"%1%\"") % bounds_cache_filename_string << std::endl;
+						return 1;
+					}
+					if (!as_json)
+						std::cout << boost::format("Bounds cache   : %1%") % bounds_cache_filename_string << std::endl;
+				}
+				return failed_count > 0 ? 1 : 0;
+			}
+			if (!as_json)
+				std::cout << "Input files are: " << inputs << "\n";
+			bifrost_filename = bifrost_filenames[0];
 		}
-		std::cout << "fps = " << fps << std::endl;
 		if (bifrost_filename.size() > 0)
 		{
-			process_bifrost_voxel(bifrost_filename);
-			/*
-			process_bifrost_file(bifrost_filename,
+			if (header_only)
+				return process_bifrost_header(bifrost_filename,as_json);
+			if (vm.count("stats"))
+				return process_bifrost_stats(bifrost_filename,histogram_bin_count,as_json);
+			if (vm.count("voxels"))
+				return process_bifrost_voxel(bifrost_filename);
+			if (bbox_type == BBOX::PointsWithVelocity)
+				std::cout << "fps = " << fps << std::endl;
+			return process_bifrost_file(bifrost_filename,
 				position_channel_name,
 				velocity_channel_name,
 				bbox_type,
 				bbox_type == BBOX::PointsWithVelocity ? &fps : 0);
-				*/
 		}
 		else
         {
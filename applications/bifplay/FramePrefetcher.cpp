@@ -0,0 +1,166 @@
+#include "FramePrefetcher.h"
+#include <utils/PointLOD.h>
+#include <algorithm>
+
+FramePrefetcher::FramePrefetcher(const std::vector<std::string>& filenames,
+                                 const std::string& position_channel_name,
+                                 const std::string& id_channel_name,
+                                 const std::string& color_channel_name,
+                                 size_t ring_size,
+                                 size_t worker_count)
+: _filenames(filenames)
+, _position_channel_name(position_channel_name)
+, _id_channel_name(id_channel_name)
+, _lod_fractions(PointLOD::default_fractions())
+, _color_channel_name(color_channel_name)
+, _ring_size(std::max(std::min(ring_size,filenames.size()),size_t(1)))
+, _ring(_ring_size)
+, _failed(filenames.size(),0)
+, _loading(filenames.size(),0)
+, _playhead(0)
+, _generation(0)
+, _stop(false)
+{
+    worker_count = std::max(std::min(worker_count,_ring_size),size_t(1));
+    for (size_t i=0;i<worker_count;i++)
+        _threads.push_back(std::thread(&FramePrefetcher::run,this));
+}
+
+FramePrefetcher::~FramePrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (size_t i=0;i<_threads.size();i++)
+        _threads[i].join();
+}
+
+void FramePrefetcher::set_playhead(int frame_index)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_playhead == frame_index)
+            return;
+        _playhead = frame_index;
+    }
+    _wake.notify_all();
+}
+
+void FramePrefetcher::set_color_channel(const std::string& color_channel_name)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _color_channel_name = color_channel_name;
+        _generation++;
+        std::fill(_ring.begin(),_ring.end(),PointFramePtr());
+        std::fill(_failed.begin(),_failed.end(),0);
+    }
+    _wake.notify_all();
+}
+
+PointFramePtr FramePrefetcher::frame(int frame_index) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    int slot = find_slot(frame_index);
+    return slot>=0 ? _ring[slot] : PointFramePtr();
+}
+
+bool FramePrefetcher::failed(int frame_index) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _failed[frame_index] != 0;
+}
+
+PointFramePtr FramePrefetcher::wait_for_frame(int frame_index)
+{
+    set_playhead(frame_index);
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;)
+    {
+        int slot = find_slot(frame_index);
+        if (slot>=0)
+            return _ring[slot];
+        if (_failed[frame_index] || _stop)
+            return PointFramePtr();
+        _loaded.wait(lock);
+    }
+}
+
+bool FramePrefetcher::in_window(int frame_index) const
+{
+    size_t distance = (frame_index - _playhead + _filenames.size()) % _filenames.size();
+    return distance < _ring_size;
+}
+
+int FramePrefetcher::find_slot(int frame_index) const
+{
+    for (size_t i=0;i<_ring_size;i++)
+        if (_ring[i] && _ring[i]->frame_index == frame_index)
+            return int(i);
+    return -1;
+}
+
+size_t FramePrefetcher::free_slot() const
+{
+    for (size_t i=0;i<_ring_size;i++)
+        if (!_ring[i] || !in_window(_ring[i]->frame_index))
+            return i;
+    return 0; // not reached, the window is never larger than the ring
+}
+
+bool FramePrefetcher::next_missing_frame(int& o_frame_index) const
+{
+    if (_filenames.empty())
+        return false;
+    // Closest to the playhead first
+    for (size_t i=0;i<_ring_size;i++)
+    {
+        int frame_index = int((_playhead + i) % _filenames.size());
+        if (find_slot(frame_index)<0 && !_failed[frame_index] && !_loading[frame_index])
+        {
+            o_frame_index = frame_index;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FramePrefetcher::run()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stop)
+    {
+        int frame_index = 0;
+        if (!next_missing_frame(frame_index))
+        {
+            _wake.wait(lock);
+            continue;
+        }
+        const unsigned int generation = _generation;
+        const std::string color_channel_name = _color_channel_name;
+        _loading[frame_index] = 1;
+        lock.unlock();
+
+        std::shared_ptr<PointFrame> point_frame(new PointFrame);
+        point_frame->frame_index = frame_index;
+        bool status = load_point_frame(_filenames[frame_index],_position_channel_name,color_channel_name,
+                                       _id_channel_name,_lod_fractions,*point_frame);
+
+        lock.lock();
+        _loading[frame_index] = 0;
+        if (generation != _generation)
+        {
+            // Loaded with the previous color, the next free worker reloads it
+            _wake.notify_all();
+            continue;
+        }
+        if (!status)
+            _failed[frame_index] = 1;
+        else if (in_window(frame_index) && find_slot(frame_index)<0)
+            _ring[free_slot()] = point_frame;
+        _loaded.notify_all();
+        _wake.notify_all();
+    }
+}
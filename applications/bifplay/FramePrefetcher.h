@@ -0,0 +1,74 @@
+#pragma once
+
+#include "PointCloudLoader.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*!
+ * \brief Decodes the frames following the playhead on worker_count
+ *        background threads into a ring of ring_size frames
+ * \note The window wraps around the end of the sequence so looping playback
+ *       does not stall on the first frame, a frame can then not be slotted
+ *       by its index alone : it takes any slot holding a frame outside the
+ *       window, of which there is always one. Frames are handed out as
+ *       shared pointers, a slot can be overwritten while the viewer still
+ *       draws the frame it held
+ */
+class FramePrefetcher
+{
+public:
+    FramePrefetcher(const std::vector<std::string>& filenames,
+                    const std::string& position_channel_name,
+                    const std::string& id_channel_name,
+                    const std::string& color_channel_name,
+                    size_t ring_size,
+                    size_t worker_count = 1);
+    ~FramePrefetcher();
+
+    size_t frame_count() const { return _filenames.size(); }
+    const std::string& filename(int frame_index) const { return _filenames[frame_index]; }
+
+    /*! \brief Moves the prefetch window, frames behind it get recycled */
+    void set_playhead(int frame_index);
+    /*! \brief Drops the decoded frames, they are reloaded with the new color */
+    void set_color_channel(const std::string& color_channel_name);
+
+    /*! \brief The decoded frame, null if it is not ready yet */
+    PointFramePtr frame(int frame_index) const;
+    /*! \brief True if the frame could not be loaded, it is not retried */
+    bool failed(int frame_index) const;
+    /*!
+     * \brief Blocks until the frame is decoded
+     * \return null if the frame failed to load
+     */
+    PointFramePtr wait_for_frame(int frame_index);
+
+private:
+    bool in_window(int frame_index) const;
+    /*! \return The slot holding the frame, -1 if it is not in the ring */
+    int find_slot(int frame_index) const;
+    /*! \return An empty slot or one holding a frame outside the window */
+    size_t free_slot() const;
+    bool next_missing_frame(int& o_frame_index) const;
+    void run();
+
+    std::vector<std::string>   _filenames;
+    std::string                _position_channel_name;
+    std::string                _id_channel_name;
+    std::vector<float>         _lod_fractions;
+    std::string                _color_channel_name;
+    size_t                     _ring_size;
+    std::vector<PointFramePtr> _ring;
+    std::vector<char>          _failed;     /*!< per frame, not retried */
+    std::vector<char>          _loading;    /*!< per frame, taken by a worker */
+    int                        _playhead;
+    unsigned int               _generation; /*!< bumped when the color changes */
+    bool                       _stop;
+    mutable std::mutex         _mutex;
+    std::condition_variable    _wake;
+    std::condition_variable    _loaded;
+    std::vector<std::thread>   _threads;
+};
@@ -0,0 +1,113 @@
+#include "OffscreenContext.h"
+#include <boost/format.hpp>
+#include <iostream>
+#include <string.h>
+
+OffscreenContext::OffscreenContext()
+: _width(0)
+, _height(0)
+#ifdef BIFPLAY_USE_OSMESA
+, _context(0)
+#else
+, _window(0)
+#endif // BIFPLAY_USE_OSMESA
+, _framebuffer(0)
+, _color_renderbuffer(0)
+, _depth_renderbuffer(0)
+{
+}
+
+OffscreenContext::~OffscreenContext()
+{
+    if (_framebuffer)
+    {
+        glDeleteFramebuffers(1, &_framebuffer);
+        glDeleteRenderbuffers(1, &_color_renderbuffer);
+        glDeleteRenderbuffers(1, &_depth_renderbuffer);
+    }
+#ifdef BIFPLAY_USE_OSMESA
+    if (_context)
+        OSMesaDestroyContext(_context);
+#else
+    if (_window)
+    {
+        glfwDestroyWindow(_window);
+        glfwTerminate();
+    }
+#endif // BIFPLAY_USE_OSMESA
+}
+
+bool OffscreenContext::create(int width, int height)
+{
+    _width = width;
+    _height = height;
+#ifdef BIFPLAY_USE_OSMESA
+    _context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+    if (!_context)
+    {
+        std::cerr << "bifplay : unable to create the OSMesa context" << std::endl;
+        return false;
+    }
+    _buffer.resize(size_t(width)*height*4);
+    if (!OSMesaMakeCurrent(_context, &_buffer[0], GL_UNSIGNED_BYTE, width, height))
+    {
+        std::cerr << "bifplay : unable to make the OSMesa context current" << std::endl;
+        return false;
+    }
+#else
+    if (!glfwInit())
+        return false;
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    _window = glfwCreateWindow(width, height, "bifplay", NULL, NULL);
+    if (!_window)
+    {
+        std::cerr << "bifplay : unable to create the offscreen context, no display ?" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(_window);
+#endif // BIFPLAY_USE_OSMESA
+
+    GLenum err = glewInit();
+    if (GLEW_OK != err)
+    {
+        std::cerr << boost::format("bifplay : glewInit failed : %1%") % glewGetErrorString(err) << std::endl;
+        return false;
+    }
+
+    // The default framebuffer of a hidden window may not be width x height
+    glGenFramebuffers(1, &_framebuffer);
+    glGenRenderbuffers(1, &_color_renderbuffer);
+    glGenRenderbuffers(1, &_depth_renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _color_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depth_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _color_renderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depth_renderbuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "bifplay : incomplete offscreen framebuffer" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void OffscreenContext::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+}
+
+void OffscreenContext::read_pixels(std::vector<unsigned char>& o_rgba) const
+{
+    const size_t row_size = size_t(_width)*4;
+    std::vector<unsigned char> bottom_up(row_size*_height);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, &bottom_up[0]);
+    o_rgba.resize(bottom_up.size());
+    for (int y=0;y<_height;y++)
+        memcpy(&o_rgba[y*row_size], &bottom_up[(_height-1-y)*row_size], row_size);
+}
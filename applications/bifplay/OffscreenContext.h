@@ -0,0 +1,47 @@
+#pragma once
+
+#include <GL/glew.h>
+#ifdef BIFPLAY_USE_OSMESA
+#include <GL/osmesa.h>
+#else
+#include <GLFW/glfw3.h>
+#endif // BIFPLAY_USE_OSMESA
+#include <vector>
+
+/*!
+ * \brief GL context without a visible window, rendering into a framebuffer
+ *        object of the requested size
+ * \note Built with BIFPLAY_USE_OSMESA the context is a Mesa software one
+ *       and needs no display or GPU (GLEW must then be built with
+ *       GLEW_OSMESA). Otherwise a hidden GLFW window provides the context,
+ *       which still needs an X server, e.g. Xvfb
+ */
+class OffscreenContext
+{
+public:
+    OffscreenContext();
+    ~OffscreenContext();
+
+    /*! \brief Creates the context, makes it current and initializes GLEW */
+    bool create(int width, int height);
+    /*! \brief Binds the framebuffer object, rendering then goes to it */
+    void bind() const;
+    /*! \brief RGBA pixels of the framebuffer object, rows top to bottom */
+    void read_pixels(std::vector<unsigned char>& o_rgba) const;
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+
+private:
+    int                        _width;
+    int                        _height;
+#ifdef BIFPLAY_USE_OSMESA
+    OSMesaContext              _context;
+    std::vector<unsigned char> _buffer;
+#else
+    GLFWwindow*                _window;
+#endif // BIFPLAY_USE_OSMESA
+    GLuint                     _framebuffer;
+    GLuint                     _color_renderbuffer;
+    GLuint                     _depth_renderbuffer;
+};
@@ -0,0 +1,75 @@
+#include "PngWriter.h"
+#include <zlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+void append_uint32(std::vector<unsigned char>& io_bytes, uint32_t value)
+{
+    io_bytes.push_back((unsigned char)(value >> 24));
+    io_bytes.push_back((unsigned char)(value >> 16));
+    io_bytes.push_back((unsigned char)(value >> 8));
+    io_bytes.push_back((unsigned char)(value));
+}
+
+/*! \brief Length, type, data and the CRC of type and data */
+bool write_chunk(FILE* file, const char type[4], const unsigned char* data, size_t size)
+{
+    std::vector<unsigned char> header;
+    append_uint32(header,uint32_t(size));
+    header.insert(header.end(),type,type+4);
+    uLong crc = crc32(0L,Z_NULL,0);
+    crc = crc32(crc,reinterpret_cast<const Bytef*>(type),4);
+    if (size)
+        crc = crc32(crc,data,uInt(size));
+    std::vector<unsigned char> footer;
+    append_uint32(footer,uint32_t(crc));
+    return fwrite(&header[0],1,header.size(),file)==header.size()
+        && (size==0 || fwrite(data,1,size,file)==size)
+        && fwrite(&footer[0],1,footer.size(),file)==footer.size();
+}
+
+} // anonymous namespace
+
+bool write_png(const std::string& filename,
+               int width,
+               int height,
+               const unsigned char* rgba)
+{
+    if (width <= 0 || height <= 0)
+        return false;
+    // Each row is preceded by its filter type, 0 (none)
+    const size_t row_size = size_t(width)*4;
+    std::vector<unsigned char> scanlines((row_size+1)*height);
+    for (int y=0;y<height;y++)
+    {
+        scanlines[y*(row_size+1)] = 0;
+        memcpy(&scanlines[y*(row_size+1)+1],rgba+y*row_size,row_size);
+    }
+    uLongf compressed_size = compressBound(uLong(scanlines.size()));
+    std::vector<unsigned char> compressed(compressed_size);
+    if (compress2(&compressed[0],&compressed_size,&scanlines[0],uLong(scanlines.size()),Z_BEST_SPEED) != Z_OK)
+        return false;
+
+    std::vector<unsigned char> ihdr;
+    append_uint32(ihdr,uint32_t(width));
+    append_uint32(ihdr,uint32_t(height));
+    ihdr.push_back(8); // bit depth
+    ihdr.push_back(6); // RGBA
+    ihdr.push_back(0); // deflate
+    ihdr.push_back(0); // adaptive filtering
+    ihdr.push_back(0); // no interlace
+
+    FILE* file = fopen(filename.c_str(),"wb");
+    if (!file)
+        return false;
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    bool status = fwrite(signature,1,sizeof(signature),file)==sizeof(signature)
+        && write_chunk(file,"IHDR",&ihdr[0],ihdr.size())
+        && write_chunk(file,"IDAT",&compressed[0],compressed_size)
+        && write_chunk(file,"IEND",0,0);
+    return fclose(file)==0 && status;
+}
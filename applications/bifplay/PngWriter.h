@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+/*!
+ * \brief Writes 8 bits RGBA pixels, rows top to bottom, as a PNG
+ * \note Uses zlib only, a single IDAT chunk with no row filtering
+ */
+bool write_png(const std::string& filename,
+               int width,
+               int height,
+               const unsigned char* rgba);
@@ -0,0 +1,228 @@
+#include "PointCloudLoader.h"
+#include <BifrostHeaders.h>
+#include <utils/BifrostUtils.h>
+#include <utils/PointKernels.h>
+#include <utils/PointLOD.h>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+
+namespace {
+
+std::string short_channel_name(const std::string& channel_name)
+{
+    size_t slash = channel_name.find_last_of('/');
+    return slash == std::string::npos ? channel_name : channel_name.substr(slash+1);
+}
+
+/*! \brief Where a component's points are in the frame and its level sizes */
+struct ComponentLevels
+{
+    size_t              offset;
+    std::vector<size_t> level_point_counts;
+};
+
+void reorder_slice(const PointLOD& lod,
+                   std::vector<float>& io_data,
+                   size_t point_offset,
+                   size_t components)
+{
+    if (lod.point_count() == 0)
+        return;
+    float* slice = &io_data[point_offset*components];
+    std::vector<float> reordered(lod.point_count()*components);
+    lod.reorder(slice,components,&reordered[0]);
+    std::copy(reordered.begin(),reordered.end(),slice);
+}
+
+/*!
+ * \brief Interleaves the components level by level, so that every level of
+ *        the frame is a prefix of its arrays
+ */
+void merge_levels(const std::vector<ComponentLevels>& levels,
+                  PointFrame& io_frame)
+{
+    size_t levelCount = 0;
+    for (size_t i=0;i<levels.size();i++)
+        levelCount = std::max(levelCount,levels[i].level_point_counts.size());
+    if (levels.size() <= 1)
+    {
+        io_frame.lod_point_counts = levels.empty() ? std::vector<size_t>(1,io_frame.point_count) : levels[0].level_point_counts;
+        return;
+    }
+
+    std::vector<float> positions(io_frame.positions.size());
+    std::vector<float> colors(io_frame.colors.size());
+    const size_t color_components = io_frame.color_components;
+    size_t point = 0;
+    io_frame.lod_point_counts.resize(levelCount);
+    for (size_t level=0;level<levelCount;level++)
+    {
+        for (size_t i=0;i<levels.size();i++)
+        {
+            // A component with fewer levels is complete after its last one
+            const std::vector<size_t>& counts = levels[i].level_point_counts;
+            if (level >= counts.size())
+                continue;
+            size_t begin = level == 0 ? 0 : counts[level-1];
+            size_t end = counts[level];
+            size_t source = levels[i].offset+begin;
+            std::copy(io_frame.positions.begin()+source*3,io_frame.positions.begin()+(levels[i].offset+end)*3,positions.begin()+point*3);
+            if (color_components)
+                std::copy(io_frame.colors.begin()+source*color_components,io_frame.colors.begin()+(levels[i].offset+end)*color_components,colors.begin()+point*color_components);
+            point += end-begin;
+        }
+        io_frame.lod_point_counts[level] = point;
+    }
+    io_frame.positions.swap(positions);
+    io_frame.colors.swap(colors);
+}
+
+} // anonymous namespace
+
+bool load_point_frame(const std::string& filename,
+                      const std::string& position_channel_name,
+                      const std::string& color_channel_name,
+                      const std::string& id_channel_name,
+                      const std::vector<float>& lod_fractions,
+                      PointFrame& o_frame)
+{
+    o_frame.filename = filename;
+    o_frame.point_count = 0;
+    o_frame.positions.clear();
+    o_frame.colors.clear();
+    o_frame.color_channel_name.clear();
+    o_frame.color_components = 0;
+    o_frame.color_channel_names.clear();
+    o_frame.lod_point_counts.clear();
+    o_frame.bounds.clear();
+
+    Bifrost::API::ObjectModel om;
+    Bifrost::API::FileIO fileio = om.createFileIO( filename.c_str() );
+    Bifrost::API::StateServer ss = fileio.load( );
+    if ( !ss.valid() )
+    {
+        std::cerr << boost::format("bifplay : unable to load \"%1%\"") % filename << std::endl;
+        return false;
+    }
+
+    // Size the arrays once from the component element counts
+    std::vector<Bifrost::API::Component> point_components;
+    size_t numComponents = ss.components().count();
+    for (size_t i=0;i<numComponents;i++)
+    {
+        Bifrost::API::Component component = ss.components()[i];
+        if (component.type() == Bifrost::API::PointComponentType)
+        {
+            point_components.push_back(component);
+            o_frame.point_count += component.elementCount();
+        }
+    }
+    o_frame.positions.resize(o_frame.point_count*3);
+
+    bool found_positions = false;
+    size_t point_offset = 0;
+    std::vector<ComponentLevels> levels;
+    for (size_t i=0;i<point_components.size();i++)
+    {
+        const Bifrost::API::Component& component = point_components[i];
+        ChannelIndex channel_index(component);
+        Bifrost::API::Channel position_ch;
+        bool position_status = false;
+        get_channel(channel_index,position_channel_name,Bifrost::API::FloatV3Type,position_ch,position_status);
+        if (!position_status)
+            continue;
+
+        for (size_t channelIndex=0;channelIndex<channel_index.count();channelIndex++)
+        {
+            const Bifrost::API::Channel& ch = channel_index.channel(channelIndex);
+            std::string name = short_channel_name(channel_index.name(channelIndex));
+            if ((ch.dataType() == Bifrost::API::FloatType || ch.dataType() == Bifrost::API::FloatV3Type)
+                && std::find(o_frame.color_channel_names.begin(),o_frame.color_channel_names.end(),name) == o_frame.color_channel_names.end())
+                o_frame.color_channel_names.push_back(name);
+        }
+
+        Bifrost::API::Layout layout = component.layout();
+        TileTraversal traversal(layout,position_ch);
+        const size_t count = std::min(traversal.elementCount(),o_frame.point_count-point_offset);
+        if (count == 0)
+            continue;
+        float* positions = &o_frame.positions[point_offset*3];
+        if (!gather_channel(traversal,position_ch,positions,count))
+            continue;
+        scale_points_and_bounds(positions,count,layout.voxelScale(),o_frame.bounds.min,o_frame.bounds.max);
+        found_positions = true;
+
+        int color_position = color_channel_name.empty() ? -1 : channel_index.find(color_channel_name);
+        if (color_position >= 0)
+        {
+            const Bifrost::API::Channel& color_ch = channel_index.channel(color_position);
+            size_t components = color_ch.dataType() == Bifrost::API::FloatType ? 1
+                : (color_ch.dataType() == Bifrost::API::FloatV3Type ? 3 : 0);
+            if (components > 0 && (o_frame.color_components == 0 || o_frame.color_components == components))
+            {
+                if (o_frame.color_components == 0)
+                {
+                    o_frame.color_components = components;
+                    o_frame.color_channel_name = color_channel_name;
+                    o_frame.colors.resize(o_frame.point_count*components,0.0f);
+                }
+                gather_channel(traversal,color_ch,&o_frame.colors[point_offset*components],count);
+            }
+        }
+
+        // Progressive order within the component, the components are merged level by level below
+        ComponentLevels component_levels;
+        component_levels.offset = point_offset;
+        component_levels.level_point_counts.assign(1,count);
+        if (count == traversal.elementCount())
+        {
+            std::vector<uint64_t> ids;
+            gather_point_ids(component,traversal,id_channel_name,ids);
+            PointLOD lod;
+            lod.build(traversal,ids.empty() ? 0 : &ids[0],lod_fractions);
+            reorder_slice(lod,o_frame.positions,point_offset,3);
+            if (o_frame.color_components)
+                reorder_slice(lod,o_frame.colors,point_offset,o_frame.color_components);
+            component_levels.level_point_counts.resize(lod.level_count());
+            for (size_t level=0;level<lod.level_count();level++)
+                component_levels.level_point_counts[level] = lod.level_point_count(level);
+        }
+        levels.push_back(component_levels);
+        point_offset += count;
+    }
+    o_frame.point_count = point_offset;
+    o_frame.positions.resize(point_offset*3);
+    if (o_frame.color_components > 0)
+        o_frame.colors.resize(point_offset*o_frame.color_components);
+    merge_levels(levels,o_frame);
+
+    // Color range of the value or of the vector magnitude
+    if (o_frame.color_components > 0)
+    {
+        float color_min = HUGE_VALF;
+        float color_max = -HUGE_VALF;
+        const float* colors = o_frame.colors.empty() ? 0 : &o_frame.colors[0];
+        for (size_t p=0;p<point_offset;p++)
+        {
+            const float* c = colors + p*o_frame.color_components;
+            float value = o_frame.color_components == 1 ? c[0] : sqrtf(c[0]*c[0]+c[1]*c[1]+c[2]*c[2]);
+            color_min = std::min(color_min,value);
+            color_max = std::max(color_max,value);
+        }
+        o_frame.color_min = point_offset > 0 ? color_min : 0.0f;
+        o_frame.color_max = point_offset > 0 ? color_max : 1.0f;
+    }
+    return found_positions;
+}
+
+size_t PointFrame::budget_point_count(size_t point_budget) const
+{
+    if (lod_point_counts.empty())
+        return point_count;
+    size_t count = lod_point_counts[0];
+    for (size_t level=1;level<lod_point_counts.size() && lod_point_counts[level]<=point_budget;level++)
+        count = lod_point_counts[level];
+    return count;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <utils/BoundsCache.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief The points of one Bifrost file, all point components concatenated,
+ *        ready to be uploaded to the GPU as is
+ */
+struct PointFrame
+{
+    PointFrame()
+    : frame_index(-1)
+    , point_count(0)
+    , color_components(0)
+    , color_min(0.0f)
+    , color_max(1.0f)
+    {}
+    int                      frame_index;      /*!< position in the sequence */
+    std::string              filename;
+    size_t                   point_count;
+    std::vector<float>       positions;        /*!< xyz, world space */
+    std::string              color_channel_name;
+    size_t                   color_components; /*!< 0 without color channel, 1 or 3 */
+    std::vector<float>       colors;           /*!< color_components floats per point */
+    float                    color_min;        /*!< range of the value (1 component) or magnitude (3 components) */
+    float                    color_max;
+    BoundsCacheBox           bounds;
+    std::vector<std::string> color_channel_names; /*!< Float and FloatV3 point channels, for cycling the color */
+    /*!
+     * \brief Number of points of each level of detail, the arrays are in
+     *        PointLOD order so a level is drawn by drawing the first
+     *        lod_point_counts[level] points
+     */
+    std::vector<size_t>      lod_point_counts;
+
+    /*! \brief Points of the finest level within the budget, at least the coarsest level */
+    size_t budget_point_count(size_t point_budget) const;
+};
+typedef std::shared_ptr<const PointFrame> PointFramePtr;
+
+/*!
+ * \brief Loads the position and optional color channel of the point
+ *        components, one memcpy per tile straight into the frame's arrays,
+ *        then sorts the points in level of detail order
+ * \param color_channel_name Full name or the part after the last '/', empty
+ *        for no color
+ * \param id_channel_name Particle ids keeping the levels stable across
+ *        frames, see PointLOD
+ * \return false if the file cannot be loaded or has no position channel
+ */
+bool load_point_frame(const std::string& filename,
+                      const std::string& position_channel_name,
+                      const std::string& color_channel_name,
+                      const std::string& id_channel_name,
+                      const std::vector<float>& lod_fractions,
+                      PointFrame& o_frame);
@@ -0,0 +1,158 @@
+#include "PointCloudRenderer.h"
+#include <boost/format.hpp>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const char* VERTEX_SHADER =
+    "#version 120\n"
+    "uniform mat4 mvp;\n"
+    "uniform int colorMode;\n"    // 0 : constant, 1 : scalar, 2 : vector magnitude
+    "uniform vec2 colorRange;\n"
+    "attribute vec3 position;\n"
+    "attribute vec3 color;\n"
+    "varying vec3 vertexColor;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = mvp * vec4(position, 1.0);\n"
+    "    if (colorMode == 0) {\n"
+    "        vertexColor = vec3(0.6, 0.8, 1.0);\n"
+    "    } else {\n"
+    "        float value = colorMode == 1 ? color.x : length(color);\n"
+    "        float t = clamp((value - colorRange.x) / max(colorRange.y - colorRange.x, 1e-6), 0.0, 1.0);\n"
+    "        vertexColor = clamp(vec3(1.5) - abs(vec3(4.0 * t) - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);\n"
+    "    }\n"
+    "}\n";
+
+const char* FRAGMENT_SHADER =
+    "#version 120\n"
+    "varying vec3 vertexColor;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = vec4(vertexColor, 1.0);\n"
+    "}\n";
+
+GLuint compile_shader(GLenum type, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, 0);
+    glCompileShader(shader);
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> log(length+1, '\0');
+        glGetShaderInfoLog(shader, length, 0, &log[0]);
+        std::cerr << boost::format("bifplay : shader compilation failed\n%1%") % &log[0] << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+} // anonymous namespace
+
+PointCloudRenderer::PointCloudRenderer()
+: _program(0)
+, _position_vbo(0)
+, _color_vbo(0)
+, _position_attribute(-1)
+, _color_attribute(-1)
+, _mvp_uniform(-1)
+, _color_mode_uniform(-1)
+, _color_range_uniform(-1)
+, _point_count(0)
+, _color_components(0)
+{
+    _color_range[0] = 0.0f;
+    _color_range[1] = 1.0f;
+}
+
+PointCloudRenderer::~PointCloudRenderer()
+{
+    if (_position_vbo)
+        glDeleteBuffers(1, &_position_vbo);
+    if (_color_vbo)
+        glDeleteBuffers(1, &_color_vbo);
+    if (_program)
+        glDeleteProgram(_program);
+}
+
+bool PointCloudRenderer::initialize()
+{
+    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, VERTEX_SHADER);
+    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+    if (!vertex_shader || !fragment_shader)
+        return false;
+    _program = glCreateProgram();
+    glAttachShader(_program, vertex_shader);
+    glAttachShader(_program, fragment_shader);
+    glLinkProgram(_program);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    GLint status = GL_FALSE;
+    glGetProgramiv(_program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        std::cerr << "bifplay : shader program link failed" << std::endl;
+        return false;
+    }
+    _position_attribute = glGetAttribLocation(_program, "position");
+    _color_attribute = glGetAttribLocation(_program, "color");
+    _mvp_uniform = glGetUniformLocation(_program, "mvp");
+    _color_mode_uniform = glGetUniformLocation(_program, "colorMode");
+    _color_range_uniform = glGetUniformLocation(_program, "colorRange");
+    glGenBuffers(1, &_position_vbo);
+    glGenBuffers(1, &_color_vbo);
+    return true;
+}
+
+void PointCloudRenderer::upload(const PointFrame& frame)
+{
+    // glBufferData with a new size orphans the previous storage, the driver
+    // does not wait for the draws still using it
+    _point_count = frame.point_count;
+    glBindBuffer(GL_ARRAY_BUFFER, _position_vbo);
+    glBufferData(GL_ARRAY_BUFFER, frame.positions.size()*sizeof(float),
+                 frame.positions.empty() ? 0 : &frame.positions[0], GL_STREAM_DRAW);
+    _color_components = frame.colors.empty() ? 0 : frame.color_components;
+    if (_color_components)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, _color_vbo);
+        glBufferData(GL_ARRAY_BUFFER, frame.colors.size()*sizeof(float), &frame.colors[0], GL_STREAM_DRAW);
+        _color_range[0] = frame.color_min;
+        _color_range[1] = frame.color_max;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void PointCloudRenderer::draw(const float model_view_projection[16], float point_size, size_t draw_count) const
+{
+    if (!_program || _point_count == 0)
+        return;
+    glUseProgram(_program);
+    glUniformMatrix4fv(_mvp_uniform, 1, GL_FALSE, model_view_projection);
+    glUniform1i(_color_mode_uniform, _color_components == 0 ? 0 : (_color_components == 1 ? 1 : 2));
+    glUniform2f(_color_range_uniform, _color_range[0], _color_range[1]);
+    glPointSize(point_size);
+
+    glBindBuffer(GL_ARRAY_BUFFER, _position_vbo);
+    glEnableVertexAttribArray(_position_attribute);
+    glVertexAttribPointer(_position_attribute, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    if (_color_components && _color_attribute >= 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, _color_vbo);
+        glEnableVertexAttribArray(_color_attribute);
+        glVertexAttribPointer(_color_attribute, GLint(_color_components), GL_FLOAT, GL_FALSE, 0, 0);
+    }
+    glDrawArrays(GL_POINTS, 0, GLsizei(std::min(draw_count, _point_count)));
+    glDisableVertexAttribArray(_position_attribute);
+    if (_color_components && _color_attribute >= 0)
+        glDisableVertexAttribArray(_color_attribute);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "PointCloudLoader.h"
+#include <GL/glew.h>
+
+/*!
+ * \brief Draws a PointFrame from one VBO per channel with a single
+ *        glDrawArrays(GL_POINTS)
+ * \note The color channel is uploaded as is and mapped to a ramp in the
+ *       vertex shader, scalars by value and vectors by magnitude over the
+ *       frame's color range
+ */
+class PointCloudRenderer
+{
+public:
+    PointCloudRenderer();
+    ~PointCloudRenderer();
+
+    /*! \brief Compiles the shaders and creates the buffers, needs a current GL context */
+    bool initialize();
+    /*! \brief Replaces the buffers' content with the frame's points */
+    void upload(const PointFrame& frame);
+    /*! \brief Draws the first draw_count points, the frame's levels of detail are prefixes */
+    void draw(const float model_view_projection[16], float point_size, size_t draw_count) const;
+
+    size_t point_count() const { return _point_count; }
+
+private:
+    GLuint _program;
+    GLuint _position_vbo;
+    GLuint _color_vbo;
+    GLint  _position_attribute;
+    GLint  _color_attribute;
+    GLint  _mvp_uniform;
+    GLint  _color_mode_uniform;
+    GLint  _color_range_uniform;
+    size_t _point_count;
+    size_t _color_components;
+    float  _color_range[2];
+};
@@ -1,9 +1,18 @@
+#include "FramePrefetcher.h"
+#include "OffscreenContext.h"
+#include "PngWriter.h"
+#include "PointCloudRenderer.h"
+#include <utils/FrameUtils.h>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <stdlib.h>
 #include <math.h>
+#include <algorithm>
 #include <iostream>
 #include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
 
 GLFWwindow* g_window;
 
@@ -18,17 +27,31 @@ int g_running = 1,
     g_mbutton[3] = {0, 0, 0},
     g_frame=0,
     g_freeze=0,
-    g_repeatCount;
+    g_repeatCount,
+    g_playing = 0,
+    g_color_index = -1;
 
 float g_rotate[2] = {0, 0},
     g_dolly = 5,
     g_pan[2] = {0, 0},
     g_center[3] = {0, 0, 0},
     g_size = 0,
-    g_moveScale = 0.0f;
+    g_moveScale = 0.0f,
+    g_fps = 24.0f,
+    g_point_size = 1.0f;
 
 float g_ratio = 1.0;
 
+double g_last_advance = 0.0,
+    g_last_interaction = 0.0;
+
+size_t g_point_budget = 2000000;  /*!< points drawn while playing or moving the camera */
+
+FramePrefetcher*         g_prefetcher = 0;
+PointCloudRenderer*      g_renderer = 0;
+PointFramePtr            g_current_frame;  /*!< the frame in the VBOs */
+std::vector<std::string> g_color_channels;
+
 struct Transform {
     float ModelViewMatrix[16];
     float ProjectionMatrix[16];
@@ -141,6 +164,9 @@ motion(GLFWwindow *, double dx, double dy)
         // printf("dolly g_dolly=%f\n",g_dolly);
     }
 
+    if (g_mbutton[0] || g_mbutton[1] || g_mbutton[2])
+        g_last_interaction = glfwGetTime();
+
     g_prev_x = x;
     g_prev_y = y;
 }
@@ -155,6 +181,7 @@ mouse(GLFWwindow *, int button, int state, int /* mods */)
     if (button < 3) {
         g_mbutton[button] = (state == GLFW_PRESS);
     }
+    g_last_interaction = glfwGetTime();
 }
 
 
@@ -170,113 +197,365 @@ reshape(GLFWwindow *, int width, int height)
     glfwGetWindowSize(g_window, &windowWidth, &windowHeight);
 }
 
+/*!
+ * \brief True while playing or moving the camera, and shortly after, the
+ *        points are then drawn within g_point_budget. The full detail is
+ *        drawn once idle, and always offscreen
+ */
+bool interacting()
+{
+    if (!g_window)
+        return false;
+    return g_playing || g_mbutton[0] || g_mbutton[1] || g_mbutton[2]
+        || glfwGetTime() - g_last_interaction < 0.5;
+}
+
+/*! \brief Number of points to draw this refresh */
+size_t draw_count()
+{
+    if (!g_current_frame)
+        return 0;
+    return interacting() ? g_current_frame->budget_point_count(g_point_budget) : g_current_frame->point_count;
+}
+
+void update_title()
+{
+    std::string color = g_color_index < 0 ? std::string("none") : g_color_channels[g_color_index];
+    std::string title = (boost::format("Bifrost Viewer - %1% [%2%/%3%] - %4% points - color : %5%%6%")
+                         % g_prefetcher->filename(g_frame) % (g_frame+1) % g_prefetcher->frame_count()
+                         % (g_current_frame ? g_current_frame->point_count : 0) % color
+                         % (g_playing ? "" : " (paused)")).str();
+    glfwSetWindowTitle(g_window, title.c_str());
+}
+
+/*! \brief Centers the camera on the current frame's bounds */
+void frame_all()
+{
+    if (!g_current_frame || g_current_frame->bounds.empty())
+        return;
+    const BoundsCacheBox& bounds = g_current_frame->bounds;
+    g_size = 0;
+    for (int axis=0;axis<3;axis++)
+    {
+        g_center[axis] = 0.5f*(bounds.min[axis]+bounds.max[axis]);
+        g_size = std::max(g_size, bounds.max[axis]-bounds.min[axis]);
+    }
+    g_size = std::max(g_size, 1e-3f);
+    g_pan[0] = g_pan[1] = 0;
+    g_dolly = g_size*1.5f;
+}
+
+/*! \brief Uploads the frame to the VBOs if it is ready, keeps the current one otherwise */
+bool show_frame(int frame_index)
+{
+    PointFramePtr point_frame = g_prefetcher->frame(frame_index);
+    if (!point_frame)
+        return false;
+    g_frame = frame_index;
+    g_prefetcher->set_playhead(g_frame);
+    if (point_frame != g_current_frame)
+    {
+        g_current_frame = point_frame;
+        g_renderer->upload(*g_current_frame);
+        if (g_color_channels.empty())
+            g_color_channels = g_current_frame->color_channel_names;
+    }
+    update_title();
+    return true;
+}
+
+void step(int offset)
+{
+    int count = int(g_prefetcher->frame_count());
+    int frame_index = ((g_frame + offset) % count + count) % count;
+    g_prefetcher->set_playhead(frame_index);
+    // Stepping by hand waits for the frame, playback does not
+    if (!g_prefetcher->wait_for_frame(frame_index))
+    {
+        std::cerr << boost::format("bifplay : unable to load frame %1%") % g_prefetcher->filename(frame_index) << std::endl;
+        return;
+    }
+    show_frame(frame_index);
+}
+
+void cycle_color()
+{
+    if (g_color_channels.empty())
+        return;
+    g_color_index = g_color_index+1 < int(g_color_channels.size()) ? g_color_index+1 : -1;
+    g_prefetcher->set_color_channel(g_color_index < 0 ? std::string() : g_color_channels[g_color_index]);
+    step(0);
+}
+
 /* static */ void
 keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-	{
-		g_running = 0;
+    if (action != GLFW_PRESS && action != GLFW_REPEAT)
+        return;
+    switch (key)
+    {
+    case GLFW_KEY_ESCAPE :
+        g_running = 0;
         glfwSetWindowShouldClose(window, GL_TRUE);
-	}
+        break;
+    case GLFW_KEY_SPACE :
+        g_playing = !g_playing;
+        g_last_advance = glfwGetTime();
+        update_title();
+        break;
+    case GLFW_KEY_RIGHT :
+        g_playing = 0;
+        step(1);
+        break;
+    case GLFW_KEY_LEFT :
+        g_playing = 0;
+        step(-1);
+        break;
+    case GLFW_KEY_HOME :
+        step(-g_frame);
+        break;
+    case GLFW_KEY_C :
+        cycle_color();
+        break;
+    case GLFW_KEY_F :
+        frame_all();
+        break;
+    case GLFW_KEY_EQUAL :
+    case GLFW_KEY_KP_ADD :
+        g_point_size = std::min(g_point_size+1.0f, 16.0f);
+        break;
+    case GLFW_KEY_MINUS :
+    case GLFW_KEY_KP_SUBTRACT :
+        g_point_size = std::max(g_point_size-1.0f, 1.0f);
+        break;
+    }
 }
 
 /* static */ void idle()
 {
+    if (!g_playing || g_prefetcher->frame_count() < 2)
+        return;
+    double now = glfwGetTime();
+    if (now - g_last_advance < 1.0/g_fps)
+        return;
+    // Hold the current frame until the prefetcher catches up
+    int next = (g_frame + 1) % int(g_prefetcher->frame_count());
+    if (show_frame(next))
+        g_last_advance = now;
+    else if (g_prefetcher->failed(next))
+    {
+        // Skip the unreadable file, the previous frame stays on screen
+        g_frame = next;
+        g_prefetcher->set_playhead(g_frame);
+        g_last_advance = now;
+    }
 }
 
 /* static */ void display()
 {
-
-
+    glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     glViewport(0, 0, g_width, g_height);
+    glEnable(GL_DEPTH_TEST);
 
     double aspect = g_width/(double)g_height;
     identity(g_transformData.ModelViewMatrix);
     translate(g_transformData.ModelViewMatrix, -g_pan[0], -g_pan[1], -g_dolly);
     rotate(g_transformData.ModelViewMatrix, g_rotate[1], 1, 0, 0);
     rotate(g_transformData.ModelViewMatrix, g_rotate[0], 0, 1, 0);
-    rotate(g_transformData.ModelViewMatrix, -90, 1, 0, 0);
     translate(g_transformData.ModelViewMatrix,
               -g_center[0], -g_center[1], -g_center[2]);
     perspective(g_transformData.ProjectionMatrix,
-                45.0f, (float)aspect, 0.01f, 500.0f);
+                45.0f, (float)aspect, g_dolly*0.001f, g_dolly + g_size*4.0f);
     multMatrix(g_transformData.ModelViewProjectionMatrix,
                g_transformData.ModelViewMatrix,
                g_transformData.ProjectionMatrix);
-    glFinish();
-
-    glPushMatrix();
-    glMultMatrixf(g_transformData.ModelViewProjectionMatrix);
-
-// #define DRAW_TRIANGLE
-#ifdef DRAW_TRIANGLE
-    glBegin(GL_TRIANGLES);
-    glColor3f(1.f, 0.f, 0.f);
-    glVertex3f(-0.6f, -0.4f, 0.f);
-    glColor3f(0.f, 1.f, 0.f);
-    glVertex3f(0.6f, -0.4f, 0.f);
-    glColor3f(0.f, 0.f, 1.f);
-    glVertex3f(-0.6f, 0.6f, 0.f);
-    glEnd();
-#else // DRAW_TRIANGLE
-    glBegin(GL_QUADS);
-    glColor3f(1.f, 0.f, 0.f);
-    glVertex3f(-0.6f, -0.4f, 0.f);
-    glColor3f(0.f, 1.f, 0.f);
-    glVertex3f(0.6f, -0.4f, 0.f);
-    glColor3f(0.f, 0.f, 1.f);
-    glVertex3f(0.6f, 0.6f, 0.f);
-    glColor3f(1.f, 1.f, 1.f);
-    glVertex3f(-0.6f, 0.6f, 0.f);
-    glEnd();
-#endif // DRAW_TRIANGLE
-
-    // g_ogl2.draw_ogl(OpenGL2Translator::DRAW_AS_WIREFRAME);
-
-    glPopMatrix();
-    glFinish();
 
+    g_renderer->draw(g_transformData.ModelViewProjectionMatrix, g_point_size, draw_count());
+}
+
+/*!
+ * \brief Renders every frame with display() into an offscreen framebuffer
+ *        and writes it as a PNG, the camera is framed on the first frame
+ * \param turntable Degrees the camera orbits around the points per frame
+ * \return the number of frames that could not be loaded or written
+ */
+size_t render_offscreen(const std::string& output_pattern,
+                        int width,
+                        int height,
+                        float turntable)
+{
+    OffscreenContext context;
+    if (!context.create(width, height))
+        return g_prefetcher->frame_count();
+    PointCloudRenderer renderer;
+    if (!renderer.initialize())
+        return g_prefetcher->frame_count();
+    g_renderer = &renderer;
+    g_width = width;
+    g_height = height;
+
+    size_t failed_count = 0;
+    std::vector<unsigned char> rgba;
+    for (size_t i=0;i<g_prefetcher->frame_count();i++)
+    {
+        const std::string& bifrost_filename = g_prefetcher->filename(int(i));
+        PointFramePtr point_frame = g_prefetcher->wait_for_frame(int(i));
+        if (!point_frame)
+        {
+            std::cerr << boost::format("bifplay : unable to load frame %1%") % bifrost_filename << std::endl;
+            failed_count++;
+            continue;
+        }
+        g_frame = int(i);
+        g_current_frame = point_frame;
+        renderer.upload(*point_frame);
+        if (i == 0)
+            frame_all();
+        g_rotate[0] = turntable*i;
+
+        context.bind();
+        display();
+        glFinish();
+        context.read_pixels(rgba);
+
+        int frame_number = int(i)+1;
+        frame_from_filename(bifrost_filename, frame_number);
+        std::string image_filename = has_frame_pattern(output_pattern) ? expand_frame_pattern(output_pattern, frame_number) : output_pattern;
+        if (!write_png(image_filename, width, height, &rgba[0]))
+        {
+            std::cerr << boost::format("bifplay : unable to write \"%1%\"") % image_filename << std::endl;
+            failed_count++;
+            continue;
+        }
+        std::cout << boost::format("%1% -> %2% (%3% points)") % bifrost_filename % image_filename % point_frame->point_count << std::endl;
+    }
+    g_current_frame.reset();
+    g_renderer = 0;
+    return failed_count;
 }
 
 int main(int argc, char **argv)
 {
-	if (argc!=2)
-	{
-		std::cerr << boost::format("Usage : %1% <bifrost-file>") % argv[0] << std::endl;
+    typedef std::vector<std::string> StringContainer;
+    std::string position_channel_name("position");
+    std::string color_channel_name;
+    std::string id_channel_name("id64");
+    std::string frame_range_string;
+    size_t prefetch_count = 8;
+    size_t thread_count = 2;
+    std::string output_pattern;
+    int output_width = 1280;
+    int output_height = 720;
+    float turntable = 0.0f;
+    bool offscreen = false;
+    StringContainer bifrost_filenames;
+    try {
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help", "produce help message")
+            ("color", po::value<std::string>(&color_channel_name),
+                "Float or FloatV3 point channel to color the points by, e.g. velocity. C cycles through the channels")
+            ("frames", po::value<std::string>(&frame_range_string),
+                "Frame range used to expand '%04d' or '####' input patterns, e.g. 1001-1240")
+            ("fps", po::value<float>(&g_fps),
+                "Playback frames per second. Defaults to 24.0")
+            ("prefetch", po::value<size_t>(&prefetch_count),
+                "Number of frames decoded ahead of the playhead. Defaults to 8")
+            ("budget", po::value<size_t>(&g_point_budget),
+                "Points drawn while playing or moving the camera, the full set is drawn when idle. Defaults to 2000000")
+            ("id", po::value<std::string>(&id_channel_name),
+                "Particle id channel keeping the level of detail subsets stable across frames. Defaults to 'id64'")
+            ("threads", po::value<size_t>(&thread_count),
+                "Number of threads decoding frames. Defaults to 2")
+            ("play", "Start playing the sequence")
+            ("offscreen", "Render every frame without a window and write the images to --out")
+            ("out", po::value<std::string>(&output_pattern),
+                "Image filename of --offscreen, '%04d' or '####' is replaced by the frame number, e.g. flipbook.%04d.png")
+            ("width", po::value<int>(&output_width),
+                "Width of the --offscreen images. Defaults to 1280")
+            ("height", po::value<int>(&output_height),
+                "Height of the --offscreen images. Defaults to 720")
+            ("turntable", po::value<float>(&turntable),
+                "Degrees the --offscreen camera orbits around the points per frame. Defaults to 0")
+            ("input-file", po::value<StringContainer>(),
+                "input files, directories, globs or frame patterns")
+            ;
+
+        po::positional_options_description p;
+        p.add("input-file", -1);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+        po::notify(vm);
+
+        if (vm.count("help") || !vm.count("input-file"))
+        {
+            std::cerr << boost::format("Usage : %1% [options] <bifrost-file|sequence>") % argv[0] << "\n" << desc << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        FrameRange frame_range;
+        if (vm.count("frames") && !parse_frame_range(frame_range_string,frame_range))
+        {
+            std::cerr << boost::format("Invalid frame range \"%1%\"") % frame_range_string << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        const StringContainer& inputs = vm["input-file"].as<StringContainer>();
+        for (size_t inputIndex=0;inputIndex<inputs.size();inputIndex++)
+        {
+            if (!expand_input_path(inputs[inputIndex],vm.count("frames") ? &frame_range : 0,bifrost_filenames))
+                std::cerr << boost::format("No Bifrost file found for \"%1%\"") % inputs[inputIndex] << std::endl;
+        }
+        if (bifrost_filenames.empty())
+            exit(EXIT_FAILURE);
+        g_playing = vm.count("play") > 0 ? 1 : 0;
+        offscreen = vm.count("offscreen") > 0;
+        if (offscreen && output_pattern.empty())
+        {
+            std::cerr << "--offscreen needs --out" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (offscreen && bifrost_filenames.size() > 1 && !has_frame_pattern(output_pattern))
+        {
+            std::cerr << "--out needs a '%04d' or '####' frame pattern to write several frames" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (output_width <= 0 || output_height <= 0)
+        {
+            std::cerr << "--width and --height must be positive" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        g_fps = std::max(g_fps, 0.1f);
+    }
+    catch(std::exception& e) {
+        std::cerr << "error: " << e.what() << "\n";
         exit(EXIT_FAILURE);
-	}
-	std::string bgeo_file(argv[1]);
+    }
+
+    // Start decoding while the window is being created
+    g_prefetcher = new FramePrefetcher(bifrost_filenames, position_channel_name, id_channel_name, color_channel_name,
+                                       prefetch_count, thread_count);
+
+    if (offscreen)
+    {
+        size_t failed_count = render_offscreen(output_pattern, output_width, output_height, turntable);
+        delete g_prefetcher;
+        exit(failed_count > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
     // glfwSetErrorCallback(error_callback);
     if (!glfwInit())
         exit(EXIT_FAILURE);
 
-// #if defined(__APPLE__) || defined (_WIN32)
-//#if defined(__APPLE__)
-//    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-//    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-//    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-//    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-//#endif // defined(__APPLE__) || defined (_WIN32)
-
     std::string windows_title = (boost::format("Bifrost Viewer")).str();
-    g_window = glfwCreateWindow(640, 480, windows_title.c_str(), NULL, NULL);
+    g_window = glfwCreateWindow(1280, 720, windows_title.c_str(), NULL, NULL);
     if (!g_window)
     {
         glfwTerminate();
         exit(EXIT_FAILURE);
     }
 
-    // Setup the geometry extractor
-//    g_ge.initialize(bgeo_file);
-//    g_ogl2.initialize(g_ge.getHeader(),
-//    		g_ge.getInfo(),
-//			g_ge.getTopology(),
-//			g_ge.getAttributes(),
-//			g_ge.getPrimitives(),
-//			g_ge.getAttributeTypeMap());
-    // g_ogl2.dump();
     glfwMakeContextCurrent(g_window);
 
     glfwGetFramebufferSize(g_window, &g_width, &g_height);
@@ -297,17 +576,37 @@ int main(int argc, char **argv)
 
     }
 
-    // g_ogl2.setup_ogl();
-    std::cout << boost::format("HouGeo Viewer : OpenGL version supported by this platform (%1%): ") % glGetString(GL_VERSION) << std::endl;
+    std::cout << boost::format("Bifrost Viewer : OpenGL version supported by this platform (%1%): ") % glGetString(GL_VERSION) << std::endl;
+
+    g_renderer = new PointCloudRenderer;
+    if (!g_renderer->initialize())
+        g_running = 0;
+
+    // The first frame is waited for, the camera is framed on it
+    if (g_running && g_prefetcher->wait_for_frame(0))
+    {
+        show_frame(0);
+        StringContainer::const_iterator color_it = std::find(g_color_channels.begin(), g_color_channels.end(), color_channel_name);
+        if (color_it != g_color_channels.end())
+            g_color_index = int(color_it - g_color_channels.begin());
+        frame_all();
+    }
+    else
+        std::cerr << boost::format("bifplay : unable to load %1%") % bifrost_filenames[0] << std::endl;
+    g_last_advance = glfwGetTime();
 
     glfwSwapInterval(0);
-    while (g_running)
+    while (g_running && !glfwWindowShouldClose(g_window))
     {
         idle();
         display();
-        glfwPollEvents();
         glfwSwapBuffers(g_window);
+        glfwPollEvents();
     }
+    // The buffers and the decoder thread go before the context
+    g_current_frame.reset();
+    delete g_renderer;
+    delete g_prefetcher;
     glfwDestroyWindow(g_window);
     glfwTerminate();
     exit(EXIT_SUCCESS);
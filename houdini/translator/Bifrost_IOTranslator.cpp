@@ -1,4 +1,6 @@
 #include "Bifrost_IOTranslator.h"
+#include <utils/BifrostUtils.h>
+#include <utils/PointKernels.h>
 #include <string.h>
 #include <boost/format.hpp>
 
@@ -77,32 +79,20 @@ bool Bifrost_IOTranslator::processChannelData(Bifrost::API::Component& component
 												 bool i_is_point_position,
 												 std::vector<T>& o_channel_data_array) const
 {
-	// if ( channel_data ) {
-		Bifrost::API::Layout layout = component.layout();
-		float voxel_scale = layout.voxelScale();
-		// if (i_is_point_position)
-		//	std::cout << boost::format("Voxel Scale = %1%") % voxel_scale << std::endl;
-		size_t depthCount = layout.depthCount();
-
-
-		for ( size_t d=0; d<depthCount; d++ ) {
-			size_t tcount = layout.tileCount(d);
-			for ( size_t t=0; t<tcount; t++ ) {
-				Bifrost::API::TreeIndex tindex(t,d);
-				if ( !channel_data.elementCount( tindex ) ) {
-					// nothing there
-					continue;
-				}
-				Bifrost::API::TileData<T> data_element = channel_data.tileData<T>( tindex );
-				for (size_t i=0; i<data_element.count(); i++ ) {
-					if (i_is_point_position)
-						o_channel_data_array.push_back(data_element[i] * voxel_scale);
-					else
-						o_channel_data_array.push_back(data_element[i]);
-				}
-			}
-		}
-	//}
+	Bifrost::API::Layout layout = component.layout();
+	float voxel_scale = layout.voxelScale();
+	TileTraversal traversal(layout,channel_data);
+
+	// Whole tile copies into the presized array
+	if (!gather_channel(traversal,channel_data,o_channel_data_array))
+		return false;
+	if (i_is_point_position)
+	{
+		// Point positions are always amino::Math::vec3f
+		traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+			scale_points(reinterpret_cast<float*>(&o_channel_data_array[tile.elementOffset]),tile.elementCount,voxel_scale);
+		});
+	}
 	return true;
 }
 
@@ -115,7 +105,6 @@ Bifrost_IOTranslator::fileLoad(GEO_Detail *gdp, UT_IStream &is, bool ate_magic)
 	Bifrost::API::ObjectModel om;
 	Bifrost::API::FileIO fileio = om.createFileIO( biffile );
 	Bifrost::API::StateServer ss = fileio.load( );
-    const Bifrost::API::BIF::FileInfo& info = fileio.info();
 
 	if ( !ss.valid() ) {
         std::cerr << boost::format("Unable to load the content of the Bifrost file \"%1%\"") % is.getFilename()
@@ -129,209 +118,180 @@ Bifrost_IOTranslator::fileLoad(GEO_Detail *gdp, UT_IStream &is, bool ate_magic)
 	    return GA_Detail::IOStatus(false);
 	}
 
-	// float bifrost_scale = 0.0;
+	// Channel lookups are resolved once for the component
+	ChannelIndex channel_index(component);
 
-	Bifrost::API::RefArray channels = component.channels();
 	// We must process the point position first as this will setup the correct
 	// point range for all subsequent attribute, otherwise attribute process
 	// before position will not be initialized into the GEO_Detail pointer
-    for (size_t channelIndex=0;channelIndex<info.channelCount;channelIndex++)
-    {
-        const Bifrost::API::BIF::FileInfo::ChannelInfo& channelInfo = fileio.channelInfo(channelIndex);
-
-        BifrostChannelNameToHoudiniAttributeNameMap::const_iterator nameMappingIter = _bcn2han_map.begin();
-        BifrostChannelNameToHoudiniAttributeNameMap::const_iterator nameMappingEIter = _bcn2han_map.end();
-        for (;nameMappingIter!=nameMappingEIter;++nameMappingIter)
-        {
-        	if (channelInfo.name.find(nameMappingIter->first.c_str()) != Bifrost::API::String::npos)
-        	{
-        		bool is_point_position = channelInfo.name.find("position") != Bifrost::API::String::npos;
-
-        		if (is_point_position)
-        		{
-        			switch (channelInfo.dataType)
-        			{
-        			case		Bifrost::API::FloatV3Type:	/*!< Defines a channel of type amino::Math::vec3f. #3 */
-						{
-							typedef amino::Math::vec3f DataType;
-							std::vector<DataType> channel_data_array;
-							Bifrost::API::Channel channel = channels[channelIndex];
-
-							bool successfully_processed = processChannelData<DataType>(component,channel,is_point_position,channel_data_array);
-							if (successfully_processed)
-							{
-								size_t numParticles = channel_data_array.size();
-								/*GA_Offset p_offset = */gdp->appendPointBlock(numParticles);
-								GA_Range p_range = gdp->getPointRange();
-
-								UT_ValArray<UT_Vector3> v3_array(numParticles);
-								for (size_t i = 0; i<numParticles;i++)
-									v3_array.array()[i].assign(channel_data_array[i].v[0],channel_data_array[i].v[1],channel_data_array[i].v[2]);
-								gdp->setPos3FromArray(p_range,v3_array);
-							}
-							else
-							{
-								// Return early, no point processing the other attribute if position is not found
-								return GA_Detail::IOStatus(false);
-							}
-						}
-        			break;
-        			default:
-        				break;
-        			}
-        		}
-        	}
-        }
-    }
-
+	{
+		typedef amino::Math::vec3f DataType;
+		std::vector<DataType> channel_data_array;
+		Bifrost::API::Channel channel;
+		bool channel_status = false;
+		get_channel(channel_index,"position",Bifrost::API::FloatV3Type,channel,channel_status);
+
+		bool successfully_processed = channel_status && processChannelData<DataType>(component,channel,true,channel_data_array);
+		if (successfully_processed)
+		{
+			size_t numParticles = channel_data_array.size();
+			/*GA_Offset p_offset = */gdp->appendPointBlock(numParticles);
+			GA_Range p_range = gdp->getPointRange();
+
+			UT_ValArray<UT_Vector3> v3_array(numParticles);
+			for (size_t i = 0; i<numParticles;i++)
+				v3_array.array()[i].assign(channel_data_array[i].v[0],channel_data_array[i].v[1],channel_data_array[i].v[2]);
+			gdp->setPos3FromArray(p_range,v3_array);
+		}
+		else
+		{
+			// Return early, no point processing the other attribute if position is not found
+			return GA_Detail::IOStatus(false);
+		}
+	}
 
     bool is_point_position = false;
-	// Now process all the remaining attribute
-    for (size_t channelIndex=0;channelIndex<info.channelCount;channelIndex++)
+	// Now process all the remaining attribute, one lookup per mapping
+    BifrostChannelNameToHoudiniAttributeNameMap::const_iterator nameMappingIter = _bcn2han_map.begin();
+    BifrostChannelNameToHoudiniAttributeNameMap::const_iterator nameMappingEIter = _bcn2han_map.end();
+    for (;nameMappingIter!=nameMappingEIter;++nameMappingIter)
     {
-        const Bifrost::API::BIF::FileInfo::ChannelInfo& channelInfo = fileio.channelInfo(channelIndex);
-
-        BifrostChannelNameToHoudiniAttributeNameMap::const_iterator nameMappingIter = _bcn2han_map.begin();
-        BifrostChannelNameToHoudiniAttributeNameMap::const_iterator nameMappingEIter = _bcn2han_map.end();
-        for (;nameMappingIter!=nameMappingEIter;++nameMappingIter)
-        {
-        	if (channelInfo.name.find(nameMappingIter->first.c_str()) != Bifrost::API::String::npos)
+        if (nameMappingIter->first == "position")
+            continue;
+        int channelIndex = channel_index.find(nameMappingIter->first);
+        if (channelIndex<0)
+            continue;
+        const Bifrost::API::Channel& indexed_channel = channel_index.channel(channelIndex);
+        if (!indexed_channel.valid())
+            continue;
+
+        	switch (indexed_channel.dataType())
         	{
-
-        		switch (channelInfo.dataType)
-        		{
-        		case		Bifrost::API::FloatType:		/*!< Defines a channel of type float. #1 */
+        	case		Bifrost::API::FloatType:		/*!< Defines a channel of type float. #1 */
+				{
+					typedef float DataType;
+					std::vector<DataType> channel_data_array;
+					Bifrost::API::Channel channel = indexed_channel;
+
+					bool successfully_processed = processChannelData<DataType>(component,channel,is_point_position,channel_data_array);
+					if (successfully_processed)
 					{
-						typedef float DataType;
-						std::vector<DataType> channel_data_array;
-						Bifrost::API::Channel channel = channels[channelIndex];
+						size_t numParticles = channel_data_array.size();
 
-						bool successfully_processed = processChannelData<DataType>(component,channel,is_point_position,channel_data_array);
-						if (successfully_processed)
+						GA_RWHandleF float_attrib(gdp->findAttribute(GA_ATTRIB_POINT,nameMappingIter->second.c_str()));
+						if (!float_attrib.isValid())
 						{
-							size_t numParticles = channel_data_array.size();
-
-							GA_RWHandleF float_attrib(gdp->findAttribute(GA_ATTRIB_POINT,nameMappingIter->second.c_str()));
-							if (!float_attrib.isValid())
-							{
-							    float_attrib.bind(gdp->addFloatTuple(GA_ATTRIB_POINT, nameMappingIter->second.c_str(), 1));
-							}
+						    float_attrib.bind(gdp->addFloatTuple(GA_ATTRIB_POINT, nameMappingIter->second.c_str(), 1));
+						}
 
-							float_attrib.getAttribute()->setTypeInfo(GA_TYPE_VOID);
+						float_attrib.getAttribute()->setTypeInfo(GA_TYPE_VOID);
 
-					        UT_ValArray<GA_RWHandleF::BASETYPE> float_array(numParticles);
-					        for (size_t i = 0; i<numParticles;i++)
-						        float_array.array()[i] = channel_data_array[i];
-					    	gdp->setAttributeFromArray(float_attrib.getAttribute(),gdp->getPointRange(),float_array);
+				        UT_ValArray<GA_RWHandleF::BASETYPE> float_array(numParticles);
+				        for (size_t i = 0; i<numParticles;i++)
+					        float_array.array()[i] = channel_data_array[i];
+				    	gdp->setAttributeFromArray(float_attrib.getAttribute(),gdp->getPointRange(),float_array);
 
 
-						}
 					}
-        			break;
-        		case		Bifrost::API::FloatV2Type:	/*!< Defines a channel of type amino::Math::vec2f. #2 */
+				}
+        		break;
+        	case		Bifrost::API::FloatV2Type:	/*!< Defines a channel of type amino::Math::vec2f. #2 */
+				{
+					typedef amino::Math::vec2f DataType;
+					std::vector<DataType> channel_data_array;
+					Bifrost::API::Channel channel = indexed_channel;
+
+					bool successfully_processed = processChannelData<DataType>(component,channel,is_point_position,channel_data_array);
+					if (successfully_processed)
 					{
-						typedef amino::Math::vec2f DataType;
-						std::vector<DataType> channel_data_array;
-						Bifrost::API::Channel channel = channels[channelIndex];
+						size_t numParticles = channel_data_array.size();
 
-						bool successfully_processed = processChannelData<DataType>(component,channel,is_point_position,channel_data_array);
-						if (successfully_processed)
+						GA_RWHandleV2 v2_attrib(gdp->findAttribute(GA_ATTRIB_POINT,nameMappingIter->second.c_str()));
+						if (!v2_attrib.isValid())
 						{
-							size_t numParticles = channel_data_array.size();
-
-							GA_RWHandleV2 v2_attrib(gdp->findAttribute(GA_ATTRIB_POINT,nameMappingIter->second.c_str()));
-							if (!v2_attrib.isValid())
-							{
-								v2_attrib.bind(gdp->addFloatTuple(GA_ATTRIB_POINT, nameMappingIter->second.c_str(), 2));
-							}
+							v2_attrib.bind(gdp->addFloatTuple(GA_ATTRIB_POINT, nameMappingIter->second.c_str(), 2));
+						}
 
-							v2_attrib.getAttribute()->setTypeInfo(GA_TYPE_VOID);
+						v2_attrib.getAttribute()->setTypeInfo(GA_TYPE_VOID);
 
-							UT_ValArray<UT_Vector2> v2_array(numParticles);
-							for (size_t i = 0; i<numParticles;i++)
-								v2_array.array()[i].assign(channel_data_array[i].v[0],channel_data_array[i].v[1]);
-							gdp->setAttributeFromArray(v2_attrib.getAttribute(),gdp->getPointRange(),v2_array);
-						}
+						UT_ValArray<UT_Vector2> v2_array(numParticles);
+						for (size_t i = 0; i<numParticles;i++)
+							v2_array.array()[i].assign(channel_data_array[i].v[0],channel_data_array[i].v[1]);
+						gdp->setAttributeFromArray(v2_attrib.getAttribute(),gdp->getPointRange(),v2_array);
 					}
-        			break;
-        		case		Bifrost::API::FloatV3Type:	/*!< Defines a channel of type amino::Math::vec3f. #3 */
+				}
+        		break;
+        	case		Bifrost::API::FloatV3Type:	/*!< Defines a channel of type amino::Math::vec3f. #3 */
+				{
+					typedef amino::Math::vec3f DataType;
+					std::vector<DataType> channel_data_array;
+					Bifrost::API::Channel channel = indexed_channel;
+					bool successfully_processed = processChannelData<DataType>(component,channel,is_point_position,channel_data_array);
+					if (successfully_processed)
 					{
-						typedef amino::Math::vec3f DataType;
-						std::vector<DataType> channel_data_array;
-						Bifrost::API::Channel channel = channels[channelIndex];
-						// std::cout << "CHANNEL NAME " << channel.name().c_str() << std::endl;
-						// std::cout << "CHANNEL IS POSITION " << (channel.name().compare("position") == 0 ? "true" : "false") << std::endl;
-						bool successfully_processed = processChannelData<DataType>(component,channel,
-							channel.name().compare("position") == 0, // is_point_position,
-							channel_data_array);
-						if (successfully_processed)
+						size_t numParticles = channel_data_array.size();
 						{
-							size_t numParticles = channel_data_array.size();
-							if (!is_point_position)
+							GA_RWHandleV3 v3_attrib(gdp->findAttribute(GA_ATTRIB_POINT,nameMappingIter->second.c_str()));
+							if (!v3_attrib.isValid())
 							{
-								GA_RWHandleV3 v3_attrib(gdp->findAttribute(GA_ATTRIB_POINT,nameMappingIter->second.c_str()));
-								if (!v3_attrib.isValid())
-								{
-								    v3_attrib.bind(gdp->addFloatTuple(GA_ATTRIB_POINT, nameMappingIter->second.c_str(), 3));
-								}
+							    v3_attrib.bind(gdp->addFloatTuple(GA_ATTRIB_POINT, nameMappingIter->second.c_str(), 3));
+							}
 
-								v3_attrib.getAttribute()->setTypeInfo(GA_TYPE_VECTOR);
+							v3_attrib.getAttribute()->setTypeInfo(GA_TYPE_VECTOR);
 
-						        UT_ValArray<UT_Vector3> v3_array(numParticles);
-						        for (size_t i = 0; i<numParticles;i++)
-							        v3_array.array()[i].assign(channel_data_array[i].v[0],channel_data_array[i].v[1],channel_data_array[i].v[2]);
-						    	gdp->setAttributeFromArray(v3_attrib.getAttribute(),gdp->getPointRange(),v3_array);
+					        UT_ValArray<UT_Vector3> v3_array(numParticles);
+					        for (size_t i = 0; i<numParticles;i++)
+						        v3_array.array()[i].assign(channel_data_array[i].v[0],channel_data_array[i].v[1],channel_data_array[i].v[2]);
+					    	gdp->setAttributeFromArray(v3_attrib.getAttribute(),gdp->getPointRange(),v3_array);
 
-							}
 						}
 					}
-        			break;
-        		case		Bifrost::API::Int32Type:		/*!< Defines a channel of type int32_t. #4 */
-        			break;
-        		case		Bifrost::API::Int64Type:		/*!< Defines a channel of type int64_t. #5 */
-        			break;
-        		case		Bifrost::API::UInt32Type:		/*!< Defines a channel of type uint32_t. #6 */
-        			break;
-        		case		Bifrost::API::UInt64Type:		/*!< Defines a channel of type uint64_t. #7 */
+				}
+        		break;
+        	case		Bifrost::API::Int32Type:		/*!< Defines a channel of type int32_t. #4 */
+        		break;
+        	case		Bifrost::API::Int64Type:		/*!< Defines a channel of type int64_t. #5 */
+        		break;
+        	case		Bifrost::API::UInt32Type:		/*!< Defines a channel of type uint32_t. #6 */
+        		break;
+        	case		Bifrost::API::UInt64Type:		/*!< Defines a channel of type uint64_t. #7 */
+				{
+					/*!
+					 * \remark Houdini does not have (at this moment) have an 64bit unsigned integer,
+					 *         we have to use a 64bit signed integer instead
+					 */
+					typedef uint64_t DataType;
+					std::vector<DataType> channel_data_array;
+					Bifrost::API::Channel channel = indexed_channel;
+
+					bool successfully_processed = processChannelData<DataType>(component,channel,is_point_position,channel_data_array);
+					if (successfully_processed)
 					{
-						/*!
-						 * \remark Houdini does not have (at this moment) have an 64bit unsigned integer,
-						 *         we have to use a 64bit signed integer instead
-						 */
-						typedef uint64_t DataType;
-						std::vector<DataType> channel_data_array;
-						Bifrost::API::Channel channel = channels[channelIndex];
-
-						bool successfully_processed = processChannelData<DataType>(component,channel,is_point_position,channel_data_array);
-						if (successfully_processed)
-						{
-							size_t numParticles = channel_data_array.size();
+						size_t numParticles = channel_data_array.size();
 
-							GA_RWHandleID uint64_attrib(gdp->findAttribute(GA_ATTRIB_POINT,nameMappingIter->second.c_str()));
-							if (!uint64_attrib.isValid())
-							{
-								uint64_attrib.bind(gdp->addTuple(GA_STORE_INT64, GA_ATTRIB_POINT, nameMappingIter->second.c_str(), 1));
-							}
+						GA_RWHandleID uint64_attrib(gdp->findAttribute(GA_ATTRIB_POINT,nameMappingIter->second.c_str()));
+						if (!uint64_attrib.isValid())
+						{
+							uint64_attrib.bind(gdp->addTuple(GA_STORE_INT64, GA_ATTRIB_POINT, nameMappingIter->second.c_str(), 1));
+						}
 
-							uint64_attrib.getAttribute()->setTypeInfo(GA_TYPE_NONARITHMETIC_INTEGER);
+						uint64_attrib.getAttribute()->setTypeInfo(GA_TYPE_NONARITHMETIC_INTEGER);
 
-							UT_ValArray<GA_RWHandleID::BASETYPE> int64_array(numParticles);
-							for (size_t i = 0; i<numParticles;i++)
-								int64_array.array()[i] = channel_data_array[i];
-							gdp->setAttributeFromArray(uint64_attrib.getAttribute(),gdp->getPointRange(),int64_array);
+						UT_ValArray<GA_RWHandleID::BASETYPE> int64_array(numParticles);
+						for (size_t i = 0; i<numParticles;i++)
+							int64_array.array()[i] = channel_data_array[i];
+						gdp->setAttributeFromArray(uint64_attrib.getAttribute(),gdp->getPointRange(),int64_array);
 
-						}
 					}
-        			break;
-        		case		Bifrost::API::Int32V2Type:	/*!< Defines a channel of type amino::Math::vec2i. #8 */
-        			break;
-        		case		Bifrost::API::Int32V3Type:		/*!< Defines a channel of type amino::Math::vec3i. #9 */
-        			break;
-				default:
-					break;
-        		}
+				}
+        		break;
+        	case		Bifrost::API::Int32V2Type:	/*!< Defines a channel of type amino::Math::vec2i. #8 */
+        		break;
+        	case		Bifrost::API::Int32V3Type:		/*!< Defines a channel of type amino::Math::vec3i. #9 */
+        		break;
+			default:
+				break;
         	}
-        }
     }
 
     // All done successfully
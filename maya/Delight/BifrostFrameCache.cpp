@@ -0,0 +1,57 @@
+#include "BifrostFrameCache.h"
+
+BifrostFrameCache::BifrostFrameCache()
+: _memoryBudget(0)
+, _memoryUsage(0)
+{
+}
+
+BifrostParticleLoader::ParticleDataPtr BifrostFrameCache::find(const std::string& filename)
+{
+	FrameMap::iterator found = _index.find(filename);
+	if (found == _index.end())
+		return BifrostParticleLoader::ParticleDataPtr();
+	_frames.splice(_frames.begin(),_frames,found->second);
+	return *found->second;
+}
+
+void BifrostFrameCache::insert(const BifrostParticleLoader::ParticleDataPtr& frame)
+{
+	if (!frame)
+		return;
+	FrameMap::iterator found = _index.find(frame->filename);
+	if (found != _index.end())
+	{
+		_memoryUsage -= (*found->second)->memorySize();
+		_frames.erase(found->second);
+		_index.erase(found);
+	}
+	_frames.push_front(frame);
+	_index[frame->filename] = _frames.begin();
+	_memoryUsage += frame->memorySize();
+	evict();
+}
+
+void BifrostFrameCache::setMemoryBudget(size_t bytes)
+{
+	_memoryBudget = bytes;
+	evict();
+}
+
+void BifrostFrameCache::clear()
+{
+	_frames.clear();
+	_index.clear();
+	_memoryUsage = 0;
+}
+
+void BifrostFrameCache::evict()
+{
+	while (_memoryUsage > _memoryBudget && !_frames.empty())
+	{
+		const BifrostParticleLoader::ParticleDataPtr& oldest = _frames.back();
+		_memoryUsage -= oldest->memorySize();
+		_index.erase(oldest->filename);
+		_frames.pop_back();
+	}
+}
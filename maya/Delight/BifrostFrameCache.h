@@ -0,0 +1,40 @@
+#pragma once
+
+#include "BifrostParticleLoader.h"
+#include <list>
+#include <string>
+#include <unordered_map>
+
+/*!
+ * \brief Least recently used cache of loaded particle frames, keyed by the
+ *        Bifrost filename and bounded by a memory budget
+ * \note Frames are shared, a frame evicted while still displayed stays alive
+ *       until the shape lets go of it. Only used from the main thread
+ */
+class BifrostFrameCache
+{
+public:
+	BifrostFrameCache();
+
+	/*! \brief The cached frame, made the most recently used, null if not cached */
+	BifrostParticleLoader::ParticleDataPtr find(const std::string& filename);
+	/*! \brief Adds or replaces a frame then evicts down to the memory budget */
+	void insert(const BifrostParticleLoader::ParticleDataPtr& frame);
+	/*! \brief A budget of 0 disables the cache */
+	void setMemoryBudget(size_t bytes);
+	size_t memoryBudget() const { return _memoryBudget; }
+	size_t memoryUsage() const { return _memoryUsage; }
+	size_t frameCount() const { return _frames.size(); }
+	void clear();
+
+private:
+	typedef std::list<BifrostParticleLoader::ParticleDataPtr> FrameList; /*!< most recently used first */
+	typedef std::unordered_map<std::string,FrameList::iterator> FrameMap;
+
+	void evict();
+
+	FrameList _frames;
+	FrameMap  _index;
+	size_t    _memoryBudget;
+	size_t    _memoryUsage;
+};
@@ -0,0 +1,92 @@
+#include "BifrostGLBuffer.h"
+#include <maya/MHardwareRenderer.h>
+#include <maya/MGLFunctionTable.h>
+
+namespace {
+
+MGLFunctionTable* gl_function_table()
+{
+	MHardwareRenderer* renderer = MHardwareRenderer::theRenderer();
+	return renderer ? renderer->glFunctionTable() : 0;
+}
+
+} // anonymous namespace
+
+BifrostGLBuffer::BifrostGLBuffer(MGLenum target)
+: _target(target)
+, _buffer(0)
+, _size(0)
+{
+}
+
+BifrostGLBuffer::~BifrostGLBuffer()
+{
+	release();
+}
+
+BifrostGLBuffer::BifrostGLBuffer(BifrostGLBuffer&& other)
+: _target(other._target)
+, _buffer(other._buffer)
+, _size(other._size)
+{
+	other._buffer = 0;
+	other._size = 0;
+}
+
+BifrostGLBuffer& BifrostGLBuffer::operator=(BifrostGLBuffer&& other)
+{
+	if (this != &other)
+	{
+		release();
+		_target = other._target;
+		_buffer = other._buffer;
+		_size = other._size;
+		other._buffer = 0;
+		other._size = 0;
+	}
+	return *this;
+}
+
+bool BifrostGLBuffer::supported()
+{
+	MGLFunctionTable* gl = gl_function_table();
+	return gl && gl->extensionExists(kMGLext_ARB_vertex_buffer_object);
+}
+
+bool BifrostGLBuffer::upload(const void* data, size_t size, MGLenum usage)
+{
+	if (!supported())
+		return false;
+	MGLFunctionTable* gl = gl_function_table();
+	if (_buffer == 0)
+		gl->glGenBuffersARB(1,&_buffer);
+	gl->glBindBufferARB(_target,_buffer);
+	if (size == _size && size > 0)
+		gl->glBufferSubDataARB(_target,0,MGLsizeiptrARB(size),data);
+	else
+		gl->glBufferDataARB(_target,MGLsizeiptrARB(size),data,usage);
+	gl->glBindBufferARB(_target,0);
+	_size = size;
+	return true;
+}
+
+void BifrostGLBuffer::release()
+{
+	if (_buffer == 0)
+		return;
+	MGLFunctionTable* gl = gl_function_table();
+	if (gl)
+		gl->glDeleteBuffersARB(1,&_buffer);
+	_buffer = 0;
+	_size = 0;
+}
+
+void BifrostGLBuffer::bind() const
+{
+	gl_function_table()->glBindBufferARB(_target,_buffer);
+}
+
+void BifrostGLBuffer::unbind() const
+{
+	gl_function_table()->glBindBufferARB(_target,0);
+}
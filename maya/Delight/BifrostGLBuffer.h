@@ -0,0 +1,48 @@
+#pragma once
+
+#include <maya/MGLdefinitions.h>
+#include <stddef.h>
+
+class MGLFunctionTable;
+
+/*!
+ * \brief A GL buffer object holding vertex or index data across redraws
+ * \note GL entry points come from Maya's MGLFunctionTable so the plug-in
+ *       needs no extension loader. When the driver has no vertex buffer
+ *       objects, valid() stays false and callers keep drawing from client
+ *       memory. The buffer is deleted with the object, Maya's viewports
+ *       share their GL objects so any current context will do
+ */
+class BifrostGLBuffer
+{
+public:
+	/*! \param target MGL_ARRAY_BUFFER_ARB or MGL_ELEMENT_ARRAY_BUFFER_ARB */
+	explicit BifrostGLBuffer(MGLenum target = MGL_ARRAY_BUFFER_ARB);
+	~BifrostGLBuffer();
+	BifrostGLBuffer(BifrostGLBuffer&& other);
+	BifrostGLBuffer& operator=(BifrostGLBuffer&& other);
+
+	/*! \brief True if buffer objects are usable in the current context */
+	static bool supported();
+
+	/*!
+	 * \brief Replaces the content with size bytes, reusing the storage when
+	 *        the size is unchanged
+	 * \return false if buffer objects are not supported
+	 */
+	bool upload(const void* data, size_t size, MGLenum usage = MGL_STATIC_DRAW_ARB);
+	void release();
+	bool valid() const { return _buffer != 0; }
+	size_t size() const { return _size; }
+
+	void bind() const;
+	void unbind() const;
+
+private:
+	BifrostGLBuffer(const BifrostGLBuffer&);
+	BifrostGLBuffer& operator=(const BifrostGLBuffer&);
+
+	MGLenum _target;
+	MGLuint _buffer;
+	size_t  _size;
+};
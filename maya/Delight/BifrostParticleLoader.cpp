@@ -0,0 +1,185 @@
+#include "BifrostParticleLoader.h"
+#include <BifrostHeaders.h>
+#include <maya/MGlobal.h>
+#include <boost/format.hpp>
+#include <iostream>
+
+#include <utils/BifrostUtils.h>
+#include <utils/PointKernels.h>
+#include <utils/PointLOD.h>
+
+BifrostParticleLoader::BifrostParticleLoader()
+: _generation(0)
+, _hasPending(false)
+, _loading(false)
+, _stop(false)
+{
+}
+
+BifrostParticleLoader::~BifrostParticleLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+		_generation++;
+	}
+	_wake.notify_all();
+	if (_thread.joinable())
+		_thread.join();
+}
+
+void BifrostParticleLoader::request(const std::string& filename)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pending = filename;
+		_hasPending = true;
+		_result.reset();
+		_generation++;
+		// Started on the first request, shapes without a file get no thread
+		if (!_thread.joinable())
+			_thread = std::thread(&BifrostParticleLoader::run,this);
+	}
+	_wake.notify_all();
+}
+
+void BifrostParticleLoader::cancel()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_hasPending = false;
+	_result.reset();
+	_generation++;
+}
+
+BifrostParticleLoader::ParticleDataPtr BifrostParticleLoader::take()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	ParticleDataPtr result;
+	result.swap(_result);
+	return result;
+}
+
+bool BifrostParticleLoader::busy() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _hasPending || _loading;
+}
+
+void BifrostParticleLoader::run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_stop)
+	{
+		if (!_hasPending)
+		{
+			_wake.wait(lock);
+			continue;
+		}
+		std::string filename(_pending);
+		unsigned int generation = _generation;
+		_hasPending = false;
+		_loading = true;
+		lock.unlock();
+
+		ParticleDataPtr data(new ParticleData);
+		data->filename = filename;
+		data->valid = load(filename,_generation,generation,*data);
+
+		lock.lock();
+		_loading = false;
+		if (generation != _generation)
+			continue;
+		_result = data;
+		lock.unlock();
+		// Draw the new particles, draw() takes the result
+		MGlobal::executeCommandOnIdle("refresh");
+		lock.lock();
+	}
+}
+
+bool BifrostParticleLoader::load(const std::string& filename,
+								 const std::atomic<unsigned int>& io_generation,
+								 unsigned int generation,
+								 ParticleData& o_data)
+{
+	o_data.positions.clear();
+	o_data.velocities.clear();
+	o_data.lodCounts.clear();
+	o_data.bounds.clear();
+
+	Bifrost::API::ObjectModel om;
+	Bifrost::API::FileIO fileio = om.createFileIO( filename.c_str() );
+	Bifrost::API::StateServer ss = fileio.load( );
+	if ( !ss.valid() ) {
+		std::cerr << boost::format("Unable to load the content of the Bifrost file \"%1%\"") % filename
+				  << std::endl;
+		return false;
+	}
+	if (io_generation != generation)
+		return false;
+
+	Bifrost::API::Component component = ss.components()[0];
+	if ( component.type() != Bifrost::API::PointComponentType ) {
+		std::cerr << "Wrong component (" << component.type() << ")" << std::endl;
+		return false;
+	}
+
+	Bifrost::API::Channel channel;
+	bool position_status = false;
+	get_channel(component,"position",Bifrost::API::FloatV3Type,channel,position_status);
+	if (!position_status)
+		return false;
+
+	Bifrost::API::Layout layout = component.layout();
+	const float voxel_scale = layout.voxelScale();
+	TileTraversal traversal(layout,channel);
+
+	// Gather straight into the GL position array, no intermediate copy
+	size_t numParticles = traversal.elementCount();
+	o_data.positions.resize(numParticles*3);
+	if (numParticles > 0 && !gather_channel(traversal,channel,&o_data.positions[0],numParticles))
+		return false;
+	if (io_generation != generation)
+		return false;
+
+	std::vector<BoundsCacheBox> tile_bounds(traversal.tileCount());
+	traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+		BoundsCacheBox& bounds = tile_bounds[tile.ordinal];
+		scale_points_and_bounds(&o_data.positions[tile.elementOffset*3],tile.elementCount,voxel_scale,bounds.min,bounds.max);
+	});
+	for (size_t i = 0; i<tile_bounds.size();i++)
+		o_data.bounds.extend(tile_bounds[i]);
+
+	// Velocities are in voxel units like the positions, scaled the same way
+	// so the shape can advect the world space positions directly
+	ChannelIndex channel_index(component);
+	int velocityChannelIndex = channel_index.find("velocity");
+	if (velocityChannelIndex>=0 && channel_index.channel(velocityChannelIndex).dataType() == Bifrost::API::FloatV3Type)
+	{
+		const Bifrost::API::Channel& velocity_ch = channel_index.channel(velocityChannelIndex);
+		// Same tiles as the positions, gather_channel() checks the per tile counts
+		o_data.velocities.resize(numParticles*3);
+		if (numParticles > 0 && !gather_channel(traversal,velocity_ch,&o_data.velocities[0],numParticles))
+			o_data.velocities.clear();
+		else
+			traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+				scale_points(&o_data.velocities[tile.elementOffset*3],tile.elementCount,voxel_scale);
+			});
+	}
+	if (io_generation != generation)
+		return false;
+
+	// Stable id-hash subsets, drawn during playback instead of every particle
+	std::vector<uint64_t> ids;
+	gather_point_ids(component,traversal,"id64",ids);
+	if (io_generation != generation)
+		return false;
+	PointLOD lod;
+	lod.build(traversal,ids.empty() ? 0 : &ids[0],PointLOD::default_fractions());
+	lod.reorder(o_data.positions,3);
+	if (!o_data.velocities.empty())
+		lod.reorder(o_data.velocities,3);
+	for (size_t level=0;level<lod.level_count();level++)
+		o_data.lodCounts.push_back(lod.level_point_count(level));
+	return true;
+}
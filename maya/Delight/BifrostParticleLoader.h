@@ -0,0 +1,80 @@
+#pragma once
+
+#include <utils/BoundsCache.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*!
+ * \brief Loads the particles of a Bifrost file on a worker thread so the
+ *        Maya UI is not blocked on every frame change
+ * \note Only the latest request matters : a request replaces the pending
+ *       one and cancels the running one. A Bifrost file is loaded as a
+ *       whole, so a running load is abandoned between its stages (load,
+ *       gather, level of detail) rather than interrupted. When a load
+ *       completes a viewport refresh is queued with
+ *       MGlobal::executeCommandOnIdle, the shape picks the result up in draw()
+ */
+class BifrostParticleLoader
+{
+public:
+	struct ParticleData
+	{
+		ParticleData()
+		: valid(false)
+		{}
+		std::string         filename;
+		bool                valid;     /*!< false if the file has no particles or failed to load */
+		std::vector<float>  positions; /*!< world space, in PointLOD order */
+		std::vector<float>  velocities; /*!< world space units per second, same order, empty without a velocity channel */
+		std::vector<size_t> lodCounts; /*!< PointLOD level sizes */
+		BoundsCacheBox      bounds;    /*!< world space */
+
+		size_t memorySize() const
+		{
+			return (positions.size() + velocities.size())*sizeof(float) + lodCounts.size()*sizeof(size_t);
+		}
+	};
+	typedef std::shared_ptr<ParticleData> ParticleDataPtr;
+
+	BifrostParticleLoader();
+	~BifrostParticleLoader();
+
+	/*! \brief Loads the file next, dropping any earlier request */
+	void request(const std::string& filename);
+	/*! \brief Drops the pending request and abandons the running load */
+	void cancel();
+	/*! \brief The completed load of the latest request, once, null otherwise */
+	ParticleDataPtr take();
+	/*! \brief True while the latest request is pending or loading */
+	bool busy() const;
+
+	/*!
+	 * \brief Loads the positions, and velocities when present, of the first
+	 *        point component
+	 * \param generation Value of io_generation when the load was requested,
+	 *        the load stops as soon as io_generation changes
+	 * \return false if the load failed or was cancelled
+	 */
+	static bool load(const std::string& filename,
+					 const std::atomic<unsigned int>& io_generation,
+					 unsigned int generation,
+					 ParticleData& o_data);
+
+private:
+	void run();
+
+	std::atomic<unsigned int> _generation;
+	std::string               _pending;
+	bool                      _hasPending;
+	bool                      _loading;
+	bool                      _stop;
+	ParticleDataPtr           _result;
+	mutable std::mutex        _mutex;
+	std::condition_variable   _wake;
+	std::thread               _thread;
+};
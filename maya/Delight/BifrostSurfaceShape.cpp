@@ -10,11 +10,19 @@
 #include <maya/MFnPointArrayData.h>
 #include <maya/MBoundingBox.h>
 #include <maya/MTime.h>
+#include <maya/MAnimControl.h>
 
 #include <stdio.h>
+#include <cmath>
+#include <algorithm>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
 #include <boost/format.hpp>
 
 #include "MayaUtils.h"
+#include <utils/BifrostUtils.h>
+#include <utils/PointKernels.h>
+#include <utils/BoundsCache.h>
 
 MTypeId BifrostSurfaceShape::typeId(0x0011BDC0);
 MObject BifrostSurfaceShape::_inBifrostFileAttr;
@@ -22,6 +30,8 @@ MObject BifrostSurfaceShape::_inTimeAttr;
 // MObject BifrostSurfaceShape::_inParticleWidthAttr;
 MObject BifrostSurfaceShape::_inVelocityMotionBlurAttr;
 MObject BifrostSurfaceShape::_inGeometryChunkAttr;
+MObject BifrostSurfaceShape::_inPointBudgetAttr;
+MObject BifrostSurfaceShape::_inFrameCacheSizeAttr;
 MObject BifrostSurfaceShape::_outChannelNamesAttr;
 MObject BifrostSurfaceShape::_outBoundingBoxAttr;
 
@@ -29,6 +39,10 @@ BifrostSurfaceShape::BifrostSurfaceShape()
 : _particleBBox(MBoundingBox(MPoint(-1,-1,-1),MPoint(1,1,1)))
 , _hasParticleColor(false)
 , _hasParticleData(false)
+, _hasCachedBounds(false)
+, _advectedSeconds(0.0)
+, _particleBuffersDirty(false)
+, _particleVersion(0)
 , _BifrostFilePathChanged(false)
 {
 }
@@ -48,6 +62,7 @@ void BifrostSurfaceShape::draw (M3dView& view,
 		M3dView::DisplayStyle style,
 		M3dView::DisplayStatus status)
 {
+	updateParticles();
 	switch (style)
 	{
 	case M3dView::kBoundingBox:
@@ -69,7 +84,7 @@ void BifrostSurfaceShape::draw (M3dView& view,
 			drawBBox(fIter->_fieldBBox);
 		}
 
-		if (_hasParticleData)
+		if (_hasParticleData || _hasCachedBounds)
 			drawBBox(_particleBBox);
 
 		glPopAttrib();
@@ -84,39 +99,41 @@ void BifrostSurfaceShape::draw (M3dView& view,
 		{
 			view.beginGL();
 			glPushAttrib(GL_CURRENT_BIT);
+			uploadParticleBuffers();
 			glEnableClientState(GL_VERTEX_ARRAY);
 			if (_hasParticleColor)
 				glEnableClientState(GL_COLOR_ARRAY);
-			glVertexPointer(3,GL_FLOAT,0,&_particlePositions[0]);
+			glVertexPointer(3,GL_FLOAT,0,bindArray(_particleBuffer,particlePositions()));
 			if (_hasParticleColor)
-				glColorPointer(3,GL_FLOAT,0,&_particleColors[0]);
-			glDrawElements(GL_POINTS,_particlePositions.size()/3,GL_UNSIGNED_INT,&_particleGLIndices[0]);
+				glColorPointer(3,GL_FLOAT,0,bindArray(_particleColorBuffer,&_particleColors[0]));
+			unbindArray(_particleBuffer);
+			// The particles are in level of detail order, a level is a prefix of the arrays
+			glDrawArrays(GL_POINTS,0,GLsizei(particleDrawCount()));
 			if (_hasParticleColor)
 				glDisableClientState(GL_COLOR_ARRAY);
 			glDisableClientState(GL_VERTEX_ARRAY);
 			glPopAttrib();
 			view.endGL();
 		}
+		else if (_hasCachedBounds)
+		{
+			// First load still running, the sidecar bounds stand in for the points
+			view.beginGL();
+			glPushAttrib(GL_CURRENT_BIT);
+			drawBBox(_particleBBox);
+			glPopAttrib();
+			view.endGL();
+		}
 		else if (_bm.size() != 0)
 		{
 			// Draw the mesh vertices as points
 			view.beginGL();
-			BodyMeshDataCollection::const_iterator mEiter = _bm.end();
-			BodyMeshDataCollection::const_iterator mIter  = _bm.begin();
+			BodyMeshDataCollection::iterator mEiter = _bm.end();
+			BodyMeshDataCollection::iterator mIter  = _bm.begin();
 			for (;mIter!=mEiter;++mIter)
 			{
 				glPushAttrib(GL_CURRENT_BIT);
-				glEnableClientState(GL_VERTEX_ARRAY);
-				if (mIter->_hasMeshVertexColor)
-					glEnableClientState(GL_COLOR_ARRAY);
-				glVertexPointer(3,GL_FLOAT,0,&(mIter->_meshPositions[0]));
-				if (mIter->_hasMeshVertexColor)
-					glColorPointer(3,GL_FLOAT,0,&(mIter->_meshColors[0]));
-				glDrawElements(GL_POINTS,mIter->_meshPositions.size()/3,GL_UNSIGNED_INT,
-						&(mIter->_meshVertexGLIndices[0]));
-				if (mIter->_hasMeshVertexColor)
-					glDisableClientState(GL_COLOR_ARRAY);
-				glDisableClientState(GL_VERTEX_ARRAY);
+				drawMesh(*mIter,GL_POINTS);
 				glPopAttrib();
 			}
 
@@ -130,23 +147,13 @@ void BifrostSurfaceShape::draw (M3dView& view,
 		{
 			view.beginGL();
 
-			BodyMeshDataCollection::const_iterator mEiter = _bm.end();
-			BodyMeshDataCollection::const_iterator mIter  = _bm.begin();
+			BodyMeshDataCollection::iterator mEiter = _bm.end();
+			BodyMeshDataCollection::iterator mIter  = _bm.begin();
 			for (;mIter!=mEiter;++mIter)
 			{
 				glPushAttrib(GL_CURRENT_BIT);
 				glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
-				glEnableClientState(GL_VERTEX_ARRAY);
-				if (mIter->_hasMeshVertexColor)
-					glEnableClientState(GL_COLOR_ARRAY);
-				glVertexPointer(3,GL_FLOAT,0,&(mIter->_meshPositions[0]));
-				if (mIter->_hasMeshVertexColor)
-					glColorPointer(3,GL_FLOAT,0,&(mIter->_meshColors[0]));
-				glDrawElements(GL_TRIANGLES,mIter->_meshGLIndices.size(),GL_UNSIGNED_INT,
-						&(mIter->_meshGLIndices[0]));
-				if (mIter->_hasMeshVertexColor)
-					glDisableClientState(GL_COLOR_ARRAY);
-				glDisableClientState(GL_VERTEX_ARRAY);
+				drawMesh(*mIter,GL_TRIANGLES);
 				glPopAttrib();
 			}
 			view.endGL();
@@ -158,23 +165,13 @@ void BifrostSurfaceShape::draw (M3dView& view,
 		if (_bm.size() != 0)
 		{
 			view.beginGL();
-			BodyMeshDataCollection::const_iterator mEiter = _bm.end();
-			BodyMeshDataCollection::const_iterator mIter  = _bm.begin();
+			BodyMeshDataCollection::iterator mEiter = _bm.end();
+			BodyMeshDataCollection::iterator mIter  = _bm.begin();
 			for (;mIter!=mEiter;++mIter)
 			{
 				glPushAttrib(GL_CURRENT_BIT);
 				glPolygonMode( GL_FRONT, GL_FILL );
-				glEnableClientState(GL_VERTEX_ARRAY);
-				if (mIter->_hasMeshVertexColor)
-					glEnableClientState(GL_COLOR_ARRAY);
-				glVertexPointer(3,GL_FLOAT,0,&(mIter->_meshPositions[0]));
-				if (mIter->_hasMeshVertexColor)
-					glColorPointer(3,GL_FLOAT,0,&(mIter->_meshColors[0]));
-				glDrawElements(GL_TRIANGLES,mIter->_meshGLIndices.size(),GL_UNSIGNED_INT,
-						&(mIter->_meshGLIndices[0]));
-				if (mIter->_hasMeshVertexColor)
-					glDisableClientState(GL_COLOR_ARRAY);
-				glDisableClientState(GL_VERTEX_ARRAY);
+				drawMesh(*mIter,GL_TRIANGLES);
 				glPopAttrib();
 			}
 			view.endGL();
@@ -183,29 +180,16 @@ void BifrostSurfaceShape::draw (M3dView& view,
 	break;
 	case M3dView::kGouraudShaded:
 	{
-		/*! \todo Need to handle vertex normal if available */
 		if (_bm.size() != 0)
 		{
 			view.beginGL();
-			BodyMeshDataCollection::const_iterator mEiter = _bm.end();
-			BodyMeshDataCollection::const_iterator mIter  = _bm.begin();
+			BodyMeshDataCollection::iterator mEiter = _bm.end();
+			BodyMeshDataCollection::iterator mIter  = _bm.begin();
 			for (;mIter!=mEiter;++mIter)
 			{
 				glPushAttrib(GL_CURRENT_BIT);
 				glPolygonMode( GL_FRONT, GL_FILL );
-				glEnableClientState(GL_VERTEX_ARRAY);
-				if (mIter->_hasMeshVertexColor)
-					glEnableClientState(GL_COLOR_ARRAY);
-				glVertexPointer(3,GL_FLOAT,0,&(mIter->_meshPositions[0]));
-				if (mIter->_hasMeshVertexColor)
-					glColorPointer(3,GL_FLOAT,0,&(mIter->_meshColors[0]));
-				if (mIter->_hasMeshVertexNormal)
-					glNormalPointer(GL_FLOAT,0,&(mIter->_meshNormals[0]));
-				glDrawElements(GL_TRIANGLES,mIter->_meshGLIndices.size(),GL_UNSIGNED_INT,
-						&(mIter->_meshGLIndices[0]));
-				if (mIter->_hasMeshVertexColor)
-					glDisableClientState(GL_COLOR_ARRAY);
-				glDisableClientState(GL_VERTEX_ARRAY);
+				drawMesh(*mIter,GL_TRIANGLES,mIter->_hasMeshVertexNormal);
 				glPopAttrib();
 			}
 			view.endGL();
@@ -218,6 +202,85 @@ void BifrostSurfaceShape::draw (M3dView& view,
 	}
 }
 
+const GLvoid* BifrostSurfaceShape::bindArray(const BifrostGLBuffer& buffer, const GLvoid* data)
+{
+	// gl*Pointer() takes an offset into the bound buffer object, or a
+	// client memory address when none is bound
+	if (!buffer.valid())
+		return data;
+	buffer.bind();
+	return 0;
+}
+
+void BifrostSurfaceShape::unbindArray(const BifrostGLBuffer& buffer)
+{
+	if (buffer.valid())
+		buffer.unbind();
+}
+
+void BifrostSurfaceShape::uploadParticleBuffers()
+{
+	if (!_particleBuffersDirty)
+		return;
+	_particleBuffersDirty = false;
+	const size_t numParticles = _particleFrame->positions.size()/3;
+	// Replaced on every frame during playback
+	if (!_particleBuffer.upload(particlePositions(),numParticles*3*sizeof(GLfloat),MGL_DYNAMIC_DRAW_ARB))
+		return;
+	if (_hasParticleColor)
+		_particleColorBuffer.upload(&_particleColors[0],_particleColors.size()*sizeof(GLfloat),MGL_DYNAMIC_DRAW_ARB);
+}
+
+void BifrostSurfaceShape::uploadMeshBuffers(BodyMeshData& mesh)
+{
+	if (!mesh._buffersDirty)
+		return;
+	mesh._buffersDirty = false;
+	if (!mesh._positionBuffer.upload(&mesh._meshPositions[0],mesh._meshPositions.size()*sizeof(GLfloat)))
+		return;
+	if (mesh._hasMeshVertexColor)
+		mesh._colorBuffer.upload(&mesh._meshColors[0],mesh._meshColors.size()*sizeof(GLfloat));
+	if (mesh._hasMeshVertexNormal)
+		mesh._normalBuffer.upload(&mesh._meshNormals[0],mesh._meshNormals.size()*sizeof(GLfloat));
+	if (!mesh._meshGLIndices.empty())
+		mesh._indexBuffer.upload(&mesh._meshGLIndices[0],mesh._meshGLIndices.size()*sizeof(GLuint));
+}
+
+void BifrostSurfaceShape::drawMesh(BodyMeshData& mesh, GLenum mode, bool withNormals)
+{
+	if (mesh._meshPositions.empty())
+		return;
+	uploadMeshBuffers(mesh);
+
+	// NOTE : Client state enable/disable order must reverse each other (like a stack)
+	glEnableClientState(GL_VERTEX_ARRAY);
+	if (mesh._hasMeshVertexColor)
+		glEnableClientState(GL_COLOR_ARRAY);
+	if (withNormals)
+		glEnableClientState(GL_NORMAL_ARRAY);
+	glVertexPointer(3,GL_FLOAT,0,bindArray(mesh._positionBuffer,&mesh._meshPositions[0]));
+	if (mesh._hasMeshVertexColor)
+		glColorPointer(3,GL_FLOAT,0,bindArray(mesh._colorBuffer,&mesh._meshColors[0]));
+	if (withNormals)
+		glNormalPointer(GL_FLOAT,0,bindArray(mesh._normalBuffer,&mesh._meshNormals[0]));
+	unbindArray(mesh._positionBuffer);
+
+	if (mode == GL_POINTS)
+		glDrawArrays(GL_POINTS,0,GLsizei(mesh._meshPositions.size()/3));
+	else if (!mesh._meshGLIndices.empty())
+	{
+		const GLvoid* indices = bindArray(mesh._indexBuffer,&mesh._meshGLIndices[0]);
+		glDrawElements(mode,GLsizei(mesh._meshGLIndices.size()),GL_UNSIGNED_INT,indices);
+		unbindArray(mesh._indexBuffer);
+	}
+
+	if (withNormals)
+		glDisableClientState(GL_NORMAL_ARRAY);
+	if (mesh._hasMeshVertexColor)
+		glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
 bool BifrostSurfaceShape::isBounded() const
 {
 	return true;
@@ -250,7 +313,7 @@ MBoundingBox BifrostSurfaceShape::boundingBox() const
 		MGlobal::displayInfo("boundingBox() return bbox[body field]");
 		return bbox;
 	}
-	else if (_hasParticleData)
+	else if (_hasParticleData || _hasCachedBounds)
 	{
 		MGlobal::displayInfo("boundingBox() return bbox[particle]");
 		return _particleBBox;
@@ -276,116 +339,118 @@ void BifrostSurfaceShape::setChannelNamesList(const MStringArray& attrList)
 	}
 }
 
-template<typename T>
-bool BifrostSurfaceShape::processChannelData(Bifrost::API::Component& component,
-		Bifrost::API::Channel& channel_data,
-		bool i_is_point_position,
-		std::vector<T>& o_channel_data_array) const
+size_t BifrostSurfaceShape::particleDrawCount() const
 {
-	Bifrost::API::Layout layout = component.layout();
-	float voxel_scale = layout.voxelScale();
-	size_t depthCount = layout.depthCount();
-
-
-	for ( size_t d=0; d<depthCount; d++ ) {
-		size_t tcount = layout.tileCount(d);
-		for ( size_t t=0; t<tcount; t++ ) {
-			Bifrost::API::TreeIndex tindex(t,d);
-			if ( !channel_data.elementCount( tindex ) ) {
-				// nothing there
-				continue;
-			}
-			Bifrost::API::TileData<T> data_element = channel_data.tileData<T>( tindex );
-			for (size_t i=0; i<data_element.count(); i++ ) {
-				if (i_is_point_position)
-					o_channel_data_array.push_back(data_element[i] * voxel_scale);
-				else
-					o_channel_data_array.push_back(data_element[i]);
-			}
-		}
-	}
-	return true;
+	if (!_hasParticleData)
+		return 0;
+	const std::vector<size_t>& lodCounts = _particleFrame->lodCounts;
+	const size_t numParticles = _particleFrame->positions.size()/3;
+	// Full detail when the time is not changing
+	if (lodCounts.empty() || !(MAnimControl::isPlaying() || MAnimControl::isScrubbing()))
+		return numParticles;
+	int pointBudget = 0;
+	MPlug budgetPlug(thisMObject(),_inPointBudgetAttr);
+	budgetPlug.getValue(pointBudget);
+	if (pointBudget <= 0)
+		return numParticles;
+	size_t count = lodCounts[0];
+	for (size_t level=1;level<lodCounts.size() && lodCounts[level]<=size_t(pointBudget);level++)
+		count = lodCounts[level];
+	return count;
 }
 
-bool BifrostSurfaceShape::loadParticleData(const MString& i_bifrost_filename,
-										   GLfloatVector& o_particlePositions,
-										   GLuintVector&  o_particleGLIndices)
+void BifrostSurfaceShape::adoptLoadedParticles()
 {
-	o_particlePositions.clear();
-	o_particleGLIndices.clear();
-
-	Bifrost::API::String biffile = i_bifrost_filename.asChar();
-
-	Bifrost::API::ObjectModel om;
-	Bifrost::API::FileIO fileio = om.createFileIO( biffile );
-	Bifrost::API::StateServer ss = fileio.load( );
-	const Bifrost::API::BIF::FileInfo& info = fileio.info();
+	int frameCacheSize = 0;
+	MPlug frameCacheSizePlug(thisMObject(),_inFrameCacheSizeAttr);
+	frameCacheSizePlug.getValue(frameCacheSize);
+	_frameCache.setMemoryBudget(size_t(std::max(frameCacheSize,0))<<20);
+
+	BifrostParticleLoader::ParticleDataPtr loaded = _loader.take();
+	if (!loaded)
+		return;
+	if (loaded->valid)
+		_frameCache.insert(loaded);
+	setParticleFrame(loaded);
+}
 
-	if ( !ss.valid() ) {
-		std::cerr << boost::format("Unable to load the content of the Bifrost file \"%1%\"") % biffile.c_str()
-                				  << std::endl;
-		return false;
+void BifrostSurfaceShape::setParticleFrame(const BifrostParticleLoader::ParticleDataPtr& frame)
+{
+	_hasParticleData = frame && frame->valid && !frame->positions.empty();
+	_particleFrame = _hasParticleData ? frame : BifrostParticleLoader::ParticleDataPtr();
+	_advectedPositions.clear();
+	_advectedSeconds = 0.0;
+	_particleBuffersDirty = true;
+	_particleVersion++;
+	if (_hasParticleData)
+	{
+		const BoundsCacheBox& bounds = frame->bounds;
+		_particleBBox = MBoundingBox(MPoint(bounds.min[0],bounds.min[1],bounds.min[2]),
+									 MPoint(bounds.max[0],bounds.max[1],bounds.max[2]));
 	}
+}
 
-	Bifrost::API::Component component = ss.components()[0];
-	if ( component.type() != Bifrost::API::PointComponentType ) {
-		std::cerr << "Wrong component (" << component.type() << ")" << std::endl;
-		return false;
+void BifrostSurfaceShape::advectParticles()
+{
+	if (!_hasParticleData || _particleFrame->velocities.empty())
+		return;
+	int fileFrame = 0;
+	if (!frame_from_filename(_particleFrame->filename,fileFrame))
+		return;
+
+	// Offset of the current time from the frame of the file, within a frame
+	MTime time;
+	MPlug timePlug(thisMObject(),_inTimeAttr);
+	timePlug.getValue(time);
+	const MTime::Unit frameUnit = MTime::uiUnit();
+	double frameOffset = time.as(frameUnit) - double(fileFrame);
+	double seconds = 0.0;
+	if (std::fabs(frameOffset) > 1e-4 && std::fabs(frameOffset) < 1.0)
+		seconds = frameOffset * MTime(1.0,frameUnit).as(MTime::kSeconds);
+	if (seconds == _advectedSeconds)
+		return;
+
+	_advectedSeconds = seconds;
+	_particleBuffersDirty = true;
+	_particleVersion++;
+	if (seconds == 0.0)
+	{
+		_advectedPositions.clear();
+		return;
 	}
+	const GLfloatVector& positions = _particleFrame->positions;
+	const GLfloatVector& velocities = _particleFrame->velocities;
+	_advectedPositions.resize(positions.size());
+	const size_t numParticles = positions.size()/3;
+	const size_t grainSize = 1<<16;
+	tbb::parallel_for(tbb::blocked_range<size_t>(0,numParticles,grainSize),
+					  [&](const tbb::blocked_range<size_t>& range) {
+		advect_points(&positions[range.begin()*3],&velocities[range.begin()*3],range.size(),
+					  float(seconds),&_advectedPositions[range.begin()*3]);
+	});
+}
 
-	// float bifrost_scale = 0.0;
+void BifrostSurfaceShape::updateParticles()
+{
+	adoptLoadedParticles();
+	advectParticles();
+}
 
-	Bifrost::API::RefArray channels = component.channels();
+const GLfloat* BifrostSurfaceShape::particlePositions() const
+{
+	if (!_advectedPositions.empty())
+		return &_advectedPositions[0];
+	return &_particleFrame->positions[0];
+}
 
-	for (size_t channelIndex=0;channelIndex<info.channelCount;channelIndex++)
-	{
-		const Bifrost::API::BIF::FileInfo::ChannelInfo& channelInfo = fileio.channelInfo(channelIndex);
-		std::cout << boost::format("channelInfo.name = %1%") % channelInfo.name.c_str() << std::endl;
-		bool is_point_position = channelInfo.name.find("position") != Bifrost::API::String::npos;
+const GLfloat* BifrostSurfaceShape::particleColors() const
+{
+	return _hasParticleColor ? &_particleColors[0] : 0;
+}
 
-		if (is_point_position)
-		{
-			std::cout << boost::format("FOUND position = %1%") % channelInfo.name.c_str() << std::endl;
-			switch (channelInfo.dataType)
-			{
-			case		Bifrost::API::FloatV3Type:	/*!< Defines a channel of type amino::Math::vec3f. #3 */
-			{
-				std::cout << "FOUND suitable FloatV3Type"<< std::endl;
-				typedef amino::Math::vec3f DataType;
-				std::vector<DataType> channel_data_array;
-				Bifrost::API::Channel channel = channels[channelIndex];
-
-				bool successfully_processed = processChannelData<DataType>(component,channel,is_point_position,channel_data_array);
-				if (successfully_processed)
-				{
-					size_t numParticles = channel_data_array.size();
-					std::cout << boost::format("SUCCESSFULLY processed %1% points") % numParticles << std::endl;
-					//								for (size_t i = 0; i<numParticles;i++)
-					//									v3_array.array()[i].assign(channel_data_array[i].v[0],channel_data_array[i].v[1],channel_data_array[i].v[2]);
-					for (size_t i = 0; i<numParticles;i++)
-					{
-						o_particlePositions.push_back(channel_data_array[i].v[0]);
-						o_particlePositions.push_back(channel_data_array[i].v[1]);
-						o_particlePositions.push_back(channel_data_array[i].v[2]);
-						_particleBBox.expand(MPoint(channel_data_array[i].v[0],channel_data_array[i].v[1],channel_data_array[i].v[2]));
-						o_particleGLIndices.push_back(i);
-					}
-					_hasParticleData = true;
-
-				}
-				else
-				{
-					// Return early, no point processing the other attribute if position is not found
-					return false;
-				}
-			}
-			break;
-			default:
-				break;
-			}
-		}
-	}
-	return true;
+size_t BifrostSurfaceShape::particleCount() const
+{
+	return _hasParticleData ? _particleFrame->positions.size()/3 : 0;
 }
 
 void BifrostSurfaceShape::drawBBox(const MBoundingBox& bbox) const
@@ -443,8 +508,29 @@ MStatus BifrostSurfaceShape::compute( const MPlug& plug, MDataBlock& data_block
 			_BifrostFilePathChanged = true;
 			_BifrostFilePath = bifrostFilePath;
 
-			if (!loadParticleData(_BifrostFilePath,_particlePositions,_particleGLIndices))
-				return MStatus::kFailure;
+			// Bounds from the sidecar are available before, and regardless of, the file load
+			BoundsCacheFrame cached_frame;
+			if (find_cached_frame_bounds(_BifrostFilePath.asChar(),cached_frame) && !cached_frame.world_bounds.empty())
+			{
+				const BoundsCacheBox& world_bounds = cached_frame.world_bounds;
+				_particleBBox = MBoundingBox(MPoint(world_bounds.min[0],world_bounds.min[1],world_bounds.min[2]),
+											 MPoint(world_bounds.max[0],world_bounds.max[1],world_bounds.max[2]));
+				_hasCachedBounds = true;
+			}
+			else
+				_hasCachedBounds = false;
+
+			// Frames already decoded are shown at once, others are loaded on
+			// the loader thread and draw() shows the previous particles (or
+			// the cached bounds) until the new ones are ready
+			BifrostParticleLoader::ParticleDataPtr cached = _frameCache.find(_BifrostFilePath.asChar());
+			if (cached)
+			{
+				_loader.cancel();
+				setParticleFrame(cached);
+			}
+			else
+				_loader.request(_BifrostFilePath.asChar());
 		}
 	}
 
@@ -526,6 +612,16 @@ MStatus BifrostSurfaceShape::initialize()
 	CMS(status = nAttr.setKeyable(true));
 	CMS(status = addAttribute( _inGeometryChunkAttr ));
 
+	// Input number of particles drawn during playback, 0 draws them all
+	CMS(_inPointBudgetAttr = nAttr.create( "pointBudget", "pbg", MFnNumericData::kLong, 1000000, &status ));
+	CMS(status = nAttr.setKeyable(true));
+	CMS(status = addAttribute( _inPointBudgetAttr ));
+
+	// Input memory budget of the decoded frames kept for scrubbing, in megabytes, 0 disables the cache
+	CMS(_inFrameCacheSizeAttr = nAttr.create( "frameCacheSize", "fcs", MFnNumericData::kLong, 2048, &status ));
+	CMS(status = nAttr.setMin(0));
+	CMS(status = addAttribute( _inFrameCacheSizeAttr ));
+
 	// Output channel names attribute
 	// CMS(_outChannelNamesAttr = tAttr.create( "outChannelNames", "ocn", MFnData::kString ,stringData.create(MString("")), &status));
 	CMS(_outChannelNamesAttr = tAttr.create("outChannelNames", "ocn", MFnData::kStringArray,
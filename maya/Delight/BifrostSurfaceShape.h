@@ -21,6 +21,10 @@
 #include <maya/M3dView.h>
 #include <maya/MStringArray.h>
 
+#include "BifrostParticleLoader.h"
+#include "BifrostFrameCache.h"
+#include "BifrostGLBuffer.h"
+
 #include <vector>
 
 class BifrostSurfaceShape : public MPxSurfaceShape
@@ -28,19 +32,28 @@ class BifrostSurfaceShape : public MPxSurfaceShape
 	typedef std::vector<GLfloat> GLfloatVector;
 	typedef std::vector<GLuint> GLuintVector;
 	struct BodyMeshData {
+		BodyMeshData()
+		: _indexBuffer(MGL_ELEMENT_ARRAY_BUFFER_ARB)
+		, _hasMeshVertexColor(false)
+		, _hasMeshVertexNormal(false)
+		, _buffersDirty(true)
+		{}
 		MBoundingBox _meshBBox;
 		GLfloatVector _meshPositions;
 		GLfloatVector _meshColors;
 		GLfloatVector _meshNormals;
 		GLuintVector _meshGLIndices;
-		GLuintVector _meshVertexGLIndices;
+		BifrostGLBuffer _positionBuffer;
+		BifrostGLBuffer _colorBuffer;
+		BifrostGLBuffer _normalBuffer;
+		BifrostGLBuffer _indexBuffer;
 		bool _hasMeshVertexColor;
 		bool _hasMeshVertexNormal;
+		bool _buffersDirty; /*!< set when the arrays change, the buffers are uploaded at the next draw */
 	};
 	struct BodyParticleData {
 		GLfloatVector _particlePositions;
 		GLfloatVector _particleColors;
-		GLuintVector _particleGLIndices;
 	};
 	struct BodyFieldData {
 		MBoundingBox _fieldBBox;
@@ -75,20 +88,45 @@ public:
 	/*! \brief Do we have body field data */
 	bool hasFieldData() const;
 
+	/*!
+	 * \brief Takes the last completed load and applies the sub-frame
+	 *        advection, call before reading the particles
+	 */
+	void updateParticles();
+	bool hasParticleData() const { return _hasParticleData; }
+	bool hasParticleColor() const { return _hasParticleColor; }
+	/*! \brief Displayed positions, xyz per particle in PointLOD order */
+	const GLfloat* particlePositions() const;
+	/*! \brief Displayed colors, rgb per particle, null without colors */
+	const GLfloat* particleColors() const;
+	size_t particleCount() const;
+	/*! \brief Points to draw, within the pointBudget attribute during playback */
+	size_t particleDrawCount() const;
+	/*! \brief Changes whenever the displayed particles change */
+	unsigned int particleVersion() const { return _particleVersion; }
+
 	// Parent class method to implement
 	static void *  creator();
 	static MStatus initialize();
 	static MTypeId typeId;
 private:
-	template<typename T>
-	bool processChannelData(Bifrost::API::Component& component,
-							Bifrost::API::Channel& channel_data,
-							bool i_is_point_position,
-							std::vector<T>& o_channel_data_array) const;
 	void setChannelNamesList(const MStringArray& attrList);
-	bool loadParticleData(const MString& i_bifrost_filename,
-						  GLfloatVector& o_particlePositions,
-						  GLuintVector& o_particleGLIndices);
+	/*! \brief Displays the last completed load, if any, and adds it to the frame cache */
+	void adoptLoadedParticles();
+	void setParticleFrame(const BifrostParticleLoader::ParticleDataPtr& frame);
+	/*!
+	 * \brief Moves the particles along their velocity by the sub-frame
+	 *        offset of the time attribute from the frame of the file
+	 */
+	void advectParticles();
+	/*! \brief Uploads the displayed particles if they changed since the last draw */
+	void uploadParticleBuffers();
+	void uploadMeshBuffers(BodyMeshData& mesh);
+	/*! \brief Draws the mesh vertices (GL_POINTS) or triangles (GL_TRIANGLES) */
+	void drawMesh(BodyMeshData& mesh, GLenum mode, bool withNormals = false);
+	/*! \brief Binds the buffer if valid, returns the gl*Pointer() argument */
+	static const GLvoid* bindArray(const BifrostGLBuffer& buffer, const GLvoid* data);
+	static void unbindArray(const BifrostGLBuffer& buffer);
     void drawBBox(const MBoundingBox& bbox) const;
 	MBoundingBox _particleBBox;
 	static MObject _inBifrostFileAttr;
@@ -96,17 +134,27 @@ private:
 	// static MObject _inParticleWidthAttr;
 	static MObject _inVelocityMotionBlurAttr;
 	static MObject _inGeometryChunkAttr;
+	static MObject _inPointBudgetAttr;
+	static MObject _inFrameCacheSizeAttr;
 	static MObject _outChannelNamesAttr;
 	static MObject _outBoundingBoxAttr;
 	MStringArray   fAttributeListArray;
-	GLfloatVector _particlePositions;
+	BifrostParticleLoader::ParticleDataPtr _particleFrame; /*!< displayed frame, particles in PointLOD order */
+	GLfloatVector _advectedPositions; /*!< _particleFrame positions at the sub-frame time, empty on whole frames */
+	double _advectedSeconds;
 	GLfloatVector _particleColors;
-	GLuintVector _particleGLIndices;
+	BifrostGLBuffer _particleBuffer; /*!< displayed positions, resident across redraws */
+	BifrostGLBuffer _particleColorBuffer;
+	bool _particleBuffersDirty;
+	unsigned int _particleVersion;
 
 	MString _BifrostFilePath;
 	bool _BifrostFilePathChanged;
 	bool _hasParticleColor;
 	bool _hasParticleData;
+	bool _hasCachedBounds; /*!< _particleBBox comes from the bounds cache sidecar */
+	BifrostParticleLoader _loader;
+	BifrostFrameCache _frameCache;
 
 	BodyMeshDataCollection _bm;
 	BodyParticleDataCollection _bp;
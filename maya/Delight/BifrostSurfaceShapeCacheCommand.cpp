@@ -10,6 +10,7 @@
 #include <ri.h>
 #include <fstream>
 #include <boost/format.hpp>
+#include <utils/BoundsCache.h>
 
 MStringArray BifrostSurfaceShapeCacheCommand::m_CachedShapeNames;
 MObject BifrostSurfaceShapeCacheCommand::m_CurrentBifrostSurfaceShape;
@@ -270,6 +271,33 @@ MStatus BifrostSurfaceShapeCacheCommand::parseSyntax (MArgDatabase &argData)
 			RtBound bound = {-RI_INFINITY,RI_INFINITY,
 							 -RI_INFINITY,RI_INFINITY,
 							 -RI_INFINITY,RI_INFINITY};
+			/*
+			  The bounds cache sidecar, when present, gives the real motion bound without loading the file.
+			  The procedural emits P and P + velocityScale*v/fps, in file space, as its two motion samples
+			  with its own defaults below. The cached velocity bounds hold P and P + v/cache_fps, so they
+			  only enclose the motion when that step is at least as long and in the same direction,
+			  otherwise the bound stays infinite
+			 */
+			const float proceduralFps = 24.0f;
+			const float proceduralVelocityScale = 1.0f;
+			const float proceduralPointRadius = 1.0f;
+			int bifrostFrame = 0;
+			BoundsCache boundsCache;
+			if (frame_from_filename(numberedFrameBifrostFilePath,bifrostFrame)
+				&& boundsCache.open(bounds_cache_filename(numberedFrameBifrostFilePath)))
+			{
+				const BoundsCacheFrame* cachedFrame = boundsCache.find_frame(bifrostFrame);
+				const float velocityStep = proceduralVelocityScale/proceduralFps;
+				bool velocityCovered = velocityStep >= 0.0f && velocityStep <= 1.0f/boundsCache.fps();
+				if (cachedFrame && velocityCovered && !cachedFrame->velocity_bounds.empty())
+				{
+					for (int axis=0;axis<3;axis++)
+					{
+						bound[axis*2]   = cachedFrame->velocity_bounds.min[axis] - proceduralPointRadius;
+						bound[axis*2+1] = cachedFrame->velocity_bounds.max[axis] + proceduralPointRadius;
+					}
+				}
+			}
 			RtString procedural_data[2] = {"emp_runproc",dsoArgs};
 			RtString program_data[2] = {"emp_runprog",dsoArgs};
 			char proceduralCommandString[BUFSIZ];
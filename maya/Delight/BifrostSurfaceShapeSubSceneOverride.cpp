@@ -0,0 +1,220 @@
+#include "BifrostSurfaceShapeSubSceneOverride.h"
+#include "BifrostSurfaceShape.h"
+#include <maya/MFnDagNode.h>
+#include <maya/MDagPath.h>
+#include <maya/MDagPathArray.h>
+#include <maya/MShaderManager.h>
+#include <maya/MViewport2Renderer.h>
+#include <maya/MBoundingBox.h>
+#include <string.h>
+
+namespace {
+
+const char* POINTS_RENDER_ITEM_NAME = "BifrostParticles";
+const float POINT_SIZE[2]           = { 2.0f, 2.0f };
+const float POINT_COLOR[4]          = { 0.1f, 0.4f, 1.0f, 1.0f };
+
+} // anonymous namespace
+
+MString BifrostSurfaceShapeSubSceneOverride::drawDbClassification("drawdb/subscene/bifrostSurfaceShape");
+MString BifrostSurfaceShapeSubSceneOverride::registrantId("BifrostSurfaceShapeSubSceneOverride");
+
+MHWRender::MPxSubSceneOverride* BifrostSurfaceShapeSubSceneOverride::creator(const MObject& obj)
+{
+	return new BifrostSurfaceShapeSubSceneOverride(obj);
+}
+
+BifrostSurfaceShapeSubSceneOverride::BifrostSurfaceShapeSubSceneOverride(const MObject& obj)
+: MHWRender::MPxSubSceneOverride(obj)
+, _shapeObject(obj)
+, _shape(0)
+, _shader(0)
+, _shaderHasColor(false)
+, _particleVersion(0)
+, _updated(false)
+, _drawCount(0)
+{
+	MFnDagNode node(obj);
+	_shape = dynamic_cast<BifrostSurfaceShape*>(node.userNode());
+}
+
+BifrostSurfaceShapeSubSceneOverride::~BifrostSurfaceShapeSubSceneOverride()
+{
+	MHWRender::MRenderer* renderer = MHWRender::MRenderer::theRenderer();
+	if (_shader && renderer)
+		renderer->getShaderManager()->releaseShader(_shader);
+}
+
+MHWRender::DrawAPI BifrostSurfaceShapeSubSceneOverride::supportedDrawAPIs() const
+{
+	return MHWRender::kAllDevices;
+}
+
+bool BifrostSurfaceShapeSubSceneOverride::requiresUpdate(const MHWRender::MSubSceneContainer& container,
+														 const MHWRender::MFrameContext& frameContext) const
+{
+	if (!_shape)
+		return false;
+	// Picks up background loads, this is the only per refresh entry point
+	_shape->updateParticles();
+	if (!_updated || _particleVersion != _shape->particleVersion())
+		return true;
+	if (_shape->hasParticleData() && _drawCount != _shape->particleDrawCount())
+		return true;
+	MMatrixArray matrices;
+	instanceMatrices(matrices);
+	if (matrices.length() != _matrices.length())
+		return true;
+	for (unsigned int i=0;i<matrices.length();i++)
+		if (matrices[i] != _matrices[i])
+			return true;
+	return false;
+}
+
+void BifrostSurfaceShapeSubSceneOverride::update(MHWRender::MSubSceneContainer& container,
+												 const MHWRender::MFrameContext& frameContext)
+{
+	MHWRender::MRenderItem* item = container.find(POINTS_RENDER_ITEM_NAME);
+	instanceMatrices(_matrices);
+	if (!_shape || !_shape->hasParticleData() || _matrices.length() == 0)
+	{
+		if (item)
+			item->enable(false);
+		if (_shape)
+			_particleVersion = _shape->particleVersion();
+		_updated = true;
+		return;
+	}
+
+	bool geometryChanged = false;
+	if (!item)
+	{
+		item = MHWRender::MRenderItem::Create(POINTS_RENDER_ITEM_NAME,
+											  MHWRender::MRenderItem::MaterialSceneItem,
+											  MHWRender::MGeometry::kPoints);
+		item->setDrawMode(MHWRender::MGeometry::kAll);
+		item->castsShadows(false);
+		item->receivesShadows(false);
+		container.add(item);
+		geometryChanged = true;
+	}
+	updateShader(_shape->hasParticleColor());
+	if (_shader)
+		item->setShader(_shader);
+
+	if (geometryChanged || !_updated || _particleVersion != _shape->particleVersion())
+	{
+		updateVertexBuffers();
+		_particleVersion = _shape->particleVersion();
+		_updated = true;
+		_drawCount = 0;
+		geometryChanged = true;
+	}
+	size_t drawCount = _shape->particleDrawCount();
+	if (!_indexBuffer || drawCount != _drawCount)
+	{
+		updateIndexBuffer(drawCount);
+		geometryChanged = true;
+	}
+	if (geometryChanged)
+	{
+		MHWRender::MVertexBufferArray buffers;
+		buffers.addBuffer("positions",_positionBuffer.get());
+		if (_colorBuffer)
+			buffers.addBuffer("colors",_colorBuffer.get());
+		MBoundingBox bounds = _shape->boundingBox();
+		setGeometryForRenderItem(*item,buffers,*_indexBuffer,&bounds);
+	}
+
+	// One transform per DAG instance, the buffers are shared
+	setInstanceTransformArray(*item,_matrices);
+	item->enable(true);
+}
+
+void BifrostSurfaceShapeSubSceneOverride::instanceMatrices(MMatrixArray& o_matrices) const
+{
+	o_matrices.clear();
+	MDagPathArray instances;
+	if (!MDagPath::getAllPathsTo(_shapeObject,instances))
+		return;
+	for (unsigned int i=0;i<instances.length();i++)
+		if (instances[i].isVisible())
+			o_matrices.append(instances[i].inclusiveMatrix());
+}
+
+void BifrostSurfaceShapeSubSceneOverride::updateShader(bool withColor)
+{
+	if (_shader && _shaderHasColor == withColor)
+		return;
+	MHWRender::MRenderer* renderer = MHWRender::MRenderer::theRenderer();
+	if (!renderer)
+		return;
+	const MHWRender::MShaderManager* shaderManager = renderer->getShaderManager();
+	if (_shader)
+		shaderManager->releaseShader(_shader);
+	// Stock camera facing sprites, sized in pixels
+	_shader = shaderManager->getStockShader(withColor
+											? MHWRender::MShaderInstance::k3dCPVFatPointShader
+											: MHWRender::MShaderInstance::k3dFatPointShader);
+	_shaderHasColor = withColor;
+	if (!_shader)
+		return;
+	_shader->setParameter("pointSize",POINT_SIZE);
+	if (!withColor)
+		_shader->setParameter("solidColor",POINT_COLOR);
+}
+
+void BifrostSurfaceShapeSubSceneOverride::updateVertexBuffers()
+{
+	const unsigned int numParticles = static_cast<unsigned int>(_shape->particleCount());
+
+	const MHWRender::MVertexBufferDescriptor positionDesc("",MHWRender::MGeometry::kPosition,
+														  MHWRender::MGeometry::kFloat,3);
+	if (!_positionBuffer)
+		_positionBuffer.reset(new MHWRender::MVertexBuffer(positionDesc));
+	float* positions = static_cast<float*>(_positionBuffer->acquire(numParticles,true));
+	if (positions)
+	{
+		memcpy(positions,_shape->particlePositions(),numParticles*3*sizeof(float));
+		_positionBuffer->commit(positions);
+	}
+
+	const float* rgb = _shape->particleColors();
+	if (!rgb)
+	{
+		_colorBuffer.reset();
+		return;
+	}
+	const MHWRender::MVertexBufferDescriptor colorDesc("",MHWRender::MGeometry::kColor,
+													   MHWRender::MGeometry::kFloat,4);
+	if (!_colorBuffer)
+		_colorBuffer.reset(new MHWRender::MVertexBuffer(colorDesc));
+	float* rgba = static_cast<float*>(_colorBuffer->acquire(numParticles,true));
+	if (rgba)
+	{
+		for (unsigned int i=0;i<numParticles;i++)
+		{
+			rgba[i*4]   = rgb[i*3];
+			rgba[i*4+1] = rgb[i*3+1];
+			rgba[i*4+2] = rgb[i*3+2];
+			rgba[i*4+3] = 1.0f;
+		}
+		_colorBuffer->commit(rgba);
+	}
+}
+
+void BifrostSurfaceShapeSubSceneOverride::updateIndexBuffer(size_t drawCount)
+{
+	// The budget selects a prefix of the particles, so the indices are
+	// always 0..drawCount-1
+	if (!_indexBuffer)
+		_indexBuffer.reset(new MHWRender::MIndexBuffer(MHWRender::MGeometry::kUnsignedInt32));
+	unsigned int* indices = static_cast<unsigned int*>(_indexBuffer->acquire(static_cast<unsigned int>(drawCount),true));
+	if (indices)
+	{
+		for (size_t i=0;i<drawCount;i++)
+			indices[i] = static_cast<unsigned int>(i);
+		_indexBuffer->commit(indices);
+	}
+	_drawCount = drawCount;
+}
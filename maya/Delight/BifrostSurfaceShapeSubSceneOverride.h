@@ -0,0 +1,57 @@
+#pragma once
+
+#include <maya/MPxSubSceneOverride.h>
+#include <maya/MHWGeometry.h>
+#include <maya/MMatrixArray.h>
+#include <maya/MString.h>
+#include <memory>
+
+class BifrostSurfaceShape;
+
+/*!
+ * \brief Viewport 2.0 drawing of the BifrostSurfaceShape particles
+ * \note One point render item holds the shape's displayed positions (and
+ *       colors) in MVertexBuffer objects, refilled only when the shape's
+ *       particle version changes. The particles are in PointLOD order, so
+ *       the playback point budget is a prefix of the index buffer. Every
+ *       DAG instance of the shape draws the same buffers through the
+ *       instance transform array. The legacy BifrostSurfaceShapeUI keeps
+ *       drawing the default viewport
+ */
+class BifrostSurfaceShapeSubSceneOverride : public MHWRender::MPxSubSceneOverride
+{
+public:
+	static MHWRender::MPxSubSceneOverride* creator(const MObject& obj);
+	virtual ~BifrostSurfaceShapeSubSceneOverride();
+
+	virtual MHWRender::DrawAPI supportedDrawAPIs() const;
+	virtual bool requiresUpdate(const MHWRender::MSubSceneContainer& container,
+								const MHWRender::MFrameContext& frameContext) const;
+	virtual void update(MHWRender::MSubSceneContainer& container,
+						const MHWRender::MFrameContext& frameContext);
+
+	static MString drawDbClassification;
+	static MString registrantId;
+
+private:
+	BifrostSurfaceShapeSubSceneOverride(const MObject& obj);
+
+	/*! \brief World matrices of the shape's visible DAG instances */
+	void instanceMatrices(MMatrixArray& o_matrices) const;
+	/*! \brief Point shader, per vertex colors when the shape has colors */
+	void updateShader(bool withColor);
+	void updateVertexBuffers();
+	void updateIndexBuffer(size_t drawCount);
+
+	MObject                                     _shapeObject;
+	BifrostSurfaceShape*                        _shape;
+	MHWRender::MShaderInstance*                 _shader;
+	bool                                        _shaderHasColor;
+	std::unique_ptr<MHWRender::MVertexBuffer>   _positionBuffer;
+	std::unique_ptr<MHWRender::MVertexBuffer>   _colorBuffer;
+	std::unique_ptr<MHWRender::MIndexBuffer>    _indexBuffer;
+	unsigned int                                _particleVersion;
+	bool                                        _updated; /*!< update() ran at least once */
+	size_t                                      _drawCount;
+	MMatrixArray                                _matrices;
+};
@@ -1,7 +1,9 @@
 #include "BifrostSurfaceShape.h"
 #include "BifrostSurfaceShapeUI.h"
 #include "BifrostSurfaceShapeCacheCommand.h"
+#include "BifrostSurfaceShapeSubSceneOverride.h"
 #include <maya/MFnPlugin.h>
+#include <maya/MDrawRegistry.h>
 #include "MayaUtils.h"
 #include <boost/format.hpp>
 
@@ -19,7 +21,13 @@ MStatus initializePlugin( MObject obj )
                                      BifrostSurfaceShape::typeId,
                                      &BifrostSurfaceShape::creator,
                                      &BifrostSurfaceShape::initialize,
-                                     &BifrostSurfaceShapeUI::creator));
+                                     &BifrostSurfaceShapeUI::creator,
+                                     &BifrostSurfaceShapeSubSceneOverride::drawDbClassification));
+
+  CMS(status = MHWRender::MDrawRegistry::registerSubSceneOverrideCreator(
+                                     BifrostSurfaceShapeSubSceneOverride::drawDbClassification,
+                                     BifrostSurfaceShapeSubSceneOverride::registrantId,
+                                     &BifrostSurfaceShapeSubSceneOverride::creator));
 
   CMS(status = plugin.registerCommand("BifrostSurfaceShapeCache",
                                       &BifrostSurfaceShapeCacheCommand::creator,
@@ -44,6 +52,9 @@ MStatus uninitializePlugin( MObject obj)
   MStatus status;
   int lic_status = 0;
   MFnPlugin plugin( obj );
+  MHWRender::MDrawRegistry::deregisterSubSceneOverrideCreator(
+                                     BifrostSurfaceShapeSubSceneOverride::drawDbClassification,
+                                     BifrostSurfaceShapeSubSceneOverride::registrantId);
   status = plugin.deregisterNode( BifrostSurfaceShape::typeId );
   
   return status;
@@ -1,5 +1,6 @@
 #include "ProcArgs.h"
 #include <boost/program_options.hpp>
+#include <algorithm>
 
 namespace po = boost::program_options;
 
@@ -10,9 +11,16 @@ ProcArgs::ProcArgs()
 , pointMode(0) // default is disk = 0, sphere = 1, quad = 2
 , enableVelocityMotionBlur(false)
 , performEmission(false)
+, bifrostComponentIndex(0)
 , bifrostTileIndex(0)
 , bifrostTileDepth(0)
+, bifrostTileCount(1)
+, clusterSize(250000)
+, hasRegionOfInterest(false)
+, expectedReaderCount(0)
 {
+    for (int i=0;i<6;i++)
+        regionOfInterest[i] = 0.0f;
 }
 
 int ProcArgs::processDataStringAsArgcArgv(int argc, const char **argv)
@@ -22,8 +30,12 @@ int ProcArgs::processDataStringAsArgcArgv(int argc, const char **argv)
         float radius = 0.01f; // default - renders point of size 0.01
         size_t mode = 0; // default - disk
         std::string bifrost_filename;
+        size_t componentIndex = 0;
         size_t tileIndex = 0;
         size_t tileDepth = 0;
+        size_t tileCount = 1;
+        size_t cluster = 250000;
+        std::vector<float> roi;
         po::options_description desc("Allowed options");
         desc.add_options()
             ("version", "print version string")
@@ -37,11 +49,19 @@ int ProcArgs::processDataStringAsArgcArgv(int argc, const char **argv)
             ("velocity-blur", "use velocity for motion blur.")
             ("bif", po::value<std::string>(&bifrost_filename),
              "bifrost filename.")
+            ("component", po::value<size_t>(&componentIndex),
+             "bifrost point component index.")
             ("tile-index", po::value<size_t>(&tileIndex),
              "bifrost tile index.")
             ("tile-depth", po::value<size_t>(&tileDepth),
              "bifrost tile depth.")
+            ("tile-count", po::value<size_t>(&tileCount),
+             "number of consecutive tiles from tile-index emitted in one node.")
+            ("cluster-size", po::value<size_t>(&cluster),
+             "target number of points per node, consecutive tiles of a depth are merged up to it, 0 emits one node per tile.")
             ("emit", "non-root level, perform emission.")
+            ("roi", po::value<std::vector<float> >(&roi)->multitoken(),
+             "region of interest xmin ymin zmin xmax ymax zmax, only the tiles overlapping it are emitted when the file has a tile index (bifinfo --build-index). With velocity motion blur the tiles are matched on their motion blurred bounds instead, from the bounds cache (bifinfo --write-bounds) or the loaded file.")
             ;
 
         po::variables_map vm;
@@ -63,8 +83,17 @@ int ProcArgs::processDataStringAsArgcArgv(int argc, const char **argv)
         pointMode = mode;
         bifrostFilename = bifrost_filename;
         // std::cout << "XXXXXXXXXXXXXX bifrost_filename : " << bifrost_filename << std::endl;
+        bifrostComponentIndex = componentIndex;
         bifrostTileIndex = tileIndex;
         bifrostTileDepth = tileDepth;
+        bifrostTileCount = tileCount;
+        clusterSize = cluster;
+        if (vm.count("roi")) {
+            if (roi.size() != 6)
+                throw std::runtime_error("--roi expects 6 values, xmin ymin zmin xmax ymax zmax");
+            hasRegionOfInterest = true;
+            std::copy(roi.begin(),roi.end(),regionOfInterest);
+        }
     }
     catch(std::exception& e) {
         std::cerr << "error: " << e.what() << "\n";
@@ -82,6 +111,9 @@ void ProcArgs::print() const
     printf("enableVelocityMotionBlur = %s\n",(enableVelocityMotionBlur?"true":"false"));
     printf("performEmission          = %s\n",(performEmission?"true":"false"));
     printf("bifrostFilename          = %s\n",bifrostFilename.c_str());
+    printf("bifrostComponentIndex    = %zu\n",bifrostComponentIndex);
     printf("bifrostTileIndex         = %zu\n",bifrostTileIndex);
     printf("bifrostTileDepth         = %zu\n",bifrostTileDepth);
+    printf("bifrostTileCount         = %zu\n",bifrostTileCount);
+    printf("clusterSize              = %zu\n",clusterSize);
 }
@@ -21,8 +21,15 @@ struct ProcArgs {
     bool enableVelocityMotionBlur;
     bool performEmission;
     std::string bifrostFilename;
+    size_t bifrostComponentIndex;
     size_t bifrostTileIndex;
     size_t bifrostTileDepth;
+    size_t bifrostTileCount; /*!< tiles bifrostTileIndex.. at bifrostTileDepth emitted together */
+    size_t clusterSize;      /*!< target points per node, 0 for one node per tile */
+    bool hasRegionOfInterest;
+    float regionOfInterest[6]; /*!< xmin ymin zmin xmax ymax zmax */
+    std::string expectedFilename; /*!< root level, file its children read through ProcFileCache */
+    size_t expectedReaderCount;   /*!< root level, children declared to ProcFileCache */
     int processDataStringAsArgcArgv(int argc, const char **argv);
     void print() const;
 };
@@ -0,0 +1,90 @@
+#include "ProcFileCache.h"
+#include <algorithm>
+
+ProcFileCache& ProcFileCache::instance()
+{
+    static ProcFileCache cache;
+    return cache;
+}
+
+ProcFileCache::EntryPtr ProcFileCache::entry(const std::string& filename)
+{
+    EntryPtr& result = _entries[filename];
+    if (!result)
+        result.reset(new Entry);
+    return result;
+}
+
+void ProcFileCache::expect(const std::string& filename,
+                           size_t reader_count,
+                           const Bifrost::API::StateServer* loaded)
+{
+    EntryPtr file;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        file = entry(filename);
+        file->readers += reader_count;
+    }
+    if (loaded)
+    {
+        std::lock_guard<std::mutex> load_lock(file->load_mutex);
+        if (!file->loaded)
+        {
+            file->ss = *loaded;
+            file->loaded = true;
+        }
+    }
+}
+
+bool ProcFileCache::acquire(const std::string& filename,
+                            Bifrost::API::StateServer& o_ss)
+{
+    EntryPtr file;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        file = entry(filename);
+    }
+    // Only the readers of this file wait for its load
+    std::lock_guard<std::mutex> load_lock(file->load_mutex);
+    if (file->failed)
+        return false;
+    if (!file->loaded)
+    {
+        Bifrost::API::ObjectModel om;
+        Bifrost::API::FileIO fileio = om.createFileIO( filename.c_str() );
+        file->ss = fileio.load( );
+        if ( !file->ss.valid() )
+        {
+            file->failed = true;
+            return false;
+        }
+        file->loaded = true;
+    }
+    o_ss = file->ss;
+    return true;
+}
+
+void ProcFileCache::release(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    EntryMap::iterator found = _entries.find(filename);
+    if (found == _entries.end())
+        return;
+    // A reader without a matching expect() releases right away
+    if (found->second->readers > 0)
+        found->second->readers--;
+    if (found->second->readers == 0)
+        _entries.erase(found);
+}
+
+void ProcFileCache::abandon(const std::string& filename,
+                            size_t reader_count)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    EntryMap::iterator found = _entries.find(filename);
+    if (found == _entries.end())
+        return;
+    found->second->readers -= std::min(found->second->readers,reader_count);
+    if (found->second->readers == 0)
+        _entries.erase(found);
+}
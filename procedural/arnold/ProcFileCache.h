@@ -0,0 +1,62 @@
+#pragma once
+
+#include <BifrostHeaders.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*!
+ * \brief Loaded Bifrost files shared by the tile procedurals of a frame
+ * \note The Bifrost SDK loads a file as a whole, so the per-tile child
+ *       procedurals share one StateServer instead of each loading the file.
+ *       The root procedural declares how many children will read a file,
+ *       the first child to expand loads it (unless the root already did)
+ *       and the last one to release it frees it. Children that are never
+ *       expanded (tiles no ray reaches) never release, the root abandons
+ *       them when it is cleaned up. Safe to call from concurrent expansions
+ */
+class ProcFileCache
+{
+public:
+    static ProcFileCache& instance();
+
+    /*!
+     * \brief Declares reader_count more acquire()/release() pairs of the file
+     * \param loaded The file when the caller has already loaded it, may be null
+     */
+    void expect(const std::string& filename,
+                size_t reader_count,
+                const Bifrost::API::StateServer* loaded);
+    /*! \brief The loaded file, loaded on the first call, false if it cannot be loaded */
+    bool acquire(const std::string& filename,
+                 Bifrost::API::StateServer& o_ss);
+    /*! \brief Frees the file once every expected reader has released it */
+    void release(const std::string& filename);
+    /*!
+     * \brief Withdraws the readers declared by expect() that are still
+     *        outstanding, at most reader_count, and frees the file when none
+     *        is left. Readers arriving later load the file on their own
+     */
+    void abandon(const std::string& filename,
+                 size_t reader_count);
+
+private:
+    struct Entry
+    {
+        Entry() : loaded(false), failed(false), readers(0) {}
+        std::mutex                load_mutex;
+        bool                      loaded;
+        bool                      failed; /*!< not retried by every reader */
+        Bifrost::API::StateServer ss;
+        size_t                    readers;
+    };
+    typedef std::shared_ptr<Entry> EntryPtr;
+    typedef std::unordered_map<std::string,EntryPtr> EntryMap;
+
+    ProcFileCache() {}
+    EntryPtr entry(const std::string& filename);
+
+    std::mutex _mutex;
+    EntryMap   _entries;
+};
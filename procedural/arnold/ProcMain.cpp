@@ -1,5 +1,10 @@
 #include "ProcArgs.h"
 #include <utils/BifrostUtils.h>
+#include <utils/BoundsCache.h>
+#include <utils/TileIndex.h>
+#include "ProcFileCache.h"
+#include <unordered_set>
+#include <algorithm>
 #include <ai.h>
 #include <string.h>
 #include <boost/format.hpp>
@@ -22,155 +27,463 @@
 
 const size_t MAX_BIF_FILENAME_LENGTH = 4096;
 
+namespace {
+
+typedef std::unordered_set<uint64_t> TileKeySet;
+
+/*!
+ * \brief Per-tile bounds of the point components from the sidecars, so the
+ *        root procedural does not load the file
+ * \note The bounds cache velocity bounds hold P and P + v/cache_fps, so they
+ *       also enclose P + velocityScale*v/fps when that step is shorter and
+ *       not negative, otherwise computed_tile_bounds() is used. The
+ *       tile index has no velocity extent and is only used without motion
+ *       blur. Tile index bounds are in world space, each record is scaled
+ *       back by its own component's voxel scale as the points are emitted
+ *       in file space
+ */
+bool sidecar_tile_bounds(const std::string& bif_filename,
+                         const ProcArgs& args,
+                         float fps_1,
+                         BoundsCacheTileContainer& o_tiles)
+{
+    o_tiles.clear();
+    int frame = 0;
+    BoundsCache bounds_cache;
+    if (frame_from_filename(bif_filename,frame)
+        && bounds_cache.open(bounds_cache_filename(bif_filename)))
+    {
+        const BoundsCacheFrame* cached_frame = bounds_cache.find_frame(frame);
+        // Only P..P + v/cache_fps is cached, a negative step goes the other way
+        const float velocity_step = args.velocityScale * fps_1;
+        bool velocity_covered = !args.enableVelocityMotionBlur
+            || (velocity_step >= 0.0f && velocity_step <= 1.0f/bounds_cache.fps());
+        if (cached_frame && velocity_covered && bounds_cache.read_tiles(*cached_frame,o_tiles))
+            return true;
+    }
+    if (args.enableVelocityMotionBlur)
+        return false;
+    TileIndex tile_index;
+    if (!tile_index.read(tile_index_filename(bif_filename)))
+        return false;
+    o_tiles.resize(tile_index.tile_count());
+    for (size_t i=0;i<tile_index.tile_count();i++)
+    {
+        const TileIndexRecord& record = tile_index.tile(i);
+        const float voxel_scale_1 = 1.0f/record.voxel_scale;
+        BoundsCacheTile& tile = o_tiles[i];
+        tile.component = record.component;
+        tile.tile = record.tile;
+        tile.depth = record.depth;
+        tile.element_count = record.element_count;
+        for (int axis=0;axis<3;axis++)
+        {
+            tile.bounds.min[axis] = record.bounds.min[axis] * voxel_scale_1;
+            tile.bounds.max[axis] = record.bounds.max[axis] * voxel_scale_1;
+        }
+        tile.velocity_bounds = tile.bounds;
+    }
+    return true;
+}
+
+/*! \brief Per-tile bounds of the point components of a loaded file */
+void computed_tile_bounds(const Bifrost::API::StateServer& ss,
+                          const ProcArgs& args,
+                          float fps_1,
+                          BoundsCacheTileContainer& o_tiles)
+{
+    o_tiles.clear();
+    // compute_point_bounds() extrudes by v/fps
+    const float velocity_fps = 1.0f/(args.velocityScale * fps_1);
+    size_t numComponents = ss.components().count();
+    for (size_t componentIndex=0;componentIndex<numComponents;componentIndex++)
+    {
+        Bifrost::API::Component component = ss.components()[componentIndex];
+        if (component.type() != Bifrost::API::PointComponentType)
+            continue;
+        BoundsCacheFrame frame;
+        compute_point_bounds(component,uint32_t(componentIndex),"position","velocity",velocity_fps,frame,o_tiles);
+    }
+}
+
+/*!
+ * \brief Consecutive tiles of one depth emitted as a single points node,
+ *        tiles tile_begin to tile_end (exclusive). Empty tiles inside the
+ *        range are harmless
+ */
+struct TileCluster
+{
+    TileCluster()
+    : component(0)
+    , depth(0)
+    , tile_begin(0)
+    , tile_end(0)
+    , element_count(0)
+    {}
+    uint32_t       component;
+    uint32_t       depth;
+    uint32_t       tile_begin;
+    uint32_t       tile_end;
+    uint64_t       element_count;
+    BoundsCacheBox bounds;
+};
+typedef std::vector<TileCluster> TileClusterContainer;
+
+/*!
+ * \brief Merges consecutive tiles of the same component and depth until
+ *        the next tile would take the cluster over cluster_size points
+ * \note The tiles are in component then depth/tile order, as written by the
+ *       sidecars and compute_point_bounds(). A tile larger than cluster_size
+ *       is a cluster on its own, cluster_size 0 makes one cluster per tile
+ * \param roi_tiles Tiles to keep per component, null for all. A tile left
+ *        out ends the current cluster so the range does not cover it
+ */
+void cluster_tiles(const BoundsCacheTileContainer& tiles,
+                   bool use_velocity_bounds,
+                   size_t cluster_size,
+                   const std::vector<TileKeySet>* roi_tiles,
+                   TileClusterContainer& o_clusters)
+{
+    o_clusters.clear();
+    TileCluster cluster;
+    bool open = false;
+    for (size_t i=0;i<tiles.size();i++)
+    {
+        const BoundsCacheTile& tile = tiles[i];
+        if (tile.element_count == 0)
+            continue;
+        const BoundsCacheBox& bounds = use_velocity_bounds ? tile.velocity_bounds : tile.bounds;
+        bool selected = !bounds.empty()
+            && (!roi_tiles
+                || (tile.component < roi_tiles->size()
+                    && (*roi_tiles)[tile.component].count(TileIndex::tile_key(tile.tile,tile.depth)) > 0));
+        if (open
+            && (!selected
+                || tile.component != cluster.component
+                || tile.depth != cluster.depth
+                || tile.tile < cluster.tile_end
+                || cluster.element_count + tile.element_count > cluster_size))
+        {
+            o_clusters.push_back(cluster);
+            open = false;
+        }
+        if (!selected)
+            continue;
+        if (!open)
+        {
+            cluster = TileCluster();
+            cluster.component = tile.component;
+            cluster.depth = tile.depth;
+            cluster.tile_begin = tile.tile;
+            open = true;
+        }
+        cluster.tile_end = tile.tile+1;
+        cluster.element_count += tile.element_count;
+        cluster.bounds.extend(bounds);
+    }
+    if (open)
+        o_clusters.push_back(cluster);
+}
+
+/*!
+ * \brief Creates one deferred child procedural per tile cluster, bounded
+ *        by the cluster's points (and their velocity extent) padded by the
+ *        point radius
+ * \return The number of procedurals created
+ */
+size_t create_tile_procedurals(ProcArgs* args,
+                               const char* dso,
+                               const std::string& dataString,
+                               const TileClusterContainer& clusters)
+{
+    const char* parentName = AiNodeGetName(args->proceduralNode);
+    const float padding = args->pointRadius;
+    for (size_t i=0;i<clusters.size();i++)
+    {
+        const TileCluster& cluster = clusters[i];
+        const BoundsCacheBox& bounds = cluster.bounds;
+        const uint32_t tile_count = cluster.tile_end - cluster.tile_begin;
+
+        args->createdNodes.push_back(AiNode("procedural"));
+        AtNode *procedural = args->createdNodes.back();
+        std::string proceduralName = (boost::format("%1%.c%2%.d%3%.t%4%")
+                                      % (parentName ? parentName : "bifrost") % cluster.component % cluster.depth % cluster.tile_begin).str();
+        AiNodeSetStr(procedural,"name",proceduralName.c_str());
+        AiNodeSetStr(procedural,"dso",dso);
+        AiNodeSetPnt(procedural,"min",bounds.min[0]-padding,bounds.min[1]-padding,bounds.min[2]-padding);
+        AiNodeSetPnt(procedural,"max",bounds.max[0]+padding,bounds.max[1]+padding,bounds.max[2]+padding);
+        boost::format formattedDataString =
+            boost::format(
+                          "%1%" /* implicitly contains
+                                   --bif,
+                                   --point-radius,
+                                   --velocity-blur
+                                */
+                          " --component %2%"
+                          " --tile-index %3%"
+                          " --tile-depth %4%"
+                          " --tile-count %5%"
+                          " --emit")
+            % dataString.c_str()
+            % cluster.component
+            % cluster.tile_begin
+            % cluster.depth
+            % tile_count;
+        AiNodeSetStr(procedural,"data",formattedDataString.str().c_str());
+    }
+    return clusters.size();
+}
+
+/*!
+ * \brief Creates one points node holding the tiles selected by the arguments
+ * \note The tiles are counted and their data validated first so the point,
+ *       motion key and radius arrays are allocated once at their final size
+ *       and every element is filled in place
+ */
+void emit_tile_points(const Bifrost::API::StateServer& ss,
+                      ProcArgs* args,
+                      float fps_1)
+{
+    if (args->bifrostComponentIndex >= ss.components().count())
+        return;
+    Bifrost::API::Component component = ss.components()[args->bifrostComponentIndex];
+    if (component.type() != Bifrost::API::PointComponentType)
+        return;
+    ChannelIndex channel_index(component);
+    int positionChannelIndex = channel_index.find("position");
+    int velocityChannelIndex = channel_index.find("velocity");
+    if (positionChannelIndex<0)
+        return;
+    const Bifrost::API::Channel& position_ch = channel_index.channel(positionChannelIndex);
+    // A missing velocity channel is left invalid and fails the motion blur check below
+    const Bifrost::API::Channel velocity_ch = velocityChannelIndex>=0 ? channel_index.channel(velocityChannelIndex) : Bifrost::API::Channel();
+    if (!position_ch.valid() || (args->enableVelocityMotionBlur && !velocity_ch.valid()))
+    {
+        AiMsgWarning("Bifrost-procedural : Position channel not found or velocity channel not found where velocity motion blur is requested");
+        return;
+    }
+    if ( position_ch.dataType() != Bifrost::API::FloatV3Type
+         || (args->enableVelocityMotionBlur && velocity_ch.dataType() != Bifrost::API::FloatV3Type))
+    {
+        AiMsgWarning("Bifrost-procedural : Position channel not of FloatV3Type or velocity channel not of FloatV3Type where velocity motion blur is requested");
+        return;
+    }
+
+    Bifrost::API::Layout layout = component.layout();
+    if (args->bifrostTileDepth >= layout.depthCount())
+        return;
+    const size_t tileEnd = std::min(args->bifrostTileIndex + args->bifrostTileCount,
+                                    size_t(layout.tileCount(args->bifrostTileDepth)));
+    struct TileSlice {
+        const amino::Math::vec3f* position;
+        const amino::Math::vec3f* velocity;
+        size_t count;
+    };
+    std::vector<TileSlice> slices;
+    size_t numPoints = 0;
+    for (size_t t=args->bifrostTileIndex;t<tileEnd;t++)
+    {
+        Bifrost::API::TreeIndex tindex(t,args->bifrostTileDepth);
+        size_t count = position_ch.elementCount( tindex );
+        if (count == 0)
+            continue;
+        size_t bufferSize = 0;
+        TileSlice slice = { 0, 0, count };
+        slice.position = static_cast<const amino::Math::vec3f*>(position_ch.tileDataPtr( tindex, bufferSize ));
+        if (!slice.position || bufferSize < count)
+            continue;
+        if (args->enableVelocityMotionBlur)
+        {
+            if (velocity_ch.elementCount( tindex ) != count)
+                continue;
+            slice.velocity = static_cast<const amino::Math::vec3f*>(velocity_ch.tileDataPtr( tindex, bufferSize ));
+            if (!slice.velocity || bufferSize < count)
+                continue;
+        }
+        slices.push_back(slice);
+        numPoints += count;
+    }
+    if (numPoints == 0)
+        return;
+
+    const size_t numKeys = args->enableVelocityMotionBlur ? 2 : 1;
+    AtArray *pointsArray = AiArrayAllocate(numPoints,numKeys,AI_TYPE_POINT);
+    AtArray *radiusArray = AiArrayAllocate(numPoints,1,AI_TYPE_FLOAT);
+    AtPoint *P = static_cast<AtPoint*>(pointsArray->data);
+    AtPoint *PP = P + numPoints; // second motion key
+    float *radius = static_cast<float*>(radiusArray->data);
+    const float velocity_step = args->velocityScale * fps_1;
+    size_t offset = 0;
+    for (size_t sliceIndex=0;sliceIndex<slices.size();sliceIndex++)
+    {
+        const TileSlice& slice = slices[sliceIndex];
+        const amino::Math::vec3f* position_tile_data = slice.position;
+        memcpy(P + offset,position_tile_data,slice.count*sizeof(AtPoint));
+        if (args->enableVelocityMotionBlur)
+        {
+            const amino::Math::vec3f* velocity_tile_data = slice.velocity;
+            for (size_t i=0; i<slice.count; i++ ) {
+                PP[offset+i].x = position_tile_data[i][0] + velocity_step * velocity_tile_data[i][0];
+                PP[offset+i].y = position_tile_data[i][1] + velocity_step * velocity_tile_data[i][1];
+                PP[offset+i].z = position_tile_data[i][2] + velocity_step * velocity_tile_data[i][2];
+            }
+        }
+        offset += slice.count;
+    }
+    std::fill(radius,radius+numPoints,args->pointRadius);
+
+    args->createdNodes.push_back(AiNode("points"));
+    AtNode *points = args->createdNodes.back();
+    AiNodeSetArray(points, "points",pointsArray);
+    AiNodeSetArray(points, "radius",radiusArray);
+    AiNodeSetInt(points,"mode",args->pointMode);
+}
+
+} // anonymous namespace
+
+/*!
+ * \remark The procedural recurses one level. The root level creates one
+ *         deferred procedural per cluster of tiles (--cluster-size),
+ *         bounded from the sidecars when available so the file is not even
+ *         loaded, and Arnold expands a cluster (--emit) only when a ray
+ *         reaches its bounds. The tiles of a
+ *         file share one load through ProcFileCache
+ */
 int ProcInit( struct AtNode *node, void **user_ptr )
 {
     // printf("ProcInit : 0001\n");
     ProcArgs * args = new ProcArgs();
     args->proceduralNode = node;
+    *user_ptr = args;
 
     const char *parentProceduralDSO = AiNodeGetStr(node,"dso");
     std::string dataString = AiNodeGetStr(node,"data");
     // printf("ProcInit : 0002 dataString = \"%s\"\n",dataString.c_str());
-    if (dataString.size() != 0)
-    {
-        // printf("ProcInit : 0010\n");
-        const float current_frame = AiNodeGetFlt(AiUniverseGetOptions(), "frame");
-        const float fps_1 = 1.0f/AiNodeGetFlt(AiUniverseGetOptions(), "fps");
-
-        std::string parsingDataString = (boost::format("%1% %2%") % parentProceduralDSO % dataString.c_str()).str();
-        PI::String2ArgcArgv s2aa(parsingDataString);
-        args->processDataStringAsArgcArgv(s2aa.argc(),s2aa.argv());
-        // printf("ProcInit : 0015\n");
-        // args->print();
-        // printf("ProcInit : 0016\n");
-        std::string bif_filename_format = args->bifrostFilename;
-
-        char bif_filename[MAX_BIF_FILENAME_LENGTH];
-        uint32_t bif_int_frame_number = static_cast<uint32_t>(floor(current_frame));
-        int sprintf_status = sprintf(bif_filename,bif_filename_format.c_str(),bif_int_frame_number);
-        // printf("ProcInit : 0018 bif_filename_format = \"%s\"\n",bif_filename_format.c_str());
-
-        // printf("ProcInit : 0030\n");
-        /*!
-         * \remark Iterate through each tile in the bifrost file,
-         *         determine the bounds for that tile (including
-         *         velocity blur growth) and generate a procedural
-         *         for that tile of particle data
-         */
-        // printf("ProcInit : 0031 bif_filename = \"%s\"\n",bif_filename);
+    if (dataString.size() == 0)
+        return true;
+
+    const float current_frame = AiNodeGetFlt(AiUniverseGetOptions(), "frame");
+    const float fps_1 = 1.0f/AiNodeGetFlt(AiUniverseGetOptions(), "fps");
+
+    std::string parsingDataString = (boost::format("%1% %2%") % parentProceduralDSO % dataString.c_str()).str();
+    PI::String2ArgcArgv s2aa(parsingDataString);
+    args->processDataStringAsArgcArgv(s2aa.argc(),s2aa.argv());
+    // args->print();
+    std::string bif_filename_format = args->bifrostFilename;
+
+    char bif_filename[MAX_BIF_FILENAME_LENGTH];
+    uint32_t bif_int_frame_number = static_cast<uint32_t>(floor(current_frame));
+    int sprintf_status = sprintf(bif_filename,bif_filename_format.c_str(),bif_int_frame_number);
+    // printf("ProcInit : 0018 bif_filename_format = \"%s\"\n",bif_filename_format.c_str());
+
+    if (args->performEmission)
+    {
+        // Child level, emit the points of one tile
+        ProcFileCache& file_cache = ProcFileCache::instance();
+        Bifrost::API::StateServer ss;
+        bool loaded = file_cache.acquire(bif_filename,ss);
+        if (loaded)
+            emit_tile_points(ss,args,fps_1);
+        file_cache.release(bif_filename);
+        return loaded;
+    }
+
+    // Frames recorded as empty in the bounds cache sidecar are not loaded
+    BoundsCacheFrame cached_frame;
+    if (find_cached_frame_bounds(bif_filename,cached_frame) && cached_frame.element_count == 0)
+        return true;
+    /*!
+     * \remark With a region of interest and a tile index sidecar only
+     *         the tiles overlapping the region are emitted, the file is
+     *         not loaded at all when none does. The tile index has no
+     *         velocity extent : with velocity motion blur the tiles are
+     *         matched on their velocity bounds once these are known
+     */
+    std::vector<TileKeySet> roi_tiles;
+    // The region and the points are in file space, the index is in world space
+    BoundsCacheBox region;
+    for (int axis=0;axis<3;axis++)
+    {
+        region.min[axis] = args->regionOfInterest[axis];
+        region.max[axis] = args->regionOfInterest[axis+3];
+    }
+    TileIndex tile_index;
+    bool use_roi = args->hasRegionOfInterest && !args->enableVelocityMotionBlur
+        && tile_index.read(tile_index_filename(bif_filename));
+    if (use_roi)
+    {
+        std::vector<size_t> selected_tiles;
+        tile_index.intersecting_file_space(region,selected_tiles);
+        if (selected_tiles.empty())
+            return true;
+        for (size_t i=0;i<selected_tiles.size();i++)
+        {
+            const TileIndexRecord& record = tile_index.tile(selected_tiles[i]);
+            if (record.component >= roi_tiles.size())
+                roi_tiles.resize(record.component+1);
+            roi_tiles[record.component].insert(TileIndex::tile_key(record.tile,record.depth));
+        }
+    }
+
+    /*!
+     * \remark Iterate through each tile in the bifrost file,
+     *         determine the bounds for that tile (including
+     *         velocity blur growth) and generate a procedural
+     *         for that tile of particle data
+     */
+    BoundsCacheTileContainer tiles;
+    Bifrost::API::StateServer ss;
+    bool loaded = false;
+    if (!sidecar_tile_bounds(bif_filename,*args,fps_1,tiles))
+    {
         Bifrost::API::String biffile = bif_filename;
         Bifrost::API::ObjectModel om;
         Bifrost::API::FileIO fileio = om.createFileIO( biffile );
-        Bifrost::API::StateServer ss = fileio.load( );
+        ss = fileio.load( );
         if ( !ss.valid() ) {
             return false;
         }
-        size_t proceduralIndex = 0;
-        size_t numComponents = ss.components().count();
-        for (size_t componentIndex=0;componentIndex<numComponents;componentIndex++)
+        loaded = true;
+        computed_tile_bounds(ss,*args,fps_1,tiles);
+    }
+    if (args->hasRegionOfInterest && args->enableVelocityMotionBlur)
+    {
+        use_roi = true;
+        for (size_t i=0;i<tiles.size();i++)
         {
-            // printf("ProcInit : 0040\n");
-            Bifrost::API::Component component = ss.components()[componentIndex];
-            Bifrost::API::TypeID componentType = component.type();
-            if (componentType == Bifrost::API::PointComponentType)
-            {
-                // printf("ProcInit : 0050\n");
-                int positionChannelIndex = findChannelIndexViaName(component,"position");
-                int velocityChannelIndex = findChannelIndexViaName(component,"velocity");
-                if (positionChannelIndex>=0)
-                {
-                    // printf("ProcInit : 0060\n");
-                    const Bifrost::API::Channel& position_ch = component.channels()[positionChannelIndex];
-                    const Bifrost::API::Channel& velocity_ch = component.channels()[velocityChannelIndex];
-                    if (position_ch.valid()
-                        &&
-                        (args->enableVelocityMotionBlur?velocity_ch.valid():true) // check conditionally
-                        )
-                    {
-                        // printf("ProcInit : 0070\n");
-                        // iterate over the tile tree at each level
-                        Bifrost::API::Layout layout = component.layout();
-                        size_t depthCount = layout.depthCount();
-                        for ( size_t d=0; d<depthCount; d++ ) {
-                            for ( size_t t=0; t<layout.tileCount(d); t++ ) {
-                                Bifrost::API::TreeIndex tindex(t,d);
-                                if ( !position_ch.elementCount( tindex ) ) {
-                                    // nothing there
-                                    continue;
-                                }
-
-                                if ( position_ch.dataType() == Bifrost::API::FloatV3Type
-                                     &&
-                                     (args->enableVelocityMotionBlur?(velocity_ch.dataType() == Bifrost::API::FloatV3Type):true) // check conditionally
-                                     )
-                                {
-                                    args->createdNodes.push_back(AiNode("points"));
-                                    AtNode *points = args->createdNodes.back();
-                                    const Bifrost::API::TileData<amino::Math::vec3f>& position_tile_data = position_ch.tileData<amino::Math::vec3f>( tindex );
-                                    const Bifrost::API::TileData<amino::Math::vec3f>& velocity_tile_data = velocity_ch.tileData<amino::Math::vec3f>( tindex );
-                                    if (position_tile_data.count() == velocity_tile_data.count())
-                                    {
-                                        std::vector<amino::Math::vec3f> P(position_tile_data.count());
-                                        std::vector<amino::Math::vec3f> PP;
-                                        if (args->enableVelocityMotionBlur)
-                                            PP.resize(position_tile_data.count());
-                                        std::vector<float> radius(position_tile_data.count(),args->pointRadius);
-                                        for (size_t i=0; i<position_tile_data.count(); i++ ) {
-                                            P[i] = position_tile_data[i];
-                                            if (args->enableVelocityMotionBlur)
-                                            {
-                                                PP[i][0] = P[i][0] +  args->velocityScale * fps_1 * velocity_tile_data[i][0];
-                                                PP[i][1] = P[i][1] +  args->velocityScale * fps_1 * velocity_tile_data[i][1];
-                                                PP[i][2] = P[i][2] +  args->velocityScale * fps_1 * velocity_tile_data[i][2];
-                                            }
-                                        }
-                                        if (args->enableVelocityMotionBlur)
-                                        {
-                                            AtArray *vlistArray = 0;
-                                            vlistArray = AiArrayAllocate(P.size(),2,AI_TYPE_POINT);
-                                            
-                                            AiArraySetKey(vlistArray, 0, &(P[0]));
-                                            AiArraySetKey(vlistArray, 1, &(PP[0]));
-                                            AiNodeSetArray(points, "points",vlistArray);
-                                        }
-                                        else
-                                        {
-                                            AiNodeSetArray(points, "points",
-                                                           AiArrayConvert(P.size(),1,AI_TYPE_POINT,&(P[0])));
-                                        }
-                                        AiNodeSetArray(points, "radius",
-                                                       AiArrayConvert(radius.size(),1,AI_TYPE_FLOAT,&(radius[0])));
-                                        AiNodeSetInt(points,"mode",args->pointMode);
-                                        
-                                    }
-                                }
-                                else
-                                {
-                                    AiMsgWarning("Bifrost-procedural : Position channel not of FloatV3Type or velocity channel not of FloatV3Type where velocity motion blur is requested");
-                                }
-                            }
-                        }
-                    }
-                    else
-                    {
-                        AiMsgWarning("Bifrost-procedural : Position channel not found or velocity channel not found where velocity motion blur is requested");
-                    }
-                }
-
-            }
+            const BoundsCacheTile& tile = tiles[i];
+            bool overlaps = true;
+            for (int axis=0;axis<3;axis++)
+                overlaps = overlaps && tile.velocity_bounds.max[axis] >= region.min[axis]
+                                    && tile.velocity_bounds.min[axis] <= region.max[axis];
+            if (!overlaps)
+                continue;
+            if (tile.component >= roi_tiles.size())
+                roi_tiles.resize(tile.component+1);
+            roi_tiles[tile.component].insert(TileIndex::tile_key(tile.tile,tile.depth));
         }
-
     }
-    
-
-    *user_ptr = args;
+    TileClusterContainer clusters;
+    cluster_tiles(tiles,args->enableVelocityMotionBlur,args->clusterSize,use_roi ? &roi_tiles : 0,clusters);
+    size_t proceduralCount = create_tile_procedurals(args,parentProceduralDSO,dataString,clusters);
+    // The children find the file loaded when this level had to load it
+    if (proceduralCount > 0)
+    {
+        ProcFileCache::instance().expect(bif_filename,proceduralCount,loaded ? &ss : 0);
+        args->expectedFilename = bif_filename;
+        args->expectedReaderCount = proceduralCount;
+    }
 
     return true;
 }
 
 int ProcCleanup( void *user_ptr )
 {
-    delete reinterpret_cast<ProcArgs*>( user_ptr );
+    ProcArgs * args = reinterpret_cast<ProcArgs*>( user_ptr );
+    // Children never expanded would otherwise keep the file loaded for the rest of the process
+    if (args->expectedReaderCount > 0)
+        ProcFileCache::instance().abandon(args->expectedFilename,args->expectedReaderCount);
+    delete args;
 
     return true;
 }
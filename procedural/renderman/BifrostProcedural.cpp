@@ -3,6 +3,7 @@
 #include <iostream>
 #include <boost/format.hpp>
 #include <utils/BifrostUtils.h>
+#include <utils/BoundsCache.h>
 
 // Bifrost headers - START
 #include <bifrostapi/bifrost_om.h>
@@ -45,6 +46,10 @@ void EmitGeometry(float radius)
 bool process_bifrost(const BifrostProceduralParameters& bifrost_params, RtFloat detail)
 {
     float fps_1 = 1.0f/bifrost_params.fps;
+    // Frames recorded as empty in the bounds cache sidecar are not loaded
+    BoundsCacheFrame cached_frame;
+    if (find_cached_frame_bounds(bifrost_params.bifrost_filename,cached_frame) && cached_frame.element_count == 0)
+        return true;
     Bifrost::API::String biffile = bifrost_params.bifrost_filename.c_str();
     Bifrost::API::ObjectModel om;
     Bifrost::API::FileIO fileio = om.createFileIO( biffile );
@@ -62,88 +67,96 @@ bool process_bifrost(const BifrostProceduralParameters& bifrost_params, RtFloat
         if (componentType == Bifrost::API::PointComponentType)
         {
             // printf("ProcInit : 0050\n");
-            int positionChannelIndex = findChannelIndexViaName(component,"position");
-            int velocityChannelIndex = findChannelIndexViaName(component,"velocity");
+            ChannelIndex channel_index(component);
+            int positionChannelIndex = channel_index.find("position");
+            int velocityChannelIndex = channel_index.find("velocity");
             if (positionChannelIndex>=0)
             {
                 // printf("ProcInit : 0060\n");
-                const Bifrost::API::Channel& position_ch = component.channels()[positionChannelIndex];
-                const Bifrost::API::Channel& velocity_ch = component.channels()[velocityChannelIndex];
+                const Bifrost::API::Channel& position_ch = channel_index.channel(positionChannelIndex);
+                // A missing velocity channel is left invalid and fails the motion blur check below
+                const Bifrost::API::Channel velocity_ch = velocityChannelIndex>=0 ? channel_index.channel(velocityChannelIndex) : Bifrost::API::Channel();
                 if (position_ch.valid()
                     &&
                     (bifrost_params.enableVelocityMotionBlur?velocity_ch.valid():true) // check conditionally
                     )
                 {
                     // printf("ProcInit : 0070\n");
-                    // iterate over the tile tree at each level
-                    Bifrost::API::Layout layout = component.layout();
-                    size_t depthCount = layout.depthCount();
-                    for ( size_t d=0; d<depthCount; d++ ) {
-                        for ( size_t t=0; t<layout.tileCount(d); t++ ) {
-                            Bifrost::API::TreeIndex tindex(t,d);
-                            if ( !position_ch.elementCount( tindex ) ) {
-                                // nothing there
-                                continue;
+                    if ( position_ch.dataType() == Bifrost::API::FloatV3Type
+                         &&
+                         (bifrost_params.enableVelocityMotionBlur?(velocity_ch.dataType() == Bifrost::API::FloatV3Type):true) // check conditionally
+                         )
+                    {
+                        /*!
+                         * \remark Tile data is gathered across all cores,
+                         *         the Ri calls are then issued serially
+                         *         in tile order
+                         */
+                        struct TilePoints {
+                            std::vector<amino::Math::vec3f> P;
+                            std::vector<amino::Math::vec3f> PP;
+                        };
+                        TileTraversal traversal(component.layout(),position_ch);
+                        std::vector<TilePoints> tile_points(traversal.tileCount());
+                        traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+                            const Bifrost::API::TileData<amino::Math::vec3f>& position_tile_data = position_ch.tileData<amino::Math::vec3f>( tile.index );
+                            if (bifrost_params.enableVelocityMotionBlur)
+                            {
+                                const Bifrost::API::TileData<amino::Math::vec3f>& velocity_tile_data = velocity_ch.tileData<amino::Math::vec3f>( tile.index );
+                                if (position_tile_data.count() != velocity_tile_data.count())
+                                    return;
+                                std::vector<amino::Math::vec3f>& PP = tile_points[tile.ordinal].PP;
+                                PP.resize(position_tile_data.count());
+                                for (size_t i=0; i<position_tile_data.count(); i++ ) {
+                                    PP[i][0] = position_tile_data[i][0] +  bifrost_params.velocityScale * fps_1 * velocity_tile_data[i][0];
+                                    PP[i][1] = position_tile_data[i][1] +  bifrost_params.velocityScale * fps_1 * velocity_tile_data[i][1];
+                                    PP[i][2] = position_tile_data[i][2] +  bifrost_params.velocityScale * fps_1 * velocity_tile_data[i][2];
+                                }
+                            }
+                            std::vector<amino::Math::vec3f>& P = tile_points[tile.ordinal].P;
+                            P.resize(position_tile_data.count());
+                            for (size_t i=0; i<position_tile_data.count(); i++ ) {
+                                P[i] = position_tile_data[i];
                             }
+                        });
 
-                            if ( position_ch.dataType() == Bifrost::API::FloatV3Type
-                                 &&
-                                 (bifrost_params.enableVelocityMotionBlur?(velocity_ch.dataType() == Bifrost::API::FloatV3Type):true) // check conditionally
-                                 )
+                        for (size_t tileOrdinal=0; tileOrdinal<tile_points.size(); tileOrdinal++)
+                        {
+                            std::vector<amino::Math::vec3f>& P = tile_points[tileOrdinal].P;
+                            std::vector<amino::Math::vec3f>& PP = tile_points[tileOrdinal].PP;
+                            if (P.empty())
+                                continue;
+                            if (bifrost_params.enableVelocityMotionBlur)
                             {
-//                                args->createdNodes.push_back(AiNode("points"));
-//                                AtNode *points = args->createdNodes.back();
-                                const Bifrost::API::TileData<amino::Math::vec3f>& position_tile_data = position_ch.tileData<amino::Math::vec3f>( tindex );
-                                const Bifrost::API::TileData<amino::Math::vec3f>& velocity_tile_data = velocity_ch.tileData<amino::Math::vec3f>( tindex );
-                                if (position_tile_data.count() == velocity_tile_data.count())
-                                {
-                                    std::vector<amino::Math::vec3f> P(position_tile_data.count());
-                                    std::vector<amino::Math::vec3f> PP;
-                                    if (bifrost_params.enableVelocityMotionBlur)
-                                        PP.resize(position_tile_data.count());
-                                    std::vector<float> radius(position_tile_data.count(),bifrost_params.pointRadius);
-                                    for (size_t i=0; i<position_tile_data.count(); i++ ) {
-                                        P[i] = position_tile_data[i];
-                                        if (bifrost_params.enableVelocityMotionBlur)
-                                        {
-                                            PP[i][0] = P[i][0] +  bifrost_params.velocityScale * fps_1 * velocity_tile_data[i][0];
-                                            PP[i][1] = P[i][1] +  bifrost_params.velocityScale * fps_1 * velocity_tile_data[i][1];
-                                            PP[i][2] = P[i][2] +  bifrost_params.velocityScale * fps_1 * velocity_tile_data[i][2];
-                                        }
-                                    }
-                                    if (bifrost_params.enableVelocityMotionBlur)
-                                    {
-                                        // args->pointMode
-                                        RtString point_type("disk");
-                                        RtFloat mbTime[2] = {-0.2f,0.2f};
-                                        RiMotionBeginV(2,mbTime);
-                                        RtFloat width = 2.0f * bifrost_params.pointRadius;
-                                        RiPoints(P.size(),RI_P,&(P[0]),RI_CONSTANTWIDTH,&width,
-                                                "uniform string type",&point_type,
-                                                RI_NULL);
-                                        RiPoints(PP.size(),RI_P,&(PP[0]),RI_CONSTANTWIDTH,&width,
-                                                "uniform string type",&point_type,
-                                                RI_NULL);
-                                        RiMotionEnd();
-                                    }
-                                    else
-                                    {
-                                        // args->pointMode
-                                        RtFloat width = 2.0f * bifrost_params.pointRadius;
-                                        RtString point_type("blobby");
-                                        RiPoints(P.size(),RI_P,&(P[0]),RI_CONSTANTWIDTH,&(width),
-                                                // "uniform string type",&point_type,
-                                                RI_NULL);
-                                    }
-                                }
+                                // args->pointMode
+                                RtString point_type("disk");
+                                RtFloat mbTime[2] = {-0.2f,0.2f};
+                                RiMotionBeginV(2,mbTime);
+                                RtFloat width = 2.0f * bifrost_params.pointRadius;
+                                RiPoints(P.size(),RI_P,&(P[0]),RI_CONSTANTWIDTH,&width,
+                                        "uniform string type",&point_type,
+                                        RI_NULL);
+                                RiPoints(PP.size(),RI_P,&(PP[0]),RI_CONSTANTWIDTH,&width,
+                                        "uniform string type",&point_type,
+                                        RI_NULL);
+                                RiMotionEnd();
                             }
                             else
                             {
-                                ;
-//                                AiMsgWarning("Bifrost-procedural : Position channel not of FloatV3Type or velocity channel not of FloatV3Type where velocity motion blur is requested");
+                                // args->pointMode
+                                RtFloat width = 2.0f * bifrost_params.pointRadius;
+                                RtString point_type("blobby");
+                                RiPoints(P.size(),RI_P,&(P[0]),RI_CONSTANTWIDTH,&(width),
+                                        // "uniform string type",&point_type,
+                                        RI_NULL);
                             }
                         }
                     }
+                    else
+                    {
+                        ;
+//                        AiMsgWarning("Bifrost-procedural : Position channel not of FloatV3Type or velocity channel not of FloatV3Type where velocity motion blur is requested");
+                    }
                 }
                 else
                 {
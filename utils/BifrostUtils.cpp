@@ -1,47 +1,274 @@
 #include "BifrostUtils.h"
 #include <boost/format.hpp>
+#include <tbb/atomic.h>
+#include <string.h>
+#include <stdint.h>
 
-int findChannelIndexViaName(const Bifrost::API::Component& component,
-                            const Bifrost::API::String& searchChannelName)
+ChannelIndex::ChannelIndex(const Bifrost::API::Component& component)
 {
     Bifrost::API::RefArray channels = component.channels();
-    size_t particleCount = component.elementCount();
     size_t channelCount = channels.count();
+    _channels.reserve(channelCount);
+    _names.reserve(channelCount);
     for (size_t channelIndex=0;channelIndex<channelCount;channelIndex++)
     {
         const Bifrost::API::Channel& ch = channels[channelIndex];
-        Bifrost::API::String channelName = ch.name();
-        if (channelName.find(searchChannelName) != Bifrost::API::String::npos)
-        {
-            return channelIndex;
-        }
+        std::string channelName(ch.name().c_str());
+        _channels.push_back(ch);
+        _names.push_back(channelName);
+        // First occurrence wins, as with the legacy linear search
+        _exact.insert(NameToPositionMap::value_type(channelName,int(channelIndex)));
+        size_t separator = channelName.rfind('/');
+        if (separator != std::string::npos)
+            _suffix.insert(NameToPositionMap::value_type(channelName.substr(separator+1),int(channelIndex)));
+    }
+}
+
+int ChannelIndex::find(const std::string& name) const
+{
+    NameToPositionMap::const_iterator iter = _exact.find(name);
+    if (iter != _exact.end())
+        return iter->second;
+    iter = _suffix.find(name);
+    if (iter != _suffix.end())
+        return iter->second;
+    for (size_t channelIndex=0;channelIndex<_names.size();channelIndex++)
+    {
+        if (_names[channelIndex].find(name) != std::string::npos)
+            return int(channelIndex);
     }
     return -1;
 }
 
+int findChannelIndexViaName(const Bifrost::API::Component& component,
+                            const Bifrost::API::String& searchChannelName)
+{
+    return ChannelIndex(component).find(searchChannelName.c_str());
+}
+
 void
-get_channel(const Bifrost::API::Component& i_component,
+get_channel(const ChannelIndex& i_channel_index,
 			const std::string& i_channel_name,
 			const Bifrost::API::DataType& i_expected_type,
 			Bifrost::API::Channel& o_channel,
 			bool& o_status)
 {
-    int channelIndex = findChannelIndexViaName(i_component,i_channel_name.c_str());
+    o_status = false;
+    int channelIndex = i_channel_index.find(i_channel_name);
     if (channelIndex<0)
     {
         std::cerr << boost::format("get_channel() : channel '%1%' not found") % i_channel_name << std::endl;
-        o_status = false;
+        return;
     }
-    o_channel = i_component.channels()[channelIndex];
-    if (!o_channel.valid())
+    const Bifrost::API::Channel& channel = i_channel_index.channel(channelIndex);
+    if (!channel.valid())
     {
         std::cerr << boost::format("get_channel() : channel '%1%' not valid") % i_channel_name << std::endl;
-        o_status = false;
+        return;
     }
-    if ( o_channel.dataType() != i_expected_type)
+    if ( channel.dataType() != i_expected_type)
     {
-        std::cerr << boost::format("get_channel() : channel '%1%' of type %2% is different from expected type %3%") % i_channel_name % o_channel.dataType() % i_expected_type << std::endl;
-        o_status = false;
+        std::cerr << boost::format("get_channel() : channel '%1%' of type %2% is different from expected type %3%") % i_channel_name % channel.dataType() % i_expected_type << std::endl;
+        return;
     }
+    o_channel = channel;
     o_status = true;
 }
+
+void
+get_channel(const Bifrost::API::Component& i_component,
+			const std::string& i_channel_name,
+			const Bifrost::API::DataType& i_expected_type,
+			Bifrost::API::Channel& o_channel,
+			bool& o_status)
+{
+    get_channel(ChannelIndex(i_component),i_channel_name,i_expected_type,o_channel,o_status);
+}
+
+const char* data_type_name(Bifrost::API::DataType i_data_type)
+{
+    switch (i_data_type)
+    {
+    case Bifrost::API::FloatType:   return "Float";
+    case Bifrost::API::FloatV2Type: return "FloatV2";
+    case Bifrost::API::FloatV3Type: return "FloatV3";
+    case Bifrost::API::Int32Type:   return "Int32";
+    case Bifrost::API::Int64Type:   return "Int64";
+    case Bifrost::API::UInt32Type:  return "UInt32";
+    case Bifrost::API::UInt64Type:  return "UInt64";
+    case Bifrost::API::Int32V2Type: return "Int32V2";
+    case Bifrost::API::Int32V3Type: return "Int32V3";
+#if BIFROST_VERSION >= 20
+    case Bifrost::API::FloatV4Type:          return "FloatV4";
+    case Bifrost::API::FloatMat44Type:       return "FloatMat44";
+    case Bifrost::API::Int8Type:             return "Int8";
+    case Bifrost::API::Int16Type:            return "Int16";
+    case Bifrost::API::UInt8Type:            return "UInt8";
+    case Bifrost::API::UInt16Type:           return "UInt16";
+    case Bifrost::API::BoolType:             return "Bool";
+    case Bifrost::API::StringClassType:      return "StringClass";
+    case Bifrost::API::DictionaryClassType:  return "DictionaryClass";
+    case Bifrost::API::UInt64V2Type:         return "UInt64V2";
+    case Bifrost::API::UInt64V3Type:         return "UInt64V3";
+    case Bifrost::API::UInt64V4Type:         return "UInt64V4";
+    case Bifrost::API::StringArrayClassType: return "StringArrayClass";
+#endif // BIFROST_VERSION >= 20
+    default:                        return "None";
+    }
+}
+
+size_t data_type_size(Bifrost::API::DataType i_data_type)
+{
+    switch (i_data_type)
+    {
+    case Bifrost::API::FloatType:   return sizeof(float);
+    case Bifrost::API::FloatV2Type: return 2*sizeof(float);
+    case Bifrost::API::FloatV3Type: return 3*sizeof(float);
+    case Bifrost::API::Int32Type:   return sizeof(int32_t);
+    case Bifrost::API::Int64Type:   return sizeof(int64_t);
+    case Bifrost::API::UInt32Type:  return sizeof(uint32_t);
+    case Bifrost::API::UInt64Type:  return sizeof(uint64_t);
+    case Bifrost::API::Int32V2Type: return 2*sizeof(int32_t);
+    case Bifrost::API::Int32V3Type: return 3*sizeof(int32_t);
+    default:                        return 0;
+    }
+}
+
+size_t estimate_payload_bytes(Bifrost::API::FileIO& i_fileio)
+{
+    const Bifrost::API::BIF::FileInfo& info = i_fileio.info();
+    size_t payload = 0;
+    for (size_t channelIndex=0;channelIndex<info.channelCount;channelIndex++)
+    {
+        const Bifrost::API::BIF::FileInfo::ChannelInfo& channelInfo = i_fileio.channelInfo(channelIndex);
+        payload += size_t(channelInfo.elementCount) * data_type_size(channelInfo.dataType);
+    }
+    return payload;
+}
+
+template<typename ElementCounter>
+void TileTraversal::enumerate(const Bifrost::API::Layout& layout,
+                              const ElementCounter& counter)
+{
+    _elementCount = 0;
+    size_t depthCount = layout.depthCount();
+    for ( size_t d=0; d<depthCount; d++ ) {
+        size_t tcount = layout.tileCount(d);
+        for ( size_t t=0; t<tcount; t++ ) {
+            Bifrost::API::TreeIndex tindex(t,d);
+            size_t elementCount = counter(tindex);
+            if ( !elementCount ) {
+                // nothing there
+                continue;
+            }
+            _tiles.push_back(Tile(t,d,_tiles.size(),elementCount,_elementCount));
+            _elementCount += elementCount;
+        }
+    }
+}
+
+TileTraversal::TileTraversal(const Bifrost::API::Component& component)
+: _elementCount(0)
+{
+    enumerate(component.layout(),
+              [&](const Bifrost::API::TreeIndex& tindex) { return component.elementCount( tindex ); });
+}
+
+TileTraversal::TileTraversal(const Bifrost::API::Layout& layout,
+                             const Bifrost::API::Channel& channel)
+: _elementCount(0)
+{
+    enumerate(layout,
+              [&](const Bifrost::API::TreeIndex& tindex) { return channel.elementCount( tindex ); });
+}
+
+bool gather_channel(const TileTraversal& traversal,
+                    const Bifrost::API::Channel& channel,
+                    void* o_data,
+                    size_t capacity)
+{
+    if (capacity < traversal.elementCount())
+    {
+        std::cerr << boost::format("gather_channel() : channel '%1%' needs %2% elements, buffer holds %3%")
+            % channel.name().c_str() % traversal.elementCount() % capacity << std::endl;
+        return false;
+    }
+    const size_t stride = channel.stride();
+    unsigned char* o_bytes = static_cast<unsigned char*>(o_data);
+    tbb::atomic<size_t> failed_tile_count;
+    failed_tile_count = 0;
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        size_t bufferSize = 0;
+        const void* tile_data = channel.tileDataPtr( tile.index, bufferSize );
+        if (!tile_data || channel.elementCount( tile.index ) != tile.elementCount)
+        {
+            failed_tile_count++;
+            return;
+        }
+        memcpy(o_bytes + tile.elementOffset * stride, tile_data, tile.elementCount * stride);
+    });
+    if (failed_tile_count > 0)
+    {
+        std::cerr << boost::format("gather_channel() : channel '%1%' could not be gathered from %2% tiles")
+            % channel.name().c_str() % failed_tile_count << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool gather_channels(const Bifrost::API::Component& component,
+                     const ChannelGatherTargetContainer& targets)
+{
+    return gather_channels(component,TileTraversal(component),targets);
+}
+
+bool gather_channels(const Bifrost::API::Component& component,
+                     const TileTraversal& traversal,
+                     const ChannelGatherTargetContainer& targets)
+{
+    struct ResolvedTarget {
+        Bifrost::API::Channel channel;
+        unsigned char* data;
+        size_t stride;
+    };
+    ChannelIndex channel_index(component);
+    std::vector<ResolvedTarget> resolved(targets.size());
+    for (size_t i=0;i<targets.size();i++)
+    {
+        bool channel_status = false;
+        get_channel(channel_index,targets[i].name,targets[i].expectedType,resolved[i].channel,channel_status);
+        if (!channel_status)
+            return false;
+        if (targets[i].capacity < traversal.elementCount())
+        {
+            std::cerr << boost::format("gather_channels() : channel '%1%' needs %2% elements, buffer holds %3%")
+                % targets[i].name % traversal.elementCount() % targets[i].capacity << std::endl;
+            return false;
+        }
+        resolved[i].data = static_cast<unsigned char*>(targets[i].data);
+        resolved[i].stride = resolved[i].channel.stride();
+    }
+
+    tbb::atomic<size_t> failed_tile_count;
+    failed_tile_count = 0;
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        for (size_t i=0;i<resolved.size();i++)
+        {
+            const ResolvedTarget& target = resolved[i];
+            size_t bufferSize = 0;
+            const void* tile_data = target.channel.tileDataPtr( tile.index, bufferSize );
+            if (!tile_data || target.channel.elementCount( tile.index ) != tile.elementCount)
+            {
+                failed_tile_count++;
+                continue;
+            }
+            memcpy(target.data + tile.elementOffset * target.stride, tile_data, tile.elementCount * target.stride);
+        }
+    });
+    if (failed_tile_count > 0)
+    {
+        std::cerr << boost::format("gather_channels() : %1% channel tiles could not be gathered") % failed_tile_count << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -1,13 +1,227 @@
 #pragma once
 
 #include <BifrostHeaders.h>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+/*!
+ * \brief Name lookup of the channels of a component, built once and
+ *        shared by all the lookups made on that component
+ * \note Lookup order is the exact channel name, then the part of the
+ *       name after the last '/' (e.g. "position" for "Liquid-particle/position"),
+ *       then the legacy first substring match
+ */
+class ChannelIndex
+{
+public:
+    explicit ChannelIndex(const Bifrost::API::Component& component);
+
+    /*! \return The position of the channel, -1 if not found */
+    int find(const std::string& name) const;
+    size_t count() const { return _channels.size(); }
+    const Bifrost::API::Channel& channel(size_t position) const { return _channels[position]; }
+    const std::string& name(size_t position) const { return _names[position]; }
+
+private:
+    typedef std::unordered_map<std::string,int> NameToPositionMap;
+    std::vector<Bifrost::API::Channel> _channels;
+    std::vector<std::string>           _names;
+    NameToPositionMap                  _exact;
+    NameToPositionMap                  _suffix;
+};
 
 int findChannelIndexViaName(const Bifrost::API::Component& component,
                             const Bifrost::API::String& searchChannelName);
 
+/*!
+ * \brief Looks up a channel and checks its type
+ * \note o_status is false, and o_channel left untouched, if the channel
+ *       is missing, invalid or not of the expected type
+ */
+void
+get_channel(const ChannelIndex& i_channel_index,
+			const std::string& i_channel_name,
+			const Bifrost::API::DataType& i_expected_type,
+			Bifrost::API::Channel& o_channel,
+			bool& o_status);
+
 void
 get_channel(const Bifrost::API::Component& i_component,
 			const std::string& i_channel_name,
 			const Bifrost::API::DataType& i_expected_type,
 			Bifrost::API::Channel& channel,
 			bool& o_status);
+
+/*! \brief Name of the data type without the "Type" suffix, e.g. "FloatV3" */
+const char* data_type_name(Bifrost::API::DataType i_data_type);
+
+/*! \brief Size in bytes of one element of the given type, 0 for NoneType */
+size_t data_type_size(Bifrost::API::DataType i_data_type);
+
+/*!
+ * \brief Estimate of the in-memory size of a Bifrost file's channel data,
+ *        from the file header only (no tile is loaded)
+ */
+size_t estimate_payload_bytes(Bifrost::API::FileIO& i_fileio);
+
+/*!
+ * \brief Flattened list of the non-empty tiles of a layout, enumerated once
+ *        in depth/tile order, with the prefix sum of their element counts
+ * \note Each tile's elementOffset is where its elements start in a
+ *       contiguous output array, so kernels run in parallel still produce
+ *       the same output order as the serial depth/tile walk
+ */
+class TileTraversal
+{
+public:
+    struct Tile
+    {
+        Tile(Bifrost::API::TreeIndex::Tile t,
+             Bifrost::API::TreeIndex::Depth d,
+             size_t i_ordinal,
+             size_t i_elementCount,
+             size_t i_elementOffset)
+        : index(t,d)
+        , ordinal(i_ordinal)
+        , elementCount(i_elementCount)
+        , elementOffset(i_elementOffset)
+        {}
+        Bifrost::API::TreeIndex index;
+        size_t ordinal;       /*!< position of this tile in the traversal */
+        size_t elementCount;
+        size_t elementOffset; /*!< sum of the element counts of all previous tiles */
+    };
+    typedef std::vector<Tile> TileContainer;
+
+    /*! \brief Traverse the tiles holding elements of the component */
+    explicit TileTraversal(const Bifrost::API::Component& component);
+    /*! \brief Traverse the tiles holding elements of a specific channel */
+    TileTraversal(const Bifrost::API::Layout& layout,
+                  const Bifrost::API::Channel& channel);
+
+    size_t tileCount() const { return _tiles.size(); }
+    size_t elementCount() const { return _elementCount; }
+    const TileContainer& tiles() const { return _tiles; }
+    const Tile& tile(size_t ordinal) const { return _tiles[ordinal]; }
+
+    /*!
+     * \brief Traversal of the tiles for which predicate(tile) is true, in the
+     *        same order, with the ordinals and element offsets recomputed
+     */
+    template<typename Predicate>
+    TileTraversal select(const Predicate& predicate) const
+    {
+        TileTraversal result;
+        for (size_t i=0;i<_tiles.size();i++)
+        {
+            const Tile& tile = _tiles[i];
+            if (!predicate(tile))
+                continue;
+            result._tiles.push_back(Tile(tile.index.tile,tile.index.depth,result._tiles.size(),tile.elementCount,result._elementCount));
+            result._elementCount += tile.elementCount;
+        }
+        return result;
+    }
+
+    /*! \brief Runs kernel(tile) on each tile in traversal order */
+    template<typename Kernel>
+    void serial_for_each(const Kernel& kernel) const
+    {
+        for (size_t i=0;i<_tiles.size();i++)
+            kernel(_tiles[i]);
+    }
+
+    /*!
+     * \brief Runs kernel(tile) on the tiles across all cores
+     * \note The kernel is called concurrently, it must only write to the
+     *       output range [elementOffset,elementOffset+elementCount) or to
+     *       per-tile storage indexed by ordinal
+     */
+    template<typename Kernel>
+    void parallel_for_each(const Kernel& kernel) const
+    {
+        const TileContainer& tiles = _tiles;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0,tiles.size()),
+                          [&](const tbb::blocked_range<size_t>& range) {
+                              for (size_t i=range.begin();i!=range.end();i++)
+                                  kernel(tiles[i]);
+                          });
+    }
+
+private:
+    TileTraversal() : _elementCount(0) {}
+
+    template<typename ElementCounter>
+    void enumerate(const Bifrost::API::Layout& layout,
+                   const ElementCounter& counter);
+
+    TileContainer _tiles;
+    size_t        _elementCount;
+};
+
+/*!
+ * \brief Caller-provided destination of one channel for gather_channels()
+ * \note data must hold at least capacity elements of the channel's stride
+ */
+struct ChannelGatherTarget
+{
+    ChannelGatherTarget(const std::string& i_name,
+                        Bifrost::API::DataType i_expected_type,
+                        void* i_data,
+                        size_t i_capacity)
+    : name(i_name)
+    , expectedType(i_expected_type)
+    , data(i_data)
+    , capacity(i_capacity)
+    {}
+    std::string            name;
+    Bifrost::API::DataType expectedType;
+    void*                  data;
+    size_t                 capacity; /*!< in elements */
+};
+typedef std::vector<ChannelGatherTarget> ChannelGatherTargetContainer;
+
+/*!
+ * \brief Copies a channel's tiles into a contiguous buffer, one memcpy per
+ *        tile from Channel::tileDataPtr, tiles copied in parallel
+ * \param o_data Buffer of at least traversal.elementCount() * channel.stride() bytes
+ * \return false if the buffer is too small or a tile cannot be accessed
+ */
+bool gather_channel(const TileTraversal& traversal,
+                    const Bifrost::API::Channel& channel,
+                    void* o_data,
+                    size_t capacity);
+
+/*!
+ * \brief Convenience overload sizing the output vector once from the traversal
+ * \note T must have the same size as the channel's stride
+ */
+template<typename T>
+bool gather_channel(const TileTraversal& traversal,
+                    const Bifrost::API::Channel& channel,
+                    std::vector<T>& o_data)
+{
+    if (sizeof(T) != channel.stride())
+        return false;
+    o_data.resize(traversal.elementCount());
+    if (o_data.empty())
+        return true;
+    return gather_channel(traversal,channel,&o_data[0],o_data.size());
+}
+
+/*!
+ * \brief Structure-of-arrays gather of several channels of a point
+ *        component in a single parallel pass over its tiles
+ * \note Every target must be able to hold component.elementCount() elements
+ * \return false if a channel is missing, of the wrong type or a target is too small
+ */
+bool gather_channels(const Bifrost::API::Component& component,
+                     const ChannelGatherTargetContainer& targets);
+
+/*! \brief Same as above, reusing an existing traversal of the component */
+bool gather_channels(const Bifrost::API::Component& component,
+                     const TileTraversal& traversal,
+                     const ChannelGatherTargetContainer& targets);
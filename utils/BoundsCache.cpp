@@ -0,0 +1,304 @@
+#include "BoundsCache.h"
+#include "BifrostUtils.h"
+#include "PointKernels.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+
+namespace {
+
+const char     BOUNDS_CACHE_MAGIC[4] = { 'B', 'I', 'F', 'B' };
+const uint32_t BOUNDS_CACHE_VERSION  = 2;
+
+bool frame_less(const BoundsCacheFrame& a, const BoundsCacheFrame& b)
+{
+    return a.frame < b.frame;
+}
+
+/*!
+ * \brief Field by field copy into a record zeroed by the caller, a struct
+ *        copy would carry the padding after BoundsCacheFrame::frame over
+ */
+void copy_frame_fields(const BoundsCacheFrame& frame, BoundsCacheFrame& o_record)
+{
+    o_record.frame = frame.frame;
+    o_record.element_count = frame.element_count;
+    o_record.tile_offset = frame.tile_offset;
+    o_record.tile_count = frame.tile_count;
+    o_record.bounds = frame.bounds;
+    o_record.velocity_bounds = frame.velocity_bounds;
+    o_record.world_bounds = frame.world_bounds;
+}
+
+/*! \brief Position of the frame token in a filename, the digits (or pattern) before the extension */
+bool find_frame_number(const std::string& bifrost_filename, size_t& o_begin, size_t& o_end)
+{
+    size_t slash = bifrost_filename.find_last_of("/\\");
+    size_t basename = slash == std::string::npos ? 0 : slash+1;
+    size_t extension = bifrost_filename.find_last_of('.');
+    if (extension == std::string::npos || extension < basename)
+        extension = bifrost_filename.size();
+    size_t begin = extension;
+    while (begin>basename && isdigit(static_cast<unsigned char>(bifrost_filename[begin-1])))
+        begin--;
+    if (begin == extension)
+    {
+        // Frame pattern, "%04d" or "####"
+        while (begin>basename && bifrost_filename[begin-1]=='#')
+            begin--;
+        if (begin == extension)
+        {
+            size_t percent = bifrost_filename.find_last_of('%',extension);
+            if (percent == std::string::npos || percent < basename || bifrost_filename[extension-1]!='d')
+                return false;
+            begin = percent;
+        }
+    }
+    o_begin = begin;
+    o_end = extension;
+    return true;
+}
+
+} // anonymous namespace
+
+void BoundsCacheBox::clear()
+{
+    init_bounds(min,max);
+}
+
+void BoundsCacheBox::extend(const BoundsCacheBox& other)
+{
+    for (int axis=0;axis<3;axis++)
+    {
+        min[axis] = std::min(min[axis],other.min[axis]);
+        max[axis] = std::max(max[axis],other.max[axis]);
+    }
+}
+
+BoundsCache::BoundsCache()
+: _valid(false)
+, _fps(24.0f)
+{
+}
+
+bool BoundsCache::open(const std::string& filename)
+{
+    _filename = filename;
+    _valid = false;
+    _frames.clear();
+    FILE* file = fopen(filename.c_str(),"rb");
+    if (!file)
+        return false;
+    BoundsCacheHeader header;
+    bool status = fread(&header,sizeof(header),1,file)==1
+        && memcmp(header.magic,BOUNDS_CACHE_MAGIC,sizeof(header.magic))==0
+        && header.version==BOUNDS_CACHE_VERSION;
+    if (status)
+    {
+        _frames.resize(header.frame_count);
+        status = header.frame_count==0
+            || fread(&_frames[0],sizeof(BoundsCacheFrame),header.frame_count,file)==header.frame_count;
+    }
+    fclose(file);
+    if (!status)
+    {
+        _frames.clear();
+        return false;
+    }
+    _fps = header.fps;
+    _valid = true;
+    return true;
+}
+
+const BoundsCacheFrame* BoundsCache::find_frame(int frame) const
+{
+    BoundsCacheFrame key;
+    key.frame = frame;
+    BoundsCacheFrameContainer::const_iterator iter = std::lower_bound(_frames.begin(),_frames.end(),key,frame_less);
+    if (iter == _frames.end() || iter->frame != frame)
+        return 0;
+    return &(*iter);
+}
+
+bool BoundsCache::read_tiles(const BoundsCacheFrame& frame,
+                             BoundsCacheTileContainer& o_tiles) const
+{
+    o_tiles.resize(frame.tile_count);
+    if (frame.tile_count==0)
+        return true;
+    FILE* file = fopen(_filename.c_str(),"rb");
+    if (!file)
+        return false;
+    bool status = fseek(file,long(frame.tile_offset),SEEK_SET)==0
+        && fread(&o_tiles[0],sizeof(BoundsCacheTile),frame.tile_count,file)==frame.tile_count;
+    fclose(file);
+    if (!status)
+        o_tiles.clear();
+    return status;
+}
+
+BoundsCacheWriter::BoundsCacheWriter(float fps)
+: _fps(fps)
+{
+}
+
+void BoundsCacheWriter::add_frame(const BoundsCacheFrame& frame,
+                                  const BoundsCacheTileContainer& tiles)
+{
+    _frames.push_back(frame);
+    _frames.back().tile_count = tiles.size();
+    _tiles.push_back(tiles);
+}
+
+bool BoundsCacheWriter::write(const std::string& filename) const
+{
+    // Frames are sorted for the binary search in BoundsCache::find_frame()
+    std::vector<size_t> order(_frames.size());
+    for (size_t i=0;i<order.size();i++)
+        order[i] = i;
+    std::sort(order.begin(),order.end(),
+              [&](size_t a, size_t b) { return frame_less(_frames[a],_frames[b]); });
+
+    BoundsCacheHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,BOUNDS_CACHE_MAGIC,sizeof(header.magic));
+    header.version = BOUNDS_CACHE_VERSION;
+    header.frame_count = uint32_t(_frames.size());
+    header.fps = _fps;
+
+    // Zeroed so no uninitialised padding bytes end up in the file
+    BoundsCacheFrameContainer frames(_frames.size());
+    if (!frames.empty())
+        memset(static_cast<void*>(&frames[0]),0,frames.size()*sizeof(BoundsCacheFrame));
+    uint64_t tile_offset = sizeof(BoundsCacheHeader) + frames.size()*sizeof(BoundsCacheFrame);
+    for (size_t i=0;i<order.size();i++)
+    {
+        copy_frame_fields(_frames[order[i]],frames[i]);
+        frames[i].tile_offset = tile_offset;
+        tile_offset += frames[i].tile_count*sizeof(BoundsCacheTile);
+    }
+
+    FILE* file = fopen(filename.c_str(),"wb");
+    if (!file)
+        return false;
+    bool status = fwrite(&header,sizeof(header),1,file)==1
+        && (frames.empty() || fwrite(&frames[0],sizeof(BoundsCacheFrame),frames.size(),file)==frames.size());
+    for (size_t i=0;status && i<order.size();i++)
+    {
+        const BoundsCacheTileContainer& tiles = _tiles[order[i]];
+        status = tiles.empty() || fwrite(&tiles[0],sizeof(BoundsCacheTile),tiles.size(),file)==tiles.size();
+    }
+    return fclose(file)==0 && status;
+}
+
+std::string bounds_cache_filename(const std::string& bifrost_filename)
+{
+    size_t begin, end;
+    std::string result(bifrost_filename);
+    if (find_frame_number(bifrost_filename,begin,end))
+    {
+        // Also drop the separator before the frame number, "liquid.0012" -> "liquid"
+        if (begin>0 && (result[begin-1]=='.' || result[begin-1]=='_'))
+            begin--;
+        result.erase(begin);
+    }
+    else
+    {
+        size_t extension = result.find_last_of('.');
+        size_t slash = result.find_last_of("/\\");
+        if (extension != std::string::npos && (slash == std::string::npos || extension > slash))
+            result.erase(extension);
+    }
+    return result + ".bounds";
+}
+
+bool frame_from_filename(const std::string& bifrost_filename, int& o_frame)
+{
+    size_t begin, end;
+    if (!find_frame_number(bifrost_filename,begin,end) || !isdigit(static_cast<unsigned char>(bifrost_filename[begin])))
+        return false;
+    o_frame = atoi(bifrost_filename.substr(begin,end-begin).c_str());
+    return true;
+}
+
+bool find_cached_frame_bounds(const std::string& bifrost_filename,
+                              BoundsCacheFrame& o_frame)
+{
+    int frame = 0;
+    if (!frame_from_filename(bifrost_filename,frame))
+        return false;
+    BoundsCache bounds_cache;
+    if (!bounds_cache.open(bounds_cache_filename(bifrost_filename)))
+        return false;
+    const BoundsCacheFrame* cached_frame = bounds_cache.find_frame(frame);
+    if (!cached_frame)
+        return false;
+    o_frame = *cached_frame;
+    return true;
+}
+
+bool compute_point_bounds(const Bifrost::API::Component& component,
+                          uint32_t component_index,
+                          const std::string& position_channel_name,
+                          const std::string& velocity_channel_name,
+                          float fps,
+                          BoundsCacheFrame& io_frame,
+                          BoundsCacheTileContainer& io_tiles)
+{
+    ChannelIndex channel_index(component);
+    Bifrost::API::Channel position_ch;
+    bool position_status = false;
+    get_channel(channel_index,position_channel_name,Bifrost::API::FloatV3Type,position_ch,position_status);
+    if (!position_status)
+        return false;
+    Bifrost::API::Channel velocity_ch;
+    bool velocity_status = false;
+    get_channel(channel_index,velocity_channel_name,Bifrost::API::FloatV3Type,velocity_ch,velocity_status);
+
+    Bifrost::API::Layout layout = component.layout();
+    const float voxel_scale = layout.voxelScale();
+    float fps_1 = 1.0f/fps;
+    TileTraversal traversal(layout,position_ch);
+    size_t first_tile = io_tiles.size();
+    io_tiles.resize(first_tile+traversal.tileCount());
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        BoundsCacheTile& tile_bounds = io_tiles[first_tile+tile.ordinal];
+        tile_bounds.component = component_index;
+        tile_bounds.tile = uint32_t(tile.index.tile);
+        tile_bounds.depth = uint32_t(tile.index.depth);
+        tile_bounds.element_count = uint32_t(tile.elementCount);
+        size_t bufferSize = 0;
+        const float* position_tile_data = static_cast<const float*>(position_ch.tileDataPtr( tile.index, bufferSize ));
+        if (!position_tile_data)
+            return;
+        points_bounds(position_tile_data,tile.elementCount,1.0f,tile_bounds.bounds.min,tile_bounds.bounds.max);
+        const float* velocity_tile_data = 0;
+        if (velocity_status && velocity_ch.elementCount( tile.index ) == tile.elementCount)
+            velocity_tile_data = static_cast<const float*>(velocity_ch.tileDataPtr( tile.index, bufferSize ));
+        if (velocity_tile_data)
+            velocity_extruded_bounds(position_tile_data,velocity_tile_data,tile.elementCount,1.0f,fps_1,
+                                     tile_bounds.velocity_bounds.min,tile_bounds.velocity_bounds.max);
+        else
+            tile_bounds.velocity_bounds = tile_bounds.bounds;
+    });
+    BoundsCacheBox component_bounds;
+    for (size_t i=first_tile;i<io_tiles.size();i++)
+    {
+        component_bounds.extend(io_tiles[i].bounds);
+        io_frame.velocity_bounds.extend(io_tiles[i].velocity_bounds);
+    }
+    io_frame.bounds.extend(component_bounds);
+    if (!component_bounds.empty())
+    {
+        for (int axis=0;axis<3;axis++)
+        {
+            component_bounds.min[axis] *= voxel_scale;
+            component_bounds.max[axis] *= voxel_scale;
+        }
+        io_frame.world_bounds.extend(component_bounds);
+    }
+    io_frame.element_count += traversal.elementCount();
+    return true;
+}
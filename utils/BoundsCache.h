@@ -0,0 +1,144 @@
+#pragma once
+
+#include <BifrostHeaders.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief Sidecar index of the point bounds of a whole Bifrost sequence,
+ *        so bounds are known without loading the .bif files
+ * \note Binary, native endianness. Layout is
+ *       BoundsCacheHeader, BoundsCacheFrame[frame_count] sorted by frame,
+ *       then the BoundsCacheTile records of every frame. Only the header and
+ *       the frame table are read on open(), tiles are read on demand.
+ *       Bounds are in the file's space except the frame's world_bounds,
+ *       where each component is scaled by its own voxel scale. Velocity
+ *       bounds hold both P and P + v/fps
+ */
+struct BoundsCacheBox
+{
+    BoundsCacheBox() { clear(); }
+    float min[3];
+    float max[3];
+
+    /*! \brief Sets the box to empty (min = +FLT_MAX, max = -FLT_MAX) */
+    void clear();
+    bool empty() const { return min[0]>max[0] || min[1]>max[1] || min[2]>max[2]; }
+    void extend(const BoundsCacheBox& other);
+};
+
+struct BoundsCacheTile
+{
+    BoundsCacheTile()
+    : component(0)
+    , tile(0)
+    , depth(0)
+    , element_count(0)
+    {}
+    uint32_t       component; /*!< index of the point component in the StateServer */
+    uint32_t       tile;
+    uint32_t       depth;
+    uint32_t       element_count;
+    BoundsCacheBox bounds;
+    BoundsCacheBox velocity_bounds;
+};
+typedef std::vector<BoundsCacheTile> BoundsCacheTileContainer;
+
+struct BoundsCacheFrame
+{
+    BoundsCacheFrame()
+    : frame(0)
+    , element_count(0)
+    , tile_offset(0)
+    , tile_count(0)
+    {}
+    int32_t        frame;
+    uint64_t       element_count;
+    uint64_t       tile_offset; /*!< byte offset of the first tile record in the file */
+    uint64_t       tile_count;
+    BoundsCacheBox bounds;
+    BoundsCacheBox velocity_bounds;
+    BoundsCacheBox world_bounds;
+};
+typedef std::vector<BoundsCacheFrame> BoundsCacheFrameContainer;
+
+struct BoundsCacheHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t frame_count;
+    float    fps; /*!< frame rate the velocity bounds were computed with */
+};
+
+/*! \brief Read access to a bounds cache sidecar */
+class BoundsCache
+{
+public:
+    BoundsCache();
+
+    /*! \brief Reads the header and the frame table, false if missing or not a bounds cache */
+    bool open(const std::string& filename);
+    bool valid() const { return _valid; }
+    float fps() const { return _fps; }
+    size_t frame_count() const { return _frames.size(); }
+    const BoundsCacheFrame& frame(size_t i) const { return _frames[i]; }
+    /*! \return The frame's record, null if the frame is not in the cache */
+    const BoundsCacheFrame* find_frame(int frame) const;
+    /*! \brief Reads the per-tile bounds of one frame */
+    bool read_tiles(const BoundsCacheFrame& frame,
+                    BoundsCacheTileContainer& o_tiles) const;
+
+private:
+    std::string               _filename;
+    bool                      _valid;
+    float                     _fps;
+    BoundsCacheFrameContainer _frames;
+};
+
+/*! \brief Accumulates frames, in any order, and writes the sidecar */
+class BoundsCacheWriter
+{
+public:
+    explicit BoundsCacheWriter(float fps);
+
+    void add_frame(const BoundsCacheFrame& frame,
+                   const BoundsCacheTileContainer& tiles);
+    bool write(const std::string& filename) const;
+
+private:
+    float                                 _fps;
+    BoundsCacheFrameContainer             _frames;
+    std::vector<BoundsCacheTileContainer> _tiles;
+};
+
+/*!
+ * \brief Default sidecar name of a Bifrost sequence, the frame number and
+ *        extension are replaced, e.g. "liquid.0012.bif" -> "liquid.bounds"
+ * \note Accepts a frame pattern ("liquid.%04d.bif", "liquid.####.bif") too
+ */
+std::string bounds_cache_filename(const std::string& bifrost_filename);
+
+/*! \brief Frame number at the end of a sequence filename, e.g. 12 for "liquid.0012.bif" */
+bool frame_from_filename(const std::string& bifrost_filename, int& o_frame);
+
+/*!
+ * \brief Extends io_frame with the per-tile bounds of a point component
+ * \note Tiles are appended to io_tiles. A missing or mismatched velocity
+ *       channel leaves the velocity bounds equal to the point bounds
+ * \return false if the position channel is missing or not FloatV3Type
+ */
+bool compute_point_bounds(const Bifrost::API::Component& component,
+                          uint32_t component_index,
+                          const std::string& position_channel_name,
+                          const std::string& velocity_channel_name,
+                          float fps,
+                          BoundsCacheFrame& io_frame,
+                          BoundsCacheTileContainer& io_tiles);
+
+/*!
+ * \brief Looks up a Bifrost file's frame in its default sidecar
+ * \return false if there is no sidecar or the frame is not in it
+ */
+bool find_cached_frame_bounds(const std::string& bifrost_filename,
+                              BoundsCacheFrame& o_frame);
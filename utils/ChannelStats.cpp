@@ -0,0 +1,613 @@
+#include "ChannelStats.h"
+#include "PointKernels.h"
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CHANNEL_STATS_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define CHANNEL_STATS_AVX_TARGET
+#else
+#define CHANNEL_STATS_AVX_TARGET __attribute__((target("avx")))
+#endif
+#endif // x86
+
+namespace {
+
+/*!
+ * \brief Partial results of one kernel call for one component, folded into
+ *        a ChannelStats once per call. Sums are accumulated in double around
+ *        shift, the first finite value of the tile, so the variance does not
+ *        cancel out when the spread is small next to the mean
+ */
+struct StatsPartial
+{
+    StatsPartial()
+    : min(DBL_MAX)
+    , max(-DBL_MAX)
+    , shift(0)
+    , sum(0)
+    , sum_squares(0)
+    , count(0)
+    , finite_count(0)
+    , nonzero_count(0)
+    , nan_count(0)
+    , inf_count(0)
+    {}
+    double   min;
+    double   max;
+    double   shift;
+    double   sum;         /*!< sum of value-shift */
+    double   sum_squares; /*!< sum of (value-shift)^2 */
+    uint64_t count;
+    uint64_t finite_count;
+    uint64_t nonzero_count;
+    uint64_t nan_count;
+    uint64_t inf_count;
+
+    void add(double value)
+    {
+        count++;
+        if (value != value)
+        {
+            nan_count++;
+            return;
+        }
+        if (value == HUGE_VAL || value == -HUGE_VAL)
+        {
+            inf_count++;
+            return;
+        }
+        finite_count++;
+        if (value != 0.0)
+            nonzero_count++;
+        if (value < min) min = value;
+        if (value > max) max = value;
+        const double shifted = value - shift;
+        sum += shifted;
+        sum_squares += shifted*shifted;
+    }
+};
+
+template<typename T>
+void init_shifts(const T* values, size_t element_count, int components, StatsPartial* io_partials)
+{
+    for (int c=0;c<components;c++)
+    {
+        for (size_t i=c;i<element_count*components;i+=components)
+        {
+            const double value = double(values[i]);
+            if (value == value && value != HUGE_VAL && value != -HUGE_VAL)
+            {
+                io_partials[c].shift = value;
+                break;
+            }
+        }
+    }
+}
+
+void fold_partial(const StatsPartial& partial, ChannelStats& io_stats)
+{
+    ChannelStats stats;
+    stats.count = partial.count;
+    stats.finite_count = partial.finite_count;
+    stats.nonzero_count = partial.nonzero_count;
+    stats.nan_count = partial.nan_count;
+    stats.inf_count = partial.inf_count;
+    if (partial.finite_count)
+    {
+        stats.min = partial.min;
+        stats.max = partial.max;
+        const double offset = partial.sum/double(partial.finite_count);
+        stats.mean = partial.shift + offset;
+        stats.m2 = std::max(partial.sum_squares - partial.sum*offset,0.0);
+    }
+    io_stats.merge(stats);
+}
+
+/*!
+ * \brief Values are processed as laid out, interleaved components included :
+ *        a block of 12 (SSE) or 24 (AVX) floats fills exactly 3 registers
+ *        and is a multiple of 1, 2, 3 and 4 components, so lane L of the
+ *        accumulators always holds component L%components. The sums are
+ *        widened to double before accumulation, two or four lanes at a time
+ */
+const size_t FLOAT_BLOCK_LANES = 24;
+
+struct FloatLanes
+{
+    float min[FLOAT_BLOCK_LANES];
+    float max[FLOAT_BLOCK_LANES];
+    double sum[FLOAT_BLOCK_LANES];
+    double sum_squares[FLOAT_BLOCK_LANES];
+    float finite_count[FLOAT_BLOCK_LANES];
+    float nonzero_count[FLOAT_BLOCK_LANES];
+    float nan_count[FLOAT_BLOCK_LANES];
+    float inf_count[FLOAT_BLOCK_LANES];
+};
+
+void fold_lanes(const FloatLanes& lanes, size_t lane_count, int components, StatsPartial* io_partials)
+{
+    for (size_t lane=0;lane<lane_count;lane++)
+    {
+        StatsPartial& partial = io_partials[lane%components];
+        uint64_t finite_count = uint64_t(lanes.finite_count[lane]);
+        uint64_t nan_count = uint64_t(lanes.nan_count[lane]);
+        uint64_t inf_count = uint64_t(lanes.inf_count[lane]);
+        partial.count += finite_count + nan_count + inf_count;
+        partial.finite_count += finite_count;
+        partial.nonzero_count += uint64_t(lanes.nonzero_count[lane]);
+        partial.nan_count += nan_count;
+        partial.inf_count += inf_count;
+        if (finite_count)
+        {
+            partial.min = std::min(partial.min,double(lanes.min[lane]));
+            partial.max = std::max(partial.max,double(lanes.max[lane]));
+        }
+        partial.sum += lanes.sum[lane];
+        partial.sum_squares += lanes.sum_squares[lane];
+    }
+}
+
+// Scalar ------------------------------------------------------------------
+
+void scalar_float_stats(const float* values, size_t value_count, int components,
+                        StatsPartial* io_partials)
+{
+    for (size_t i=0;i<value_count;i++)
+        io_partials[i%components].add(values[i]);
+}
+
+#ifdef CHANNEL_STATS_X86
+
+// SSE ---------------------------------------------------------------------
+
+void sse_float_stats(const float* values, size_t value_count, int components,
+                     StatsPartial* io_partials)
+{
+    const size_t block_count = value_count/12;
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 infinity = _mm_set1_ps(HUGE_VALF);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 lowest = _mm_set1_ps(-FLT_MAX);
+    const __m128 highest = _mm_set1_ps(FLT_MAX);
+    float shift_lanes[12];
+    for (size_t lane=0;lane<12;lane++)
+        shift_lanes[lane] = float(io_partials[lane%components].shift);
+    __m128 mn[3], mx[3], fin[3], nz[3], nan[3], inf[3], shift[3];
+    __m128d sum[6], sq[6], shift_d[6];
+    for (int r=0;r<3;r++)
+    {
+        mn[r] = highest;
+        mx[r] = lowest;
+        fin[r] = nz[r] = nan[r] = inf[r] = zero;
+        shift[r] = _mm_loadu_ps(shift_lanes + r*4);
+        shift_d[r*2] = _mm_cvtps_pd(shift[r]);
+        shift_d[r*2+1] = _mm_cvtps_pd(_mm_movehl_ps(shift[r],shift[r]));
+        sum[r*2] = sum[r*2+1] = sq[r*2] = sq[r*2+1] = _mm_setzero_pd();
+    }
+    for (size_t b=0;b<block_count;b++)
+    {
+        for (int r=0;r<3;r++)
+        {
+            __m128 a = _mm_loadu_ps(values + b*12 + r*4);
+            __m128 abs_a = _mm_and_ps(a,abs_mask);
+            __m128 is_nan = _mm_cmpunord_ps(a,a);
+            __m128 is_inf = _mm_cmpeq_ps(abs_a,infinity);
+            __m128 is_finite = _mm_cmplt_ps(abs_a,infinity);
+            __m128 is_nonzero = _mm_and_ps(is_finite,_mm_cmpneq_ps(a,zero));
+            __m128 finite_a = _mm_and_ps(a,is_finite);
+            mn[r] = _mm_min_ps(mn[r],_mm_or_ps(finite_a,_mm_andnot_ps(is_finite,highest)));
+            mx[r] = _mm_max_ps(mx[r],_mm_or_ps(finite_a,_mm_andnot_ps(is_finite,lowest)));
+            // non finite lanes take the shift so they add exactly zero
+            __m128 shifted_a = _mm_or_ps(finite_a,_mm_andnot_ps(is_finite,shift[r]));
+            __m128d lo = _mm_sub_pd(_mm_cvtps_pd(shifted_a),shift_d[r*2]);
+            __m128d hi = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(shifted_a,shifted_a)),shift_d[r*2+1]);
+            sum[r*2] = _mm_add_pd(sum[r*2],lo);
+            sum[r*2+1] = _mm_add_pd(sum[r*2+1],hi);
+            sq[r*2] = _mm_add_pd(sq[r*2],_mm_mul_pd(lo,lo));
+            sq[r*2+1] = _mm_add_pd(sq[r*2+1],_mm_mul_pd(hi,hi));
+            fin[r] = _mm_add_ps(fin[r],_mm_and_ps(is_finite,one));
+            nz[r] = _mm_add_ps(nz[r],_mm_and_ps(is_nonzero,one));
+            nan[r] = _mm_add_ps(nan[r],_mm_and_ps(is_nan,one));
+            inf[r] = _mm_add_ps(inf[r],_mm_and_ps(is_inf,one));
+        }
+    }
+    if (block_count)
+    {
+        FloatLanes lanes;
+        for (int r=0;r<3;r++)
+        {
+            _mm_storeu_ps(lanes.min + r*4,mn[r]);
+            _mm_storeu_ps(lanes.max + r*4,mx[r]);
+            _mm_storeu_pd(lanes.sum + r*4,sum[r*2]);
+            _mm_storeu_pd(lanes.sum + r*4 + 2,sum[r*2+1]);
+            _mm_storeu_pd(lanes.sum_squares + r*4,sq[r*2]);
+            _mm_storeu_pd(lanes.sum_squares + r*4 + 2,sq[r*2+1]);
+            _mm_storeu_ps(lanes.finite_count + r*4,fin[r]);
+            _mm_storeu_ps(lanes.nonzero_count + r*4,nz[r]);
+            _mm_storeu_ps(lanes.nan_count + r*4,nan[r]);
+            _mm_storeu_ps(lanes.inf_count + r*4,inf[r]);
+        }
+        fold_lanes(lanes,12,components,io_partials);
+    }
+    size_t done = block_count*12;
+    scalar_float_stats(values + done, value_count - done, components, io_partials);
+}
+
+// AVX ---------------------------------------------------------------------
+
+CHANNEL_STATS_AVX_TARGET
+void avx_float_stats(const float* values, size_t value_count, int components,
+                     StatsPartial* io_partials)
+{
+    const size_t block_count = value_count/24;
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 infinity = _mm256_set1_ps(HUGE_VALF);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 lowest = _mm256_set1_ps(-FLT_MAX);
+    const __m256 highest = _mm256_set1_ps(FLT_MAX);
+    float shift_lanes[24];
+    for (size_t lane=0;lane<24;lane++)
+        shift_lanes[lane] = float(io_partials[lane%components].shift);
+    __m256 mn[3], mx[3], fin[3], nz[3], nan[3], inf[3], shift[3];
+    __m256d sum[6], sq[6], shift_d[6];
+    for (int r=0;r<3;r++)
+    {
+        mn[r] = highest;
+        mx[r] = lowest;
+        fin[r] = nz[r] = nan[r] = inf[r] = zero;
+        shift[r] = _mm256_loadu_ps(shift_lanes + r*8);
+        shift_d[r*2] = _mm256_cvtps_pd(_mm256_castps256_ps128(shift[r]));
+        shift_d[r*2+1] = _mm256_cvtps_pd(_mm256_extractf128_ps(shift[r],1));
+        sum[r*2] = sum[r*2+1] = sq[r*2] = sq[r*2+1] = _mm256_setzero_pd();
+    }
+    for (size_t b=0;b<block_count;b++)
+    {
+        for (int r=0;r<3;r++)
+        {
+            __m256 a = _mm256_loadu_ps(values + b*24 + r*8);
+            __m256 abs_a = _mm256_and_ps(a,abs_mask);
+            __m256 is_nan = _mm256_cmp_ps(a,a,_CMP_UNORD_Q);
+            __m256 is_inf = _mm256_cmp_ps(abs_a,infinity,_CMP_EQ_OQ);
+            __m256 is_finite = _mm256_cmp_ps(abs_a,infinity,_CMP_LT_OQ);
+            __m256 is_nonzero = _mm256_and_ps(is_finite,_mm256_cmp_ps(a,zero,_CMP_NEQ_OQ));
+            __m256 finite_a = _mm256_and_ps(a,is_finite);
+            mn[r] = _mm256_min_ps(mn[r],_mm256_or_ps(finite_a,_mm256_andnot_ps(is_finite,highest)));
+            mx[r] = _mm256_max_ps(mx[r],_mm256_or_ps(finite_a,_mm256_andnot_ps(is_finite,lowest)));
+            // non finite lanes take the shift so they add exactly zero
+            __m256 shifted_a = _mm256_or_ps(finite_a,_mm256_andnot_ps(is_finite,shift[r]));
+            __m256d lo = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(shifted_a)),shift_d[r*2]);
+            __m256d hi = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(shifted_a,1)),shift_d[r*2+1]);
+            sum[r*2] = _mm256_add_pd(sum[r*2],lo);
+            sum[r*2+1] = _mm256_add_pd(sum[r*2+1],hi);
+            sq[r*2] = _mm256_add_pd(sq[r*2],_mm256_mul_pd(lo,lo));
+            sq[r*2+1] = _mm256_add_pd(sq[r*2+1],_mm256_mul_pd(hi,hi));
+            fin[r] = _mm256_add_ps(fin[r],_mm256_and_ps(is_finite,one));
+            nz[r] = _mm256_add_ps(nz[r],_mm256_and_ps(is_nonzero,one));
+            nan[r] = _mm256_add_ps(nan[r],_mm256_and_ps(is_nan,one));
+            inf[r] = _mm256_add_ps(inf[r],_mm256_and_ps(is_inf,one));
+        }
+    }
+    if (block_count)
+    {
+        FloatLanes lanes;
+        for (int r=0;r<3;r++)
+        {
+            _mm256_storeu_ps(lanes.min + r*8,mn[r]);
+            _mm256_storeu_ps(lanes.max + r*8,mx[r]);
+            _mm256_storeu_pd(lanes.sum + r*8,sum[r*2]);
+            _mm256_storeu_pd(lanes.sum + r*8 + 4,sum[r*2+1]);
+            _mm256_storeu_pd(lanes.sum_squares + r*8,sq[r*2]);
+            _mm256_storeu_pd(lanes.sum_squares + r*8 + 4,sq[r*2+1]);
+            _mm256_storeu_ps(lanes.finite_count + r*8,fin[r]);
+            _mm256_storeu_ps(lanes.nonzero_count + r*8,nz[r]);
+            _mm256_storeu_ps(lanes.nan_count + r*8,nan[r]);
+            _mm256_storeu_ps(lanes.inf_count + r*8,inf[r]);
+        }
+        fold_lanes(lanes,24,components,io_partials);
+    }
+    size_t done = block_count*24;
+    sse_float_stats(values + done, value_count - done, components, io_partials);
+}
+
+#endif // CHANNEL_STATS_X86
+
+typedef void (*FloatStatsKernel)(const float*, size_t, int, StatsPartial*);
+
+FloatStatsKernel float_stats_kernel()
+{
+#ifdef CHANNEL_STATS_X86
+    switch (point_kernel_isa())
+    {
+    case PointKernelAVX :
+        return avx_float_stats;
+    case PointKernelSSE :
+        return sse_float_stats;
+    default:
+        break;
+    }
+#endif // CHANNEL_STATS_X86
+    return scalar_float_stats;
+}
+
+/*!
+ * \brief Float lanes count exactly up to 2^24, so large tiles are reduced
+ *        in chunks folded in double
+ */
+const size_t FLOAT_STATS_CHUNK = size_t(1)<<16;
+
+void float_stats(const float* values, size_t element_count, int components,
+                 ChannelStats* io_stats)
+{
+    static const FloatStatsKernel kernel = float_stats_kernel();
+    std::vector<StatsPartial> partials(components);
+    init_shifts(values,element_count,components,&partials[0]);
+    const size_t value_count = element_count*components;
+    const size_t chunk = FLOAT_STATS_CHUNK*FLOAT_BLOCK_LANES;
+    for (size_t offset=0;offset<value_count;offset+=chunk)
+        kernel(values + offset, std::min(chunk,value_count-offset), components, &partials[0]);
+    for (int c=0;c<components;c++)
+        fold_partial(partials[c],io_stats[c]);
+}
+
+template<typename T>
+void generic_stats(const T* values, size_t element_count, int components,
+                   ChannelStats* io_stats)
+{
+    std::vector<StatsPartial> partials(components);
+    init_shifts(values,element_count,components,&partials[0]);
+    for (size_t i=0;i<element_count*components;i++)
+        partials[i%components].add(double(values[i]));
+    for (int c=0;c<components;c++)
+        fold_partial(partials[c],io_stats[c]);
+}
+
+template<typename T>
+void generic_histogram(const T* values, size_t element_count, int components,
+                       ChannelHistogram* io_histograms)
+{
+    for (int c=0;c<components;c++)
+    {
+        ChannelHistogram& histogram = io_histograms[c];
+        const size_t bin_count = histogram.bins.size();
+        if (bin_count==0)
+            continue;
+        const double range = histogram.max - histogram.min;
+        const double to_bin = range>0 ? double(bin_count)/range : 0.0;
+        for (size_t i=c;i<element_count*components;i+=components)
+        {
+            double value = double(values[i]);
+            if (!(value>=histogram.min && value<=histogram.max))
+                continue; // also rejects NaN
+            size_t bin = size_t((value-histogram.min)*to_bin);
+            histogram.bins[std::min(bin,bin_count-1)]++;
+        }
+    }
+}
+
+/*!
+ * \brief Calls op(typed_pointer, components) for the numeric data types
+ * \return false for the types without statistics
+ */
+template<typename Op>
+bool dispatch_numeric(const void* data, Bifrost::API::DataType data_type, const Op& op)
+{
+    switch (data_type)
+    {
+    case Bifrost::API::FloatType :
+    case Bifrost::API::FloatV2Type :
+    case Bifrost::API::FloatV3Type :
+#if BIFROST_VERSION >= 20
+    case Bifrost::API::FloatV4Type :
+    case Bifrost::API::FloatMat44Type :
+#endif // BIFROST_VERSION >= 20
+        op(static_cast<const float*>(data),data_type_component_count(data_type));
+        return true;
+    case Bifrost::API::Int32Type :
+    case Bifrost::API::Int32V2Type :
+    case Bifrost::API::Int32V3Type :
+        op(static_cast<const int32_t*>(data),data_type_component_count(data_type));
+        return true;
+    case Bifrost::API::Int64Type :
+        op(static_cast<const int64_t*>(data),1);
+        return true;
+    case Bifrost::API::UInt32Type :
+        op(static_cast<const uint32_t*>(data),1);
+        return true;
+    case Bifrost::API::UInt64Type :
+#if BIFROST_VERSION >= 20
+    case Bifrost::API::UInt64V2Type :
+    case Bifrost::API::UInt64V3Type :
+    case Bifrost::API::UInt64V4Type :
+#endif // BIFROST_VERSION >= 20
+        op(static_cast<const uint64_t*>(data),data_type_component_count(data_type));
+        return true;
+#if BIFROST_VERSION >= 20
+    case Bifrost::API::Int8Type :
+        op(static_cast<const int8_t*>(data),1);
+        return true;
+    case Bifrost::API::Int16Type :
+        op(static_cast<const int16_t*>(data),1);
+        return true;
+    case Bifrost::API::UInt8Type :
+        op(static_cast<const uint8_t*>(data),1);
+        return true;
+    case Bifrost::API::UInt16Type :
+        op(static_cast<const uint16_t*>(data),1);
+        return true;
+    case Bifrost::API::BoolType :
+        op(static_cast<const bool*>(data),1);
+        return true;
+#endif // BIFROST_VERSION >= 20
+    default:
+        return false;
+    }
+}
+
+struct StatsOp
+{
+    StatsOp(size_t i_element_count, ChannelStats* i_stats)
+    : element_count(i_element_count)
+    , stats(i_stats)
+    {}
+    void operator()(const float* values, int components) const
+    {
+        if (components<=4)
+            float_stats(values,element_count,components,stats);
+        else
+            generic_stats(values,element_count,components,stats);
+    }
+    template<typename T>
+    void operator()(const T* values, int components) const
+    {
+        generic_stats(values,element_count,components,stats);
+    }
+    size_t        element_count;
+    ChannelStats* stats;
+};
+
+struct HistogramOp
+{
+    HistogramOp(size_t i_element_count, ChannelHistogram* i_histograms)
+    : element_count(i_element_count)
+    , histograms(i_histograms)
+    {}
+    template<typename T>
+    void operator()(const T* values, int components) const
+    {
+        generic_histogram(values,element_count,components,histograms);
+    }
+    size_t            element_count;
+    ChannelHistogram* histograms;
+};
+
+} // anonymous namespace
+
+ChannelStats::ChannelStats()
+: count(0)
+, finite_count(0)
+, nonzero_count(0)
+, nan_count(0)
+, inf_count(0)
+, min(0)
+, max(0)
+, mean(0)
+, m2(0)
+{
+}
+
+double ChannelStats::stddev() const
+{
+    return sqrt(variance());
+}
+
+void ChannelStats::merge(const ChannelStats& other)
+{
+    if (other.finite_count)
+    {
+        if (finite_count==0)
+        {
+            min = other.min;
+            max = other.max;
+            mean = other.mean;
+            m2 = other.m2;
+        }
+        else
+        {
+            const double n_a = double(finite_count);
+            const double n_b = double(other.finite_count);
+            const double n = n_a + n_b;
+            const double delta = other.mean - mean;
+            mean += delta*n_b/n;
+            m2 += other.m2 + delta*delta*n_a*n_b/n;
+            min = std::min(min,other.min);
+            max = std::max(max,other.max);
+        }
+    }
+    count += other.count;
+    finite_count += other.finite_count;
+    nonzero_count += other.nonzero_count;
+    nan_count += other.nan_count;
+    inf_count += other.inf_count;
+}
+
+ChannelHistogram::ChannelHistogram()
+: min(0)
+, max(0)
+{
+}
+
+ChannelHistogram::ChannelHistogram(double i_min, double i_max, size_t bin_count)
+: min(i_min)
+, max(i_max)
+, bins(bin_count,0)
+{
+}
+
+void ChannelHistogram::merge(const ChannelHistogram& other)
+{
+    if (bins.size() != other.bins.size())
+        return;
+    for (size_t i=0;i<bins.size();i++)
+        bins[i] += other.bins[i];
+}
+
+int data_type_component_count(Bifrost::API::DataType i_data_type)
+{
+    switch (i_data_type)
+    {
+    case Bifrost::API::FloatType :
+    case Bifrost::API::Int32Type :
+    case Bifrost::API::Int64Type :
+    case Bifrost::API::UInt32Type :
+    case Bifrost::API::UInt64Type :
+        return 1;
+    case Bifrost::API::FloatV2Type :
+    case Bifrost::API::Int32V2Type :
+        return 2;
+    case Bifrost::API::FloatV3Type :
+    case Bifrost::API::Int32V3Type :
+        return 3;
+#if BIFROST_VERSION >= 20
+    case Bifrost::API::Int8Type :
+    case Bifrost::API::Int16Type :
+    case Bifrost::API::UInt8Type :
+    case Bifrost::API::UInt16Type :
+    case Bifrost::API::BoolType :
+        return 1;
+    case Bifrost::API::UInt64V2Type :
+        return 2;
+    case Bifrost::API::UInt64V3Type :
+        return 3;
+    case Bifrost::API::FloatV4Type :
+    case Bifrost::API::UInt64V4Type :
+        return 4;
+    case Bifrost::API::FloatMat44Type :
+        return 16;
+#endif // BIFROST_VERSION >= 20
+    default:
+        return 0;
+    }
+}
+
+bool accumulate_channel_stats(const void* data,
+                              size_t element_count,
+                              Bifrost::API::DataType data_type,
+                              ChannelStats* io_stats)
+{
+    return dispatch_numeric(data,data_type,StatsOp(element_count,io_stats));
+}
+
+bool accumulate_channel_histogram(const void* data,
+                                  size_t element_count,
+                                  Bifrost::API::DataType data_type,
+                                  ChannelHistogram* io_histograms)
+{
+    return dispatch_numeric(data,data_type,HistogramOp(element_count,io_histograms));
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <BifrostHeaders.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/*!
+ * \brief Statistics of one component of a channel (e.g. the y of a FloatV3
+ *        channel), accumulated tile by tile and merged across tiles
+ * \note min, max, mean and stddev only consider finite values. The mean and
+ *       variance are merged with Chan's pairwise update so tiles can be
+ *       reduced in parallel and merged in any grouping
+ */
+struct ChannelStats
+{
+    ChannelStats();
+    uint64_t count;         /*!< all values, including NaN and Inf */
+    uint64_t finite_count;
+    uint64_t nonzero_count; /*!< finite and non-zero */
+    uint64_t nan_count;
+    uint64_t inf_count;
+    double   min;
+    double   max;
+    double   mean;
+    double   m2;            /*!< sum of the squared deviations from the mean */
+
+    double variance() const { return finite_count>1 ? m2/double(finite_count) : 0.0; }
+    double stddev() const;
+    void merge(const ChannelStats& other);
+};
+typedef std::vector<ChannelStats> ChannelStatsContainer;
+
+/*!
+ * \brief Fixed range histogram of one component of a channel
+ * \note Values outside [min,max] and non-finite values are not counted
+ */
+struct ChannelHistogram
+{
+    ChannelHistogram();
+    ChannelHistogram(double i_min, double i_max, size_t bin_count);
+    double                min;
+    double                max;
+    std::vector<uint64_t> bins;
+
+    void merge(const ChannelHistogram& other);
+};
+typedef std::vector<ChannelHistogram> ChannelHistogramContainer;
+
+/*!
+ * \brief Number of scalar components of a numeric data type, e.g. 3 for
+ *        FloatV3Type, 0 for types without statistics (strings, dictionaries)
+ */
+int data_type_component_count(Bifrost::API::DataType i_data_type);
+
+/*!
+ * \brief Accumulates element_count elements of a tile into io_stats, one
+ *        ChannelStats per component
+ * \note Float types with 1 to 4 components use SSE or AVX reductions, see
+ *       point_kernel_isa(), other types are converted to double
+ * \return false if the data type has no statistics
+ */
+bool accumulate_channel_stats(const void* data,
+                              size_t element_count,
+                              Bifrost::API::DataType data_type,
+                              ChannelStats* io_stats);
+
+/*! \brief Accumulates the elements of a tile into one histogram per component */
+bool accumulate_channel_histogram(const void* data,
+                                  size_t element_count,
+                                  Bifrost::API::DataType data_type,
+                                  ChannelHistogram* io_histograms);
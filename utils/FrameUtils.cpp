@@ -0,0 +1,193 @@
+#include "FrameUtils.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <algorithm>
+#ifndef _WIN32
+#include <glob.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+bool parse_int(const char*& io_cursor, int& o_value)
+{
+    char* end = 0;
+    errno = 0;
+    long value = strtol(io_cursor, &end, 10);
+    if (end == io_cursor || errno != 0)
+        return false;
+    io_cursor = end;
+    o_value = int(value);
+    return true;
+}
+
+/*!
+ * \brief Locates the last frame token, either %[0][width]d or a run of '#'
+ * \return false if there is none
+ */
+bool find_frame_token(const std::string& i_pattern,
+                      size_t& o_begin,
+                      size_t& o_length,
+                      int& o_padding)
+{
+    size_t hash_end = i_pattern.find_last_of('#');
+    size_t percent = i_pattern.find_last_of('%');
+    bool found_percent = false;
+    size_t percent_length = 0;
+    int percent_padding = 0;
+    if (percent != std::string::npos)
+    {
+        size_t i = percent+1;
+        while (i<i_pattern.size() && i_pattern[i]>='0' && i_pattern[i]<='9')
+            i++;
+        if (i<i_pattern.size() && i_pattern[i]=='d')
+        {
+            found_percent = true;
+            percent_length = i+1-percent;
+            if (i>percent+1)
+                percent_padding = atoi(i_pattern.substr(percent+1,i-percent-1).c_str());
+        }
+    }
+    if (hash_end != std::string::npos && (!found_percent || hash_end>percent))
+    {
+        size_t hash_begin = hash_end;
+        while (hash_begin>0 && i_pattern[hash_begin-1]=='#')
+            hash_begin--;
+        o_begin = hash_begin;
+        o_length = hash_end+1-hash_begin;
+        o_padding = int(o_length);
+        return true;
+    }
+    if (found_percent)
+    {
+        o_begin = percent;
+        o_length = percent_length;
+        o_padding = percent_padding;
+        return true;
+    }
+    return false;
+}
+
+bool has_glob_characters(const std::string& i_path)
+{
+    return i_path.find_first_of("*?[") != std::string::npos;
+}
+
+#ifndef _WIN32
+bool is_directory(const std::string& i_path)
+{
+    struct stat path_stat;
+    return stat(i_path.c_str(),&path_stat)==0 && S_ISDIR(path_stat.st_mode);
+}
+
+bool glob_files(const std::string& i_pattern, std::vector<std::string>& o_files)
+{
+    glob_t matches;
+    int status = glob(i_pattern.c_str(),0,0,&matches);
+    if (status==0)
+        o_files.insert(o_files.end(),matches.gl_pathv,matches.gl_pathv+matches.gl_pathc);
+    globfree(&matches);
+    return status==0;
+}
+
+bool list_directory(const std::string& i_directory, std::vector<std::string>& o_files)
+{
+    DIR* directory = opendir(i_directory.c_str());
+    if (!directory)
+        return false;
+    std::string prefix(i_directory);
+    if (prefix[prefix.size()-1]!='/')
+        prefix += '/';
+    std::vector<std::string> files;
+    while (struct dirent* entry = readdir(directory))
+    {
+        std::string name(entry->d_name);
+        if (name.size()>4 && name.compare(name.size()-4,4,".bif")==0)
+            files.push_back(prefix+name);
+    }
+    closedir(directory);
+    std::sort(files.begin(),files.end());
+    o_files.insert(o_files.end(),files.begin(),files.end());
+    return true;
+}
+#endif // _WIN32
+
+} // anonymous namespace
+
+bool parse_frame_range(const std::string& i_range_string, FrameRange& o_range)
+{
+    FrameRange range;
+    const char* cursor = i_range_string.c_str();
+    if (!parse_int(cursor,range.first))
+        return false;
+    range.last = range.first;
+    if (*cursor=='-')
+    {
+        cursor++;
+        if (!parse_int(cursor,range.last))
+            return false;
+        if (*cursor=='x' || *cursor==':')
+        {
+            cursor++;
+            if (!parse_int(cursor,range.step))
+                return false;
+        }
+    }
+    if (*cursor!='\0' || range.step<=0 || range.last<range.first)
+        return false;
+    o_range = range;
+    return true;
+}
+
+bool has_frame_pattern(const std::string& i_pattern)
+{
+    size_t begin, length;
+    int padding;
+    return find_frame_token(i_pattern,begin,length,padding);
+}
+
+std::string expand_frame_pattern(const std::string& i_pattern, int i_frame)
+{
+    size_t begin, length;
+    int padding;
+    if (!find_frame_token(i_pattern,begin,length,padding))
+        return i_pattern;
+    char frame_string[32];
+    snprintf(frame_string,sizeof(frame_string),"%0*d",padding,i_frame);
+    std::string result(i_pattern);
+    result.replace(begin,length,frame_string);
+    return result;
+}
+
+bool expand_input_path(const std::string& i_input,
+                       const FrameRange* i_frames,
+                       std::vector<std::string>& o_files)
+{
+    if (has_frame_pattern(i_input))
+    {
+        if (i_frames)
+        {
+            for (size_t i=0;i<i_frames->count();i++)
+                o_files.push_back(expand_frame_pattern(i_input,i_frames->frame(i)));
+            return true;
+        }
+#ifndef _WIN32
+        size_t begin, length;
+        int padding;
+        find_frame_token(i_input,begin,length,padding);
+        std::string pattern(i_input);
+        pattern.replace(begin,length,"*");
+        return glob_files(pattern,o_files);
+#endif // _WIN32
+    }
+#ifndef _WIN32
+    if (is_directory(i_input))
+        return list_directory(i_input,o_files);
+    if (has_glob_characters(i_input))
+        return glob_files(i_input,o_files);
+#endif // _WIN32
+    o_files.push_back(i_input);
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/*!
+ * \brief Inclusive frame range as given on the command line,
+ *        e.g. "1001-1240", "1001-1240x2" or "1001"
+ */
+struct FrameRange
+{
+    FrameRange()
+    : first(1)
+    , last(1)
+    , step(1)
+    {}
+    int first;
+    int last;
+    int step;
+
+    /*! \brief Number of frames in the range */
+    size_t count() const { return last<first ? 0 : size_t((last-first)/step)+1; }
+    int frame(size_t i) const { return first + int(i)*step; }
+};
+
+/*!
+ * \brief Parses "first-last", "first-lastxstep" or a single frame
+ * \return false if the string is malformed, the step is not positive or last < first
+ */
+bool parse_frame_range(const std::string& i_range_string, FrameRange& o_range);
+
+/*! \brief True if the filename contains a printf-style "%d" / "%04d" or a run of '#' */
+bool has_frame_pattern(const std::string& i_pattern);
+
+/*!
+ * \brief Substitutes the frame number into a sequence filename
+ * \note Accepts "liquid.%04d.bif" and "liquid.####.bif" (padded to the number of '#'),
+ *       only the last frame token is substituted
+ */
+std::string expand_frame_pattern(const std::string& i_pattern, int i_frame);
+
+/*!
+ * \brief Expands one command line input into the Bifrost files it names
+ * \note A directory yields its ".bif" files, a glob ('*', '?', '[') its
+ *       matches and a frame pattern either the frames of i_frames or, when
+ *       i_frames is null, the files on disk matching the pattern. Anything
+ *       else is returned as is. Results are sorted by name, except frames
+ *       from i_frames which are kept in frame order (missing files included)
+ * \return false if a directory cannot be read or a pattern matches nothing
+ */
+bool expand_input_path(const std::string& i_input,
+                       const FrameRange* i_frames,
+                       std::vector<std::string>& o_files);
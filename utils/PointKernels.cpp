@@ -0,0 +1,376 @@
+#include "PointKernels.h"
+#include <float.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define POINT_KERNELS_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define POINT_KERNELS_AVX_TARGET
+#else
+#define POINT_KERNELS_AVX_TARGET __attribute__((target("avx")))
+#endif
+#endif // x86
+
+namespace {
+
+/*!
+ * \remark Packed xyz triplets are processed as-is, without transposing to
+ *         structure-of-arrays : 4 points (SSE) or 8 points (AVX) fill exactly
+ *         3 registers, so lane k of the 3 accumulators always holds
+ *         component k%3. The accumulators are only folded per component
+ *         once at the end. min/max return their second operand when either
+ *         is NaN, the accumulator always comes second so NaN is skipped as
+ *         in the scalar code
+ */
+inline void fold_bounds(const float* lane_min, const float* lane_max, size_t lane_count,
+                        float io_min[3], float io_max[3])
+{
+    for (size_t k=0;k<lane_count;k++)
+    {
+        size_t c = k%3;
+        if (lane_min[k] < io_min[c]) io_min[c] = lane_min[k];
+        if (lane_max[k] > io_max[c]) io_max[c] = lane_max[k];
+    }
+}
+
+inline void extend_bounds(float x, float y, float z, float io_min[3], float io_max[3])
+{
+    if (x < io_min[0]) io_min[0] = x;
+    if (y < io_min[1]) io_min[1] = y;
+    if (z < io_min[2]) io_min[2] = z;
+    if (x > io_max[0]) io_max[0] = x;
+    if (y > io_max[1]) io_max[1] = y;
+    if (z > io_max[2]) io_max[2] = z;
+}
+
+// Scalar ------------------------------------------------------------------
+
+void scalar_scale_bounds(const float* in, float* out, size_t count, float scale,
+                         bool do_bounds, float io_min[3], float io_max[3])
+{
+    for (size_t i=0;i<count;i++)
+    {
+        float x = in[i*3]*scale, y = in[i*3+1]*scale, z = in[i*3+2]*scale;
+        if (out)
+        {
+            out[i*3] = x; out[i*3+1] = y; out[i*3+2] = z;
+        }
+        if (do_bounds)
+            extend_bounds(x,y,z,io_min,io_max);
+    }
+}
+
+void scalar_velocity_bounds(const float* p, const float* v, size_t count,
+                            float position_scale, float velocity_scale,
+                            float io_min[3], float io_max[3])
+{
+    for (size_t i=0;i<count;i++)
+    {
+        float x = p[i*3]*position_scale, y = p[i*3+1]*position_scale, z = p[i*3+2]*position_scale;
+        extend_bounds(x,y,z,io_min,io_max);
+        extend_bounds(x + v[i*3]*velocity_scale,
+                      y + v[i*3+1]*velocity_scale,
+                      z + v[i*3+2]*velocity_scale,io_min,io_max);
+    }
+}
+
+#ifdef POINT_KERNELS_X86
+
+// SSE ---------------------------------------------------------------------
+
+void sse_scale_bounds(const float* in, float* out, size_t count, float scale,
+                      bool do_bounds, float io_min[3], float io_max[3])
+{
+    const size_t block_count = count/4;
+    const __m128 s = _mm_set1_ps(scale);
+    __m128 mn[3], mx[3];
+    for (int r=0;r<3;r++)
+    {
+        mn[r] = _mm_set1_ps(FLT_MAX);
+        mx[r] = _mm_set1_ps(-FLT_MAX);
+    }
+    for (size_t b=0;b<block_count;b++)
+    {
+        const float* src = in + b*12;
+        __m128 a[3];
+        for (int r=0;r<3;r++)
+            a[r] = _mm_mul_ps(_mm_loadu_ps(src + r*4),s);
+        if (out)
+        {
+            float* dst = out + b*12;
+            for (int r=0;r<3;r++)
+                _mm_storeu_ps(dst + r*4,a[r]);
+        }
+        if (do_bounds)
+        {
+            for (int r=0;r<3;r++)
+            {
+                mn[r] = _mm_min_ps(a[r],mn[r]);
+                mx[r] = _mm_max_ps(a[r],mx[r]);
+            }
+        }
+    }
+    if (do_bounds && block_count)
+    {
+        float lane_min[12], lane_max[12];
+        for (int r=0;r<3;r++)
+        {
+            _mm_storeu_ps(lane_min + r*4,mn[r]);
+            _mm_storeu_ps(lane_max + r*4,mx[r]);
+        }
+        fold_bounds(lane_min,lane_max,12,io_min,io_max);
+    }
+    size_t done = block_count*4;
+    scalar_scale_bounds(in + done*3, out ? out + done*3 : 0, count - done, scale, do_bounds, io_min, io_max);
+}
+
+void sse_velocity_bounds(const float* p, const float* v, size_t count,
+                         float position_scale, float velocity_scale,
+                         float io_min[3], float io_max[3])
+{
+    const size_t block_count = count/4;
+    const __m128 ps = _mm_set1_ps(position_scale);
+    const __m128 vs = _mm_set1_ps(velocity_scale);
+    __m128 mn[3], mx[3];
+    for (int r=0;r<3;r++)
+    {
+        mn[r] = _mm_set1_ps(FLT_MAX);
+        mx[r] = _mm_set1_ps(-FLT_MAX);
+    }
+    for (size_t b=0;b<block_count;b++)
+    {
+        for (int r=0;r<3;r++)
+        {
+            __m128 a = _mm_mul_ps(_mm_loadu_ps(p + b*12 + r*4),ps);
+            __m128 q = _mm_add_ps(a,_mm_mul_ps(_mm_loadu_ps(v + b*12 + r*4),vs));
+            mn[r] = _mm_min_ps(q,_mm_min_ps(a,mn[r]));
+            mx[r] = _mm_max_ps(q,_mm_max_ps(a,mx[r]));
+        }
+    }
+    if (block_count)
+    {
+        float lane_min[12], lane_max[12];
+        for (int r=0;r<3;r++)
+        {
+            _mm_storeu_ps(lane_min + r*4,mn[r]);
+            _mm_storeu_ps(lane_max + r*4,mx[r]);
+        }
+        fold_bounds(lane_min,lane_max,12,io_min,io_max);
+    }
+    size_t done = block_count*4;
+    scalar_velocity_bounds(p + done*3, v + done*3, count - done, position_scale, velocity_scale, io_min, io_max);
+}
+
+// AVX ---------------------------------------------------------------------
+
+POINT_KERNELS_AVX_TARGET
+void avx_scale_bounds(const float* in, float* out, size_t count, float scale,
+                      bool do_bounds, float io_min[3], float io_max[3])
+{
+    const size_t block_count = count/8;
+    const __m256 s = _mm256_set1_ps(scale);
+    __m256 mn[3], mx[3];
+    for (int r=0;r<3;r++)
+    {
+        mn[r] = _mm256_set1_ps(FLT_MAX);
+        mx[r] = _mm256_set1_ps(-FLT_MAX);
+    }
+    for (size_t b=0;b<block_count;b++)
+    {
+        const float* src = in + b*24;
+        __m256 a[3];
+        for (int r=0;r<3;r++)
+            a[r] = _mm256_mul_ps(_mm256_loadu_ps(src + r*8),s);
+        if (out)
+        {
+            float* dst = out + b*24;
+            for (int r=0;r<3;r++)
+                _mm256_storeu_ps(dst + r*8,a[r]);
+        }
+        if (do_bounds)
+        {
+            for (int r=0;r<3;r++)
+            {
+                mn[r] = _mm256_min_ps(a[r],mn[r]);
+                mx[r] = _mm256_max_ps(a[r],mx[r]);
+            }
+        }
+    }
+    if (do_bounds && block_count)
+    {
+        float lane_min[24], lane_max[24];
+        for (int r=0;r<3;r++)
+        {
+            _mm256_storeu_ps(lane_min + r*8,mn[r]);
+            _mm256_storeu_ps(lane_max + r*8,mx[r]);
+        }
+        fold_bounds(lane_min,lane_max,24,io_min,io_max);
+    }
+    size_t done = block_count*8;
+    sse_scale_bounds(in + done*3, out ? out + done*3 : 0, count - done, scale, do_bounds, io_min, io_max);
+}
+
+POINT_KERNELS_AVX_TARGET
+void avx_velocity_bounds(const float* p, const float* v, size_t count,
+                         float position_scale, float velocity_scale,
+                         float io_min[3], float io_max[3])
+{
+    const size_t block_count = count/8;
+    const __m256 ps = _mm256_set1_ps(position_scale);
+    const __m256 vs = _mm256_set1_ps(velocity_scale);
+    __m256 mn[3], mx[3];
+    for (int r=0;r<3;r++)
+    {
+        mn[r] = _mm256_set1_ps(FLT_MAX);
+        mx[r] = _mm256_set1_ps(-FLT_MAX);
+    }
+    for (size_t b=0;b<block_count;b++)
+    {
+        for (int r=0;r<3;r++)
+        {
+            __m256 a = _mm256_mul_ps(_mm256_loadu_ps(p + b*24 + r*8),ps);
+            __m256 q = _mm256_add_ps(a,_mm256_mul_ps(_mm256_loadu_ps(v + b*24 + r*8),vs));
+            mn[r] = _mm256_min_ps(q,_mm256_min_ps(a,mn[r]));
+            mx[r] = _mm256_max_ps(q,_mm256_max_ps(a,mx[r]));
+        }
+    }
+    if (block_count)
+    {
+        float lane_min[24], lane_max[24];
+        for (int r=0;r<3;r++)
+        {
+            _mm256_storeu_ps(lane_min + r*8,mn[r]);
+            _mm256_storeu_ps(lane_max + r*8,mx[r]);
+        }
+        fold_bounds(lane_min,lane_max,24,io_min,io_max);
+    }
+    size_t done = block_count*8;
+    sse_velocity_bounds(p + done*3, v + done*3, count - done, position_scale, velocity_scale, io_min, io_max);
+}
+
+#endif // POINT_KERNELS_X86
+
+PointKernelISA detect_isa()
+{
+#ifdef POINT_KERNELS_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info,1);
+    bool has_sse2    = (info[3] & (1<<26)) != 0;
+    bool has_osxsave = (info[2] & (1<<27)) != 0;
+    bool has_avx     = (info[2] & (1<<28)) != 0;
+    // The OS must also save the YMM registers on context switch
+    if (has_avx && has_osxsave && (_xgetbv(0) & 0x6) == 0x6)
+        return PointKernelAVX;
+    if (has_sse2)
+        return PointKernelSSE;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))
+        return PointKernelAVX;
+    if (__builtin_cpu_supports("sse2"))
+        return PointKernelSSE;
+#endif
+#endif // POINT_KERNELS_X86
+    return PointKernelScalar;
+}
+
+typedef void (*ScaleBoundsKernel)(const float*, float*, size_t, float, bool, float*, float*);
+typedef void (*VelocityBoundsKernel)(const float*, const float*, size_t, float, float, float*, float*);
+
+struct KernelTable
+{
+    KernelTable()
+    : isa(detect_isa())
+    , scale_bounds(scalar_scale_bounds)
+    , velocity_bounds(scalar_velocity_bounds)
+    {
+#ifdef POINT_KERNELS_X86
+        if (isa == PointKernelAVX)
+        {
+            scale_bounds = avx_scale_bounds;
+            velocity_bounds = avx_velocity_bounds;
+        }
+        else if (isa == PointKernelSSE)
+        {
+            scale_bounds = sse_scale_bounds;
+            velocity_bounds = sse_velocity_bounds;
+        }
+#endif // POINT_KERNELS_X86
+    }
+    PointKernelISA       isa;
+    ScaleBoundsKernel    scale_bounds;
+    VelocityBoundsKernel velocity_bounds;
+};
+
+const KernelTable& kernels()
+{
+    static const KernelTable table;
+    return table;
+}
+
+} // anonymous namespace
+
+PointKernelISA point_kernel_isa()
+{
+    return kernels().isa;
+}
+
+const char* point_kernel_isa_name()
+{
+    switch (point_kernel_isa())
+    {
+    case PointKernelAVX :
+        return "AVX";
+    case PointKernelSSE :
+        return "SSE";
+    default:
+        return "Scalar";
+    }
+}
+
+void init_bounds(float o_min[3], float o_max[3])
+{
+    for (int c=0;c<3;c++)
+    {
+        o_min[c] = FLT_MAX;
+        o_max[c] = -FLT_MAX;
+    }
+}
+
+void scale_points(float* io_xyz, size_t count, float scale)
+{
+    float unused_min[3], unused_max[3];
+    kernels().scale_bounds(io_xyz,io_xyz,count,scale,false,unused_min,unused_max);
+}
+
+void scale_points_and_bounds(float* io_xyz, size_t count, float scale,
+                             float io_min[3], float io_max[3])
+{
+    kernels().scale_bounds(io_xyz,io_xyz,count,scale,true,io_min,io_max);
+}
+
+void points_bounds(const float* xyz, size_t count, float scale,
+                   float io_min[3], float io_max[3])
+{
+    kernels().scale_bounds(xyz,0,count,scale,true,io_min,io_max);
+}
+
+void velocity_extruded_bounds(const float* positions, const float* velocities, size_t count,
+                              float position_scale, float velocity_scale,
+                              float io_min[3], float io_max[3])
+{
+    kernels().velocity_bounds(positions,velocities,count,position_scale,velocity_scale,io_min,io_max);
+}
+
+void advect_points(const float* positions, const float* velocities, size_t count,
+                   float dt, float* o_xyz)
+{
+    // A flat multiply-add over the floats, the xyz layout does not matter
+    // and the compiler vectorizes it without a per-ISA variant
+    const size_t float_count = count*3;
+    for (size_t i=0;i<float_count;i++)
+        o_xyz[i] = positions[i] + velocities[i]*dt;
+}
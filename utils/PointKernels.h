@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+
+/*!
+ * \brief Vectorized kernels over packed xyz float triplets, the memory
+ *        layout of amino::Math::vec3f, Imath::V3f and GL vertex arrays
+ * \note The SSE or AVX implementation is selected once at runtime from the
+ *       CPU features, with a scalar fallback on other architectures.
+ *       Bounds are accumulated into o_min/o_max, initialize them with
+ *       init_bounds() or pass the bounds of a previous call
+ */
+enum PointKernelISA { PointKernelScalar, PointKernelSSE, PointKernelAVX };
+
+/*! \brief Instruction set used by the point kernels on this machine */
+PointKernelISA point_kernel_isa();
+const char* point_kernel_isa_name();
+
+/*! \brief Sets the bounds to empty (min = +FLT_MAX, max = -FLT_MAX) */
+void init_bounds(float o_min[3], float o_max[3]);
+
+/*! \brief Scales count points in place */
+void scale_points(float* io_xyz, size_t count, float scale);
+
+/*! \brief Scales count points in place and extends the bounds with the scaled points */
+void scale_points_and_bounds(float* io_xyz, size_t count, float scale,
+                             float io_min[3], float io_max[3]);
+
+/*! \brief Extends the bounds with (xyz * scale), leaving the points untouched */
+void points_bounds(const float* xyz, size_t count, float scale,
+                   float io_min[3], float io_max[3]);
+
+/*!
+ * \brief Extends the bounds with both (P * position_scale) and
+ *        (P * position_scale + v * velocity_scale)
+ * \note Use velocity_scale = 1/fps for the one-frame velocity extent
+ */
+void velocity_extruded_bounds(const float* positions, const float* velocities, size_t count,
+                              float position_scale, float velocity_scale,
+                              float io_min[3], float io_max[3]);
+
+/*! \brief o_xyz = positions + velocities * dt, o_xyz may alias positions */
+void advect_points(const float* positions, const float* velocities, size_t count,
+                   float dt, float* o_xyz);
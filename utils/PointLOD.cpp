@@ -0,0 +1,124 @@
+#include "PointLOD.h"
+#include <algorithm>
+
+namespace {
+
+/*! \brief splitmix64 finalizer, consecutive ids get unrelated ranks */
+inline uint64_t lod_hash(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/*! \brief Rank in [0,1) from the top 24 bits of the hash */
+inline float lod_rank(uint64_t hash)
+{
+    return float(hash >> 40) * (1.0f / 16777216.0f);
+}
+
+inline size_t lod_level(float rank, const std::vector<float>& fractions)
+{
+    size_t level = 0;
+    while (level+1 < fractions.size() && rank >= fractions[level])
+        level++;
+    return level;
+}
+
+} // anonymous namespace
+
+PointLOD::PointLOD()
+{
+}
+
+std::vector<float> PointLOD::default_fractions()
+{
+    std::vector<float> fractions;
+    fractions.push_back(0.01f);
+    fractions.push_back(0.1f);
+    fractions.push_back(1.0f);
+    return fractions;
+}
+
+void PointLOD::build(const TileTraversal& traversal,
+                     const uint64_t* ids,
+                     const std::vector<float>& i_fractions)
+{
+    std::vector<float> fractions(i_fractions);
+    if (fractions.empty())
+        fractions.push_back(1.0f);
+    fractions.back() = 1.0f;
+    const size_t levelCount = fractions.size();
+    const size_t tileCount = traversal.tileCount();
+
+    // Counting sort by level, level major then tile order : count the
+    // points of each level in each tile, then scatter in a second pass
+    std::vector<uint8_t> point_levels(traversal.elementCount());
+    std::vector<size_t> counts(tileCount*levelCount,0);
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        size_t* tile_counts = &counts[tile.ordinal*levelCount];
+        const uint64_t tile_seed = (uint64_t(tile.index.depth)<<32) | uint64_t(tile.index.tile);
+        for (size_t i=0;i<tile.elementCount;i++)
+        {
+            const size_t point = tile.elementOffset+i;
+            uint64_t hash = ids ? lod_hash(ids[point]) : lod_hash(lod_hash(tile_seed) ^ uint64_t(i));
+            size_t level = lod_level(lod_rank(hash),fractions);
+            point_levels[point] = uint8_t(level);
+            tile_counts[level]++;
+        }
+    });
+
+    std::vector<size_t> offsets(tileCount*levelCount);
+    _level_point_counts.assign(levelCount,0);
+    size_t offset = 0;
+    for (size_t level=0;level<levelCount;level++)
+    {
+        for (size_t t=0;t<tileCount;t++)
+        {
+            offsets[t*levelCount+level] = offset;
+            offset += counts[t*levelCount+level];
+        }
+        _level_point_counts[level] = offset;
+    }
+
+    _order.resize(traversal.elementCount());
+    traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+        size_t* tile_offsets = &offsets[tile.ordinal*levelCount];
+        for (size_t i=0;i<tile.elementCount;i++)
+        {
+            const size_t point = tile.elementOffset+i;
+            _order[tile_offsets[point_levels[point]]++] = uint32_t(point);
+        }
+    });
+}
+
+size_t PointLOD::level_for_budget(size_t point_budget) const
+{
+    size_t level = 0;
+    while (level+1 < _level_point_counts.size() && _level_point_counts[level+1] <= point_budget)
+        level++;
+    return level;
+}
+
+bool gather_point_ids(const Bifrost::API::Component& component,
+                      const TileTraversal& traversal,
+                      const std::string& id_channel_name,
+                      std::vector<uint64_t>& o_ids)
+{
+    o_ids.clear();
+    ChannelIndex channel_index(component);
+    int idChannelIndex = channel_index.find(id_channel_name);
+    if (idChannelIndex<0)
+        return false;
+    const Bifrost::API::Channel& id_ch = channel_index.channel(idChannelIndex);
+    if (!id_ch.valid() || (id_ch.dataType()!=Bifrost::API::UInt64Type && id_ch.dataType()!=Bifrost::API::Int64Type))
+        return false;
+    // Int64 ids are hashed as their two's complement bits
+    if (!gather_channel(traversal,id_ch,o_ids))
+    {
+        o_ids.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "BifrostUtils.h"
+#include <stdint.h>
+#include <vector>
+
+/*!
+ * \brief Progressive ordering of the points of a component for viewport
+ *        level-of-detail
+ * \note Each point gets a rank from the hash of its id and belongs to the
+ *       first level whose fraction is above its rank, so the same particle
+ *       stays in the same level from frame to frame and every tile keeps
+ *       about the same fraction of its points. The order lists the points
+ *       of level 0 first, then the points added by level 1 and so on, so
+ *       drawing level l is drawing the first level_point_count(l) points
+ *       of the reordered arrays, one contiguous range. Without ids the rank
+ *       comes from the tile and the position of the point in it, stable
+ *       only as long as the tiles do not change
+ */
+class PointLOD
+{
+public:
+    PointLOD();
+
+    /*!
+     * \param ids One id per element of the traversal, may be null
+     * \param fractions Increasing fractions of the points in each level,
+     *        the last one is forced to 1 so the last level holds every point
+     */
+    void build(const TileTraversal& traversal,
+               const uint64_t* ids,
+               const std::vector<float>& fractions);
+
+    size_t level_count() const { return _level_point_counts.size(); }
+    /*! \brief Number of points drawn at this level, including the coarser levels' */
+    size_t level_point_count(size_t level) const { return _level_point_counts[level]; }
+    size_t point_count() const { return _order.size(); }
+    /*! \brief Finest level drawing at most point_budget points, 0 if even level 0 exceeds it */
+    size_t level_for_budget(size_t point_budget) const;
+    /*! \brief For each reordered point, its index in traversal order */
+    const std::vector<uint32_t>& order() const { return _order; }
+
+    /*! \brief o_data[i] = i_data[order[i]], components values per point, in parallel */
+    template<typename T>
+    void reorder(const T* i_data, size_t components, T* o_data) const;
+    /*! \brief Reorders a vector in place */
+    template<typename T>
+    void reorder(std::vector<T>& io_data, size_t components) const
+    {
+        if (io_data.empty() || io_data.size() != _order.size()*components)
+            return;
+        std::vector<T> reordered(io_data.size());
+        reorder(&io_data[0],components,&reordered[0]);
+        io_data.swap(reordered);
+    }
+
+    /*! \brief 1%, 10% and 100% */
+    static std::vector<float> default_fractions();
+
+private:
+    std::vector<uint32_t> _order;
+    std::vector<size_t>   _level_point_counts;
+};
+
+template<typename T>
+void PointLOD::reorder(const T* i_data, size_t components, T* o_data) const
+{
+    const std::vector<uint32_t>& order = _order;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0,order.size()),
+                      [&](const tbb::blocked_range<size_t>& range) {
+                          for (size_t i=range.begin();i!=range.end();i++)
+                              for (size_t c=0;c<components;c++)
+                                  o_data[i*components+c] = i_data[size_t(order[i])*components+c];
+                      });
+}
+
+/*!
+ * \brief Gathers the particle ids of an Int64 or UInt64 id channel
+ * \return false if there is no such channel, o_ids is then empty
+ */
+bool gather_point_ids(const Bifrost::API::Component& component,
+                      const TileTraversal& traversal,
+                      const std::string& id_channel_name,
+                      std::vector<uint64_t>& o_ids);
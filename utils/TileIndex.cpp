@@ -0,0 +1,174 @@
+#include "TileIndex.h"
+#include "BifrostUtils.h"
+#include "PointKernels.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+const char     TILE_INDEX_MAGIC[4] = { 'B', 'I', 'F', 'T' };
+const uint32_t TILE_INDEX_VERSION  = 2;
+
+bool overlaps(const BoundsCacheBox& a, const BoundsCacheBox& b)
+{
+    for (int axis=0;axis<3;axis++)
+        if (a.max[axis]<b.min[axis] || a.min[axis]>b.max[axis])
+            return false;
+    return true;
+}
+
+/*!
+ * \brief Field by field copy into a record zeroed by the caller, a struct
+ *        copy would carry the tail padding after voxel_scale over
+ */
+void copy_record_fields(const TileIndexRecord& record, TileIndexRecord& o_record)
+{
+    o_record.component = record.component;
+    o_record.tile = record.tile;
+    o_record.depth = record.depth;
+    o_record.element_count = record.element_count;
+    o_record.element_offset = record.element_offset;
+    o_record.bounds = record.bounds;
+    o_record.voxel_scale = record.voxel_scale;
+}
+
+} // anonymous namespace
+
+TileIndex::TileIndex()
+{
+}
+
+bool TileIndex::build(const Bifrost::API::StateServer& ss,
+                      const std::string& position_channel_name)
+{
+    _tiles.clear();
+    _bounds.clear();
+    bool found_points = false;
+    size_t numComponents = ss.components().count();
+    for (size_t componentIndex=0;componentIndex<numComponents;componentIndex++)
+    {
+        Bifrost::API::Component component = ss.components()[componentIndex];
+        if (component.type() != Bifrost::API::PointComponentType)
+            continue;
+        Bifrost::API::Channel position_ch;
+        bool position_status = false;
+        get_channel(component,position_channel_name,Bifrost::API::FloatV3Type,position_ch,position_status);
+        if (!position_status)
+            continue;
+        found_points = true;
+
+        Bifrost::API::Layout layout = component.layout();
+        const float voxel_scale = layout.voxelScale();
+        TileTraversal traversal(layout,position_ch);
+        size_t first_tile = _tiles.size();
+        _tiles.resize(first_tile+traversal.tileCount());
+        traversal.parallel_for_each([&](const TileTraversal::Tile& tile) {
+            TileIndexRecord& record = _tiles[first_tile+tile.ordinal];
+            record.component = uint32_t(componentIndex);
+            record.tile = uint32_t(tile.index.tile);
+            record.depth = uint32_t(tile.index.depth);
+            record.element_count = uint32_t(tile.elementCount);
+            record.element_offset = tile.elementOffset;
+            record.voxel_scale = voxel_scale;
+            size_t bufferSize = 0;
+            const float* position_tile_data = static_cast<const float*>(position_ch.tileDataPtr( tile.index, bufferSize ));
+            if (position_tile_data)
+                points_bounds(position_tile_data,tile.elementCount,voxel_scale,record.bounds.min,record.bounds.max);
+        });
+        for (size_t i=first_tile;i<_tiles.size();i++)
+            _bounds.extend(_tiles[i].bounds);
+    }
+    return found_points;
+}
+
+bool TileIndex::read(const std::string& filename)
+{
+    _tiles.clear();
+    _bounds.clear();
+    FILE* file = fopen(filename.c_str(),"rb");
+    if (!file)
+        return false;
+    TileIndexHeader header;
+    bool status = fread(&header,sizeof(header),1,file)==1
+        && memcmp(header.magic,TILE_INDEX_MAGIC,sizeof(header.magic))==0
+        && header.version==TILE_INDEX_VERSION;
+    if (status)
+    {
+        _tiles.resize(header.tile_count);
+        status = header.tile_count==0
+            || fread(&_tiles[0],sizeof(TileIndexRecord),header.tile_count,file)==header.tile_count;
+    }
+    fclose(file);
+    if (!status)
+    {
+        _tiles.clear();
+        return false;
+    }
+    for (size_t i=0;i<_tiles.size();i++)
+        _bounds.extend(_tiles[i].bounds);
+    return true;
+}
+
+bool TileIndex::write(const std::string& filename) const
+{
+    TileIndexHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,TILE_INDEX_MAGIC,sizeof(header.magic));
+    header.version = TILE_INDEX_VERSION;
+    header.tile_count = uint32_t(_tiles.size());
+
+    // Zeroed so no uninitialised padding bytes end up in the file
+    TileIndexRecordContainer records(_tiles.size());
+    if (!records.empty())
+        memset(static_cast<void*>(&records[0]),0,records.size()*sizeof(TileIndexRecord));
+    for (size_t i=0;i<_tiles.size();i++)
+        copy_record_fields(_tiles[i],records[i]);
+
+    FILE* file = fopen(filename.c_str(),"wb");
+    if (!file)
+        return false;
+    bool status = fwrite(&header,sizeof(header),1,file)==1
+        && (records.empty() || fwrite(&records[0],sizeof(TileIndexRecord),records.size(),file)==records.size());
+    return fclose(file)==0 && status;
+}
+
+void TileIndex::intersecting(const BoundsCacheBox& region,
+                             std::vector<size_t>& o_tiles) const
+{
+    o_tiles.clear();
+    if (!overlaps(_bounds,region))
+        return;
+    for (size_t i=0;i<_tiles.size();i++)
+        if (_tiles[i].element_count>0 && overlaps(_tiles[i].bounds,region))
+            o_tiles.push_back(i);
+}
+
+void TileIndex::intersecting_file_space(const BoundsCacheBox& region,
+                                        std::vector<size_t>& o_tiles) const
+{
+    o_tiles.clear();
+    for (size_t i=0;i<_tiles.size();i++)
+    {
+        const TileIndexRecord& record = _tiles[i];
+        if (record.element_count==0)
+            continue;
+        BoundsCacheBox world_region;
+        for (int axis=0;axis<3;axis++)
+        {
+            world_region.min[axis] = region.min[axis] * record.voxel_scale;
+            world_region.max[axis] = region.max[axis] * record.voxel_scale;
+        }
+        if (overlaps(record.bounds,world_region))
+            o_tiles.push_back(i);
+    }
+}
+
+std::string tile_index_filename(const std::string& bifrost_filename)
+{
+    std::string result(bifrost_filename);
+    size_t extension = result.find_last_of('.');
+    size_t slash = result.find_last_of("/\\");
+    if (extension != std::string::npos && (slash == std::string::npos || extension > slash))
+        result.erase(extension);
+    return result + ".tidx";
+}
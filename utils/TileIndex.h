@@ -0,0 +1,80 @@
+#pragma once
+
+#include "BoundsCache.h"
+#include <BifrostHeaders.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief Per-tile spatial index of the point components of one Bifrost
+ *        file, so consumers only process the tiles seen by a region of
+ *        interest (camera frustum bounds, crop box)
+ * \note Binary sidecar, native endianness : TileIndexHeader followed by
+ *       tile_count TileIndexRecord in component then depth/tile order.
+ *       Bounds are in world space (positions * the voxel scale of the
+ *       record's component, components do not share a voxel scale).
+ *       The Bifrost SDK loads a StateServer as a whole and does not expose
+ *       tile byte offsets, the element offsets recorded are where each
+ *       tile's elements start in the component's gathered arrays
+ */
+struct TileIndexRecord
+{
+    TileIndexRecord()
+    : component(0)
+    , tile(0)
+    , depth(0)
+    , element_count(0)
+    , element_offset(0)
+    , voxel_scale(1.0f)
+    {}
+    uint32_t       component; /*!< index of the point component in the StateServer */
+    uint32_t       tile;
+    uint32_t       depth;
+    uint32_t       element_count;
+    uint64_t       element_offset; /*!< in elements, within the component */
+    BoundsCacheBox bounds;
+    float          voxel_scale;    /*!< of the component, divides bounds back to file space */
+};
+typedef std::vector<TileIndexRecord> TileIndexRecordContainer;
+
+struct TileIndexHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t tile_count;
+};
+
+class TileIndex
+{
+public:
+    TileIndex();
+
+    /*! \brief Indexes the point components of a loaded file */
+    bool build(const Bifrost::API::StateServer& ss,
+               const std::string& position_channel_name);
+    bool read(const std::string& filename);
+    bool write(const std::string& filename) const;
+
+    size_t tile_count() const { return _tiles.size(); }
+    const TileIndexRecord& tile(size_t i) const { return _tiles[i]; }
+    /*! \brief Union of the bounds of all the tiles */
+    const BoundsCacheBox& bounds() const { return _bounds; }
+
+    /*! \brief Positions of the tiles whose bounds overlap the region */
+    void intersecting(const BoundsCacheBox& region,
+                      std::vector<size_t>& o_tiles) const;
+    /*! \brief Same as above for a region in file space, scaled by each record's voxel scale */
+    void intersecting_file_space(const BoundsCacheBox& region,
+                                 std::vector<size_t>& o_tiles) const;
+
+    /*! \brief Key identifying a tile within a component, e.g. for a std::unordered_set */
+    static uint64_t tile_key(uint32_t tile, uint32_t depth) { return (uint64_t(depth)<<32) | tile; }
+
+private:
+    BoundsCacheBox           _bounds;
+    TileIndexRecordContainer _tiles;
+};
+
+/*! \brief Sidecar name of a Bifrost file's tile index, "liquid.0012.bif" -> "liquid.0012.tidx" */
+std::string tile_index_filename(const std::string& bifrost_filename);